@@ -4,12 +4,14 @@
 
 #include <sys/types.h>    
 #include <sys/socket.h>
+#include <sys/stat.h>
 #include <errno.h>
 #include <unistd.h>
+#include <fcntl.h>
 
-static int createNonblocking(){
+static int createNonblocking(sa_family_t family){
     //LOG_INFO("Acceptor-createNonBlocking");
-    int sockfd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    int sockfd = ::socket(family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
     if(sockfd < 0){
         LOG_FATAL("%s:%s:%d lsiten socket create err:%d \n", __FILE__, __FUNCTION__, __LINE__, errno);
     }
@@ -17,23 +19,71 @@ static int createNonblocking(){
     return sockfd;
 }
 
+// 上次运行留下的 socket 文件会让 bind 失败。只删除确实是 socket、并且已经没有进程在监听的文件，
+// 普通文件和仍在服务的 socket 留给 bind 报错
+static void removeStaleUnixSocket(const InetAddress &addr){
+    std::string path = addr.toIP();
+    // 抽象命名空间没有文件
+    if(path.empty() || path[0] == '@'){
+        return;
+    }
+    struct stat st;
+    if(::lstat(path.c_str(), &st) < 0 || !S_ISSOCK(st.st_mode)){
+        return;
+    }
+    int probe = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if(probe < 0){
+        return;
+    }
+    if(::connect(probe, addr.getSockAddr(), addr.getSockAddrLen()) < 0 && errno == ECONNREFUSED){
+        LOG_INFO("Acceptor: removing stale unix socket %s\n", path.c_str());
+        ::unlink(path.c_str());
+    }
+    ::close(probe);
+}
+
 Acceptor::Acceptor(EventLoop *loop, const InetAddress &listenAddr, bool reuseport)
     : loop_(loop)
-    , acceptSocket_(createNonblocking())
+    , acceptSocket_(createNonblocking(listenAddr.family()))
     , acceptChannel_(loop, acceptSocket_.fd())
     , listenning_(false)
 {
-    acceptSocket_.setReuseAddr(true);
-    acceptSocket_.setReusePort(reuseport);
+    if(listenAddr.isUnix()){
+        removeStaleUnixSocket(listenAddr);
+    }else{
+        acceptSocket_.setReuseAddr(true);
+        acceptSocket_.setReusePort(reuseport);
+    }
     acceptSocket_.bindAddress(listenAddr);
+    if(listenAddr.isUnix()){
+        std::string path = listenAddr.toIP();
+        if(!path.empty() && path[0] != '@'){
+            unixPath_ = path;
+        }
+    }
     acceptChannel_.setReadCallback(std::bind(&Acceptor::handleRead, this));
 }  
 
 
+Acceptor::Acceptor(EventLoop *loop, int listenfd)
+    : loop_(loop)
+    , acceptSocket_(listenfd)
+    , acceptChannel_(loop, acceptSocket_.fd())
+    , listenning_(false)
+{
+    // 继承来的 fd 不一定是非阻塞的
+    int flags = ::fcntl(listenfd, F_GETFL, 0);
+    ::fcntl(listenfd, F_SETFL, flags | O_NONBLOCK);
+    ::fcntl(listenfd, F_SETFD, FD_CLOEXEC);
+    acceptChannel_.setReadCallback(std::bind(&Acceptor::handleRead, this));
+}
+
 Acceptor::~Acceptor(){
     acceptChannel_.disableAll();
     acceptChannel_.remove();
-
+    if(!unixPath_.empty()){
+        ::unlink(unixPath_.c_str());
+    }
 }
 
 void Acceptor::listen(){
@@ -43,6 +93,18 @@ void Acceptor::listen(){
     acceptChannel_.enableReading();
 
 }
+void Acceptor::stopListening(){
+    if(listenning_){
+        listenning_ = false;
+        acceptChannel_.disableAll();
+    }
+}
+
+void Acceptor::handOff(){
+    stopListening();
+    unixPath_.clear();
+}
+
 void Acceptor::handleRead(){
     InetAddress peerAddr;
     int connfd = acceptSocket_.accept(&peerAddr);
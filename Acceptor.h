@@ -5,12 +5,15 @@
 #include "Channel.h"
 
 #include <functional>
+#include <string>
 class InetAddress;
 class EventLoop;
 class Acceptor : noncopyable{
 public:
     using NewConnectionCallback  = std::function<void(int sockfd, const InetAddress&)>;
     Acceptor(EventLoop *loop, const InetAddress &listenAddr, bool reusuport);
+    // 接管一个已经 bind 好的监听 fd（热重启时从旧进程继承），不再 bind，析构时也不删除 socket 文件
+    Acceptor(EventLoop *loop, int listenfd);
     ~Acceptor();
 
     void setNewConnectionCallback(const NewConnectionCallback &cb){
@@ -18,6 +21,11 @@ public:
     }
     bool listenning() const {return listenning_;}
     void listen();
+    // 不再 accept 新连接，监听 fd 保持打开，已在队列中的连接留给接管的进程
+    void stopListening();
+    // 监听 fd 已交给接管的进程：停止 accept，析构时不再删除 Unix 域 socket 文件
+    void handOff();
+    int listenFd() const { return acceptSocket_.fd(); }
 
 private:
     void handleRead();
@@ -27,5 +35,6 @@ private:
     Channel acceptChannel_;
     NewConnectionCallback newConnectionCallback_;
     bool listenning_;
+    std::string unixPath_; // 自己 bind 的 Unix 域 socket 文件，析构时删除；抽象地址和继承的 fd 为空
 
 };
\ No newline at end of file
@@ -0,0 +1,73 @@
+#include "AdmissionController.h"
+#include "EventLoop.h"
+#include "InetAddress.h"
+#include "Logger.h"
+
+AdmissionController::AdmissionController(const Options &options)
+    : options_(options)
+    , tokens_(options.acceptBurst > 0 ? options.acceptBurst : options.maxAcceptRate)
+    , rejected_(0)
+{
+}
+
+AdmissionController::Decision AdmissionController::admit(size_t currentConnections, Timestamp now){
+    if(options_.maxConnections > 0 && currentConnections >= options_.maxConnections){
+        return kTooManyConnections;
+    }
+    if(options_.maxAcceptRate > 0){
+        double burst = options_.acceptBurst > 0 ? options_.acceptBurst : options_.maxAcceptRate;
+        if(lastRefill_.valid()){
+            tokens_ += timeDifference(now, lastRefill_) * options_.maxAcceptRate;
+            if(tokens_ > burst){
+                tokens_ = burst;
+            }
+        }
+        lastRefill_ = now;
+        if(tokens_ < 1.0){
+            return kAcceptRateExceeded;
+        }
+        tokens_ -= 1.0;
+    }
+    return kAccept;
+}
+
+bool AdmissionController::overloaded(const EventLoop *loop) const{
+    if(options_.maxLoopLagMicroSeconds > 0 &&
+       loop->loopLagMicroSeconds() > options_.maxLoopLagMicroSeconds){
+        return true;
+    }
+    if(options_.maxPendingFunctors > 0 &&
+       loop->queueSize() > options_.maxPendingFunctors){
+        return true;
+    }
+    return false;
+}
+
+void AdmissionController::reject(int sockfd, const InetAddress &peerAddr, Decision reason){
+    uint64_t n = rejected_.fetch_add(1, std::memory_order_relaxed) + 1;
+    // 过载时拒绝可能非常频繁，只偶尔打一条日志
+    if((n & (n - 1)) == 0){
+        LOG_ERROR("AdmissionController reject %s (%s), rejected %lu so far\n",
+                  peerAddr.toIpPort().c_str(), decisionName(reason),
+                  static_cast<unsigned long>(n));
+    }
+    if(rejectCallback_){
+        rejectCallback_(sockfd, peerAddr, reason);
+    }
+}
+
+const char* AdmissionController::decisionName(Decision reason){
+    switch (reason)
+    {
+    case kAccept:
+        return "accept";
+    case kTooManyConnections:
+        return "too many connections";
+    case kAcceptRateExceeded:
+        return "accept rate exceeded";
+    case kLoopOverloaded:
+        return "loop overloaded";
+    default:
+        return "unknown";
+    }
+}
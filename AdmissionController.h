@@ -0,0 +1,69 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "Timestamp.h"
+
+#include <atomic>
+#include <functional>
+#include <stddef.h>
+
+class EventLoop;
+class InetAddress;
+
+// 准入控制：subloop 过载时，在 TcpServer::newConnection 里尽早拒绝新连接，
+// 而不是把连接继续分给已经处理不过来的 loop，让所有连接的延迟一起变差。
+// 过载依据是 loop 的迭代耗时（EventLoop::loopLagMicroSeconds）和待执行回调数（EventLoop::queueSize）。
+// 所有限制为 0 表示不限制。
+class AdmissionController : noncopyable {
+public:
+    struct Options {
+        Options()
+            : maxConnections(0)
+            , maxAcceptRate(0)
+            , acceptBurst(0)
+            , maxLoopLagMicroSeconds(0)
+            , maxPendingFunctors(0)
+        {}
+        size_t maxConnections;          // 同时存在的连接数上限
+        double maxAcceptRate;           // 每秒最多接受的新连接数
+        double acceptBurst;             // 令牌桶容量，0 表示等于 maxAcceptRate
+        int64_t maxLoopLagMicroSeconds; // loop 平滑后的迭代耗时上限
+        size_t maxPendingFunctors;      // loop 待执行回调数上限
+    };
+
+    enum Decision {
+        kAccept,
+        kTooManyConnections,
+        kAcceptRateExceeded,
+        kLoopOverloaded,
+    };
+
+    // 被拒绝的连接在关闭前交给应用，可以写一个简短的拒绝响应；sockfd 由 TcpServer 关闭
+    using RejectCallback = std::function<void(int sockfd, const InetAddress &peerAddr, Decision reason)>;
+
+    explicit AdmissionController(const Options &options);
+
+    // 在 baseloop 中调用，判断是否还能接受新连接（不检查 loop 是否过载）
+    Decision admit(size_t currentConnections, Timestamp now);
+
+    // loop 是否过载，可跨线程调用。
+    // 应用层可以在 MessageCallback 里据此丢弃或快速失败请求，实现请求级别的削峰
+    bool overloaded(const EventLoop *loop) const;
+
+    void setRejectCallback(const RejectCallback &cb) { rejectCallback_ = cb; }
+    // 在 baseloop 中调用，记录并通知应用
+    void reject(int sockfd, const InetAddress &peerAddr, Decision reason);
+
+    uint64_t rejected() const { return rejected_.load(std::memory_order_relaxed); }
+    const Options& options() const { return options_; }
+
+    static const char* decisionName(Decision reason);
+
+private:
+    const Options options_;
+    // 令牌桶，只在 baseloop 中访问
+    double tokens_;
+    Timestamp lastRefill_;
+    std::atomic<uint64_t> rejected_;
+    RejectCallback rejectCallback_;
+};
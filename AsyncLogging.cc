@@ -0,0 +1,238 @@
+#include "AsyncLogging.h"
+#include "LogFile.h"
+
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+
+namespace {
+
+std::atomic<uint64_t> g_nextAsyncLoggingId(1);
+
+} // namespace
+
+thread_local AsyncLogging::ThreadCache AsyncLogging::t_cache;
+
+AsyncLogging::ThreadCache::~ThreadCache(){
+    for(auto &entry : entries){
+        std::lock_guard<std::mutex> lock(entry.second->mutex);
+        entry.second->dead = true;
+    }
+}
+
+AsyncLogging::AsyncLogging(const std::string &basename, off_t rollSize, int flushInterval)
+    : flushInterval_(flushInterval)
+    , basename_(basename)
+    , rollSize_(rollSize)
+    , id_(g_nextAsyncLoggingId++)
+    , running_(false)
+    , dropped_(0)
+    , reportedDropped_(0)
+    , thread_(std::bind(&AsyncLogging::threadFunc, this), "Logging")
+    , wakeupRequested_(false)
+    , passes_(0)
+    , flushTarget_(0)
+{
+}
+
+AsyncLogging::~AsyncLogging(){
+    if(running_){
+        stop();
+    }
+}
+
+void AsyncLogging::start(){
+    running_ = true;
+    thread_.start();
+}
+
+void AsyncLogging::stop(){
+    running_ = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        wakeupRequested_ = true;
+    }
+    cond_.notify_one();
+    thread_.join();
+    // 后台线程退出前已经写完所有日志，释放各线程的缓冲；之后还在写日志的线程只会计入丢弃
+    std::lock_guard<std::mutex> lock(registryMutex_);
+    for(const ThreadBuffersPtr &tb : threadBuffers_){
+        std::lock_guard<std::mutex> tbLock(tb->mutex);
+        tb->dead = true;
+        tb->current.reset();
+        tb->full.clear();
+        tb->empty.clear();
+    }
+    threadBuffers_.clear();
+}
+
+AsyncLogging::ThreadBuffers* AsyncLogging::threadBuffers(){
+    std::vector<std::pair<uint64_t, ThreadBuffersPtr>> &entries = t_cache.entries;
+    for(const auto &entry : entries){
+        if(entry.first == id_){
+            return entry.second.get();
+        }
+    }
+    // 每个线程在每个实例下第一次写日志时登记一次，顺便去掉已经 stop 的实例留下的项
+    entries.erase(std::remove_if(entries.begin(), entries.end(),
+                                 [](const std::pair<uint64_t, ThreadBuffersPtr> &entry){
+                                     std::lock_guard<std::mutex> lock(entry.second->mutex);
+                                     return entry.second->dead;
+                                 }),
+                  entries.end());
+    ThreadBuffersPtr tb = std::make_shared<ThreadBuffers>();
+    {
+        std::lock_guard<std::mutex> lock(registryMutex_);
+        threadBuffers_.push_back(tb);
+    }
+    entries.emplace_back(id_, tb);
+    return tb.get();
+}
+
+void AsyncLogging::append(const char *logline, size_t len){
+    if(len > kBufferSize){
+        len = kBufferSize;
+    }
+    ThreadBuffers *tb = threadBuffers();
+    bool notify = false;
+    {
+        std::lock_guard<std::mutex> lock(tb->mutex);
+        if(tb->dead){
+            // 实例已经 stop
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        if(tb->current && tb->current->avail() < len){
+            tb->full.push_back(std::move(tb->current));
+            notify = true;
+        }
+        if(!tb->current){
+            if(!tb->empty.empty()){
+                tb->current = std::move(tb->empty.back());
+                tb->empty.pop_back();
+            }else if(tb->allocated < kBuffersPerThread){
+                tb->current.reset(new LogBuffer);
+                ++tb->allocated;
+            }
+        }
+        if(tb->current){
+            memcpy(tb->current->data.get() + tb->current->len, logline, len);
+            tb->current->len += len;
+        }else{
+            // 后台线程跟不上，丢弃而不是阻塞前台线程；刚写满的缓冲仍然要通知后台线程
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    if(notify){
+        // 每写满一块缓冲才通知一次后台线程
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            wakeupRequested_ = true;
+        }
+        cond_.notify_one();
+    }
+}
+
+void AsyncLogging::flush(){
+    if(!running_){
+        return;
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    // 正在进行的那一轮可能已经错过调用方刚写的日志，所以等两轮
+    uint64_t target = passes_ + 2;
+    if(target > flushTarget_){
+        flushTarget_ = target;
+    }
+    cond_.notify_one();
+    flushedCond_.wait(lock, [this, target]{ return passes_ >= target || !running_; });
+}
+
+void AsyncLogging::writeOnce(LogFile &output){
+    std::vector<ThreadBuffersPtr> registry;
+    {
+        std::lock_guard<std::mutex> lock(registryMutex_);
+        registry = threadBuffers_;
+    }
+
+    // 交换出每个线程的待写缓冲，持锁时间只是几次指针移动
+    std::vector<std::pair<ThreadBuffers*, BufferPtr>> toWrite;
+    bool reap = false;
+    for(const ThreadBuffersPtr &tb : registry){
+        std::lock_guard<std::mutex> lock(tb->mutex);
+        for(BufferPtr &buf : tb->full){
+            toWrite.emplace_back(tb.get(), std::move(buf));
+        }
+        tb->full.clear();
+        if(tb->current && tb->current->len > 0){
+            toWrite.emplace_back(tb.get(), std::move(tb->current));
+        }
+        if(tb->dead){
+            // 线程已经退出，这是它最后的日志，缓冲不再归还
+            tb->current.reset();
+            tb->empty.clear();
+            reap = true;
+        }
+    }
+
+    uint64_t dropped = dropped_.load(std::memory_order_relaxed);
+    if(dropped != reportedDropped_){
+        char buf[128];
+        int n = snprintf(buf, sizeof buf, "[ERROR] AsyncLogging dropped %lu log messages\n",
+                         static_cast<unsigned long>(dropped - reportedDropped_));
+        output.append(buf, n);
+        reportedDropped_ = dropped;
+    }
+
+    for(auto &item : toWrite){
+        output.append(item.second->data.get(), item.second->len);
+    }
+    if(!toWrite.empty()){
+        output.flush();
+    }
+
+    // 写完的缓冲还给原线程复用
+    for(auto &item : toWrite){
+        item.second->len = 0;
+        std::lock_guard<std::mutex> lock(item.first->mutex);
+        if(!item.first->dead){
+            item.first->empty.push_back(std::move(item.second));
+        }
+    }
+
+    if(reap){
+        std::lock_guard<std::mutex> lock(registryMutex_);
+        threadBuffers_.erase(std::remove_if(threadBuffers_.begin(), threadBuffers_.end(),
+                                            [](const ThreadBuffersPtr &tb){
+                                                std::lock_guard<std::mutex> tbLock(tb->mutex);
+                                                return tb->dead;
+                                            }),
+                             threadBuffers_.end());
+    }
+}
+
+void AsyncLogging::threadFunc(){
+    LogFile output(basename_, rollSize_);
+    while(running_){
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if(!wakeupRequested_ && passes_ >= flushTarget_){
+                cond_.wait_for(lock, std::chrono::seconds(flushInterval_));
+            }
+            wakeupRequested_ = false;
+        }
+        writeOnce(output);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            ++passes_;
+        }
+        flushedCond_.notify_all();
+    }
+    // 退出前把剩下的日志写完
+    writeOnce(output);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++passes_;
+    }
+    flushedCond_.notify_all();
+}
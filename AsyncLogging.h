@@ -0,0 +1,100 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "Thread.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+class LogFile;
+
+// 异步日志后端：
+// 每个写日志的线程有自己的前台缓冲，写满后交给后台线程，后台线程批量写入滚动文件。
+// 前台线程只在与后台交换缓冲时短暂竞争本线程的锁，不会等待磁盘 IO。
+// 每个线程最多持有 kBuffersPerThread 块缓冲，全部写满时丢弃日志并计数；
+// 线程退出后后台线程写完它剩下的日志再回收缓冲，内存随存活的线程数而不是创建过的线程数增长。
+//
+// 用法：
+//   AsyncLogging log("/tmp/server", 64 * 1024 * 1024);
+//   log.start();
+//   Logger::instance().setOutput(std::bind(&AsyncLogging::append, &log, _1, _2));
+//   Logger::instance().setFlush(std::bind(&AsyncLogging::flush, &log));
+class AsyncLogging : noncopyable {
+public:
+    AsyncLogging(const std::string &basename, off_t rollSize, int flushInterval = 3);
+    ~AsyncLogging();
+
+    // 任意线程调用
+    void append(const char *logline, size_t len);
+    // 阻塞到调用前写入的日志全部落盘，只在 LOG_FATAL 等退出前使用
+    void flush();
+
+    void start();
+    void stop();
+
+    // 因缓冲全部写满而丢弃的日志条数
+    uint64_t droppedMessages() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    static const size_t kBufferSize = 1024 * 1024;
+    static const int kBuffersPerThread = 4;
+
+    struct LogBuffer {
+        LogBuffer() : data(new char[kBufferSize]), len(0) {}
+        size_t avail() const { return kBufferSize - len; }
+        std::unique_ptr<char[]> data;
+        size_t len;
+    };
+    using BufferPtr = std::unique_ptr<LogBuffer>;
+
+    // 一个前台线程的缓冲，mutex 只在本线程和后台线程之间竞争
+    struct ThreadBuffers {
+        ThreadBuffers() : allocated(0), dead(false) {}
+        std::mutex mutex;
+        BufferPtr current;
+        std::vector<BufferPtr> full;  // 写满待落盘
+        std::vector<BufferPtr> empty; // 后台线程写完归还的空缓冲
+        int allocated;                // 已分配的缓冲数，含后台线程手里的
+        bool dead;                    // 线程已经退出或实例已经 stop，写完剩下的日志后回收
+    };
+    using ThreadBuffersPtr = std::shared_ptr<ThreadBuffers>;
+
+    // 本线程在各个实例下登记的缓冲，按实例 id 查找；线程退出时把它们标记为 dead
+    struct ThreadCache {
+        ~ThreadCache();
+        std::vector<std::pair<uint64_t, ThreadBuffersPtr>> entries;
+    };
+    static thread_local ThreadCache t_cache;
+
+    ThreadBuffers* threadBuffers();
+    void threadFunc();
+    // 把所有线程的待写缓冲收集起来写入文件，再把空缓冲还回去
+    void writeOnce(LogFile &output);
+
+    const int flushInterval_;
+    const std::string basename_;
+    const off_t rollSize_;
+    const uint64_t id_; // 区分不同实例的线程局部缓冲
+
+    std::atomic_bool running_;
+    std::atomic<uint64_t> dropped_;
+    uint64_t reportedDropped_; // 只在后台线程访问
+
+    Thread thread_;
+
+    std::mutex registryMutex_;
+    std::vector<ThreadBuffersPtr> threadBuffers_;
+
+    // 唤醒后台线程，以及 flush 等待后台写完
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    std::condition_variable flushedCond_;
+    bool wakeupRequested_;
+    uint64_t passes_; // 后台已完成的写入轮数
+    uint64_t flushTarget_; // flush 等待的轮数，达到之前后台线程不休眠
+};
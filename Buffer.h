@@ -2,12 +2,13 @@
 
 #include <vector>
 #include <string>
+#include <string.h>
 
 class Buffer
 {
 public:
-    // 前置区域的大小
-    static const size_t kCheapPrepend = 8;
+    // 前置区域的大小，能放下最长的 WebSocket 帧头（10 字节）或长度前缀，头部不用再搬动数据
+    static const size_t kCheapPrepend = 16;
     // 初始缓冲区大小
     static const size_t kInitialSize = 1024;
 
@@ -33,6 +34,19 @@ public:
     const char* peek() const{
         return begin() + readerIndex_;
     }
+    // 可修改的可读数据，用于原地解码（例如 WebSocket 去掩码）
+    char* mutablePeek(){
+        return begin() + readerIndex_;
+    }
+
+    // 在可读数据中从 start 开始查找 "\r\n"，没有时返回 nullptr
+    const char* findCRLF() const{
+        return findCRLF(peek());
+    }
+    const char* findCRLF(const char* start) const{
+        const void* crlf = ::memmem(start, beginWrite() - start, "\r\n", 2);
+        return static_cast<const char*>(crlf);
+    }
 
     // 从缓冲区读取长度为len的数据
     void retrieve(size_t len){
@@ -42,6 +56,10 @@ public:
             retrieveAll();
         }
     }
+    // 读取到 end 为止（不含 end），end 必须在可读区域内
+    void retrieveUntil(const char* end){
+        retrieve(end - peek());
+    }
     void retrieveAll(){
         readerIndex_ = kCheapPrepend;
         writerIndex_ = kCheapPrepend;
@@ -69,6 +87,24 @@ public:
         // copy的第二个参数是数据的结束地址
         // copy的第三个参数是数据的目的地址
         std::copy(data, data+len, beginWrite());
+        writerIndex_ += len;
+    }
+
+    // 在可读数据之前插入 len 字节，len 不能超过 prependableBytes()
+    void prepend(const void* data, size_t len){
+        readerIndex_ -= len;
+        memcpy(begin() + readerIndex_, data, len);
+    }
+
+    // 可写区域的起始地址，直接写入后用 hasWritten 提交
+    char* beginWrite(){
+        return begin() + writerIndex_;
+    }
+    const char* beginWrite() const{
+        return begin() + writerIndex_;
+    }
+    void hasWritten(size_t len){
+        writerIndex_ += len;
     }
 
     // 从fd中读取数据到缓冲区
@@ -87,13 +123,6 @@ private:
         return &(*(buffer_.begin()));
     }
 
-    char* beginWrite(){
-        return begin() + writerIndex_;
-    }
-    const char* beginWrite() const{
-        return begin() + writerIndex_;
-    }
-
     // 扩容缓冲区
     void makeSpace(size_t len);
 
@@ -34,6 +34,7 @@ public:
 
     int fd() const { return fd_; };
     int events() const { return events_; }
+    int revents() const { return revents_; }
     void set_revents(int revt) { revents_ = revt; }
 
     // 设置fd相应的事件状态
@@ -45,8 +46,8 @@ public:
 
     // 返回fd当前的事件状态
     bool isNoneEvent() const { return events_ == kNoneEvent; }
-    bool isWriting() const { return events_ == kWriteEvent; }
-    bool isReading() const { return events_ == kReadEvent; }
+    bool isWriting() const { return events_ & kWriteEvent; }
+    bool isReading() const { return events_ & kReadEvent; }
 
     int index() { return index_; }
     void set_index(int idx) { index_ = idx; }
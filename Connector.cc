@@ -0,0 +1,198 @@
+#include "Connector.h"
+#include "Channel.h"
+#include "EventLoop.h"
+#include "Logger.h"
+#include "Socket.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+Connector::Connector(EventLoop *loop, const InetAddress &serverAddr)
+    : loop_(loop)
+    , serverAddr_(serverAddr)
+    , connect_(false)
+    , state_(kDisconnected)
+    , retryDelayMs_(kInitRetryDelayMs)
+    , connectTimeout_(0.0)
+{
+}
+
+// 定时器回调只持有 weak_ptr，Connector 析构后到期的定时器什么也不做
+Connector::~Connector() {}
+
+void Connector::start() {
+    connect_ = true;
+    loop_->runInLoop(std::bind(&Connector::startInLoop, shared_from_this()));
+}
+
+void Connector::startInLoop() {
+    if (connect_) {
+        connect();
+    } else {
+        LOG_DEBUG("Connector::startInLoop do not connect\n");
+    }
+}
+
+void Connector::stop() {
+    connect_ = false;
+    loop_->queueInLoop(std::bind(&Connector::stopInLoop, shared_from_this()));
+}
+
+void Connector::stopInLoop() {
+    loop_->cancel(retryTimer_);
+    if (state_ == kConnecting) {
+        int sockfd = removeAndResetChannel();
+        retry(sockfd, ECANCELED);
+    }
+}
+
+void Connector::restart() {
+    setState(kDisconnected);
+    retryDelayMs_ = kInitRetryDelayMs;
+    connect_ = true;
+    startInLoop();
+}
+
+void Connector::connect() {
+    int sockfd = ::socket(serverAddr_.family(), SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (sockfd < 0) {
+        int savedErrno = errno;
+        LOG_ERROR("Connector::connect socket err:%d\n", savedErrno);
+        retry(-1, savedErrno);
+        return;
+    }
+    int ret = ::connect(sockfd, serverAddr_.getSockAddr(), serverAddr_.getSockAddrLen());
+    int savedErrno = (ret == 0) ? 0 : errno;
+    switch (savedErrno)
+    {
+    case 0:
+    case EINPROGRESS:
+    case EINTR:
+    case EISCONN:
+        connecting(sockfd);
+        break;
+
+    // 暂时性错误，稍后重试
+    case EAGAIN:
+    case EADDRINUSE:
+    case EADDRNOTAVAIL:
+    case ECONNREFUSED:
+    case ENETUNREACH:
+    case EHOSTUNREACH:
+        retry(sockfd, savedErrno);
+        break;
+
+    default:
+        LOG_ERROR("Connector::connect %s err:%d %s\n", serverAddr_.toIpPort().c_str(),
+                  savedErrno, strerror(savedErrno));
+        ::close(sockfd);
+        setState(kDisconnected);
+        if (connectFailedCallback_) {
+            connectFailedCallback_(savedErrno);
+        }
+        break;
+    }
+}
+
+void Connector::connecting(int sockfd) {
+    setState(kConnecting);
+    channel_.reset(new Channel(loop_, sockfd));
+    channel_->setWriteCallback(std::bind(&Connector::handleWrite, this));
+    channel_->setErrorCallback(std::bind(&Connector::handleError, this));
+    channel_->enableWriting();
+
+    if (connectTimeout_ > 0.0) {
+        std::weak_ptr<Connector> weakSelf(shared_from_this());
+        timeoutTimer_ = loop_->runAfter(connectTimeout_, [weakSelf]() {
+            ConnectorPtr connector = weakSelf.lock();
+            if (connector) {
+                connector->handleTimeout();
+            }
+        });
+    }
+}
+
+int Connector::removeAndResetChannel() {
+    loop_->cancel(timeoutTimer_);
+    channel_->disableAll();
+    channel_->remove();
+    int sockfd = channel_->fd();
+    // 此时可能正处在 channel_ 自己的回调里，不能在这里销毁 channel_
+    loop_->queueInLoop(std::bind(&Connector::resetChannel, shared_from_this()));
+    return sockfd;
+}
+
+void Connector::resetChannel() {
+    channel_.reset();
+}
+
+void Connector::handleWrite() {
+    if (state_ != kConnecting) {
+        return;
+    }
+    int sockfd = removeAndResetChannel();
+    int err = sockets::getSocketError(sockfd);
+    if (err) {
+        LOG_INFO("Connector::handleWrite %s SO_ERROR:%d %s\n", serverAddr_.toIpPort().c_str(),
+                 err, strerror(err));
+        retry(sockfd, err);
+    } else if (!serverAddr_.isUnix() && sockets::isSelfConnect(sockfd)) {
+        LOG_ERROR("Connector::handleWrite self connect\n");
+        retry(sockfd, ECONNREFUSED);
+    } else {
+        setState(kConnected);
+        if (connect_) {
+            newConnectionCallback_(sockfd);
+        } else {
+            ::close(sockfd);
+        }
+    }
+}
+
+void Connector::handleError() {
+    if (state_ == kConnecting) {
+        int sockfd = removeAndResetChannel();
+        int err = sockets::getSocketError(sockfd);
+        LOG_INFO("Connector::handleError %s SO_ERROR:%d %s\n", serverAddr_.toIpPort().c_str(),
+                 err, strerror(err));
+        retry(sockfd, err);
+    }
+}
+
+void Connector::handleTimeout() {
+    if (state_ == kConnecting) {
+        LOG_INFO("Connector::handleTimeout %s after %.3fs\n", serverAddr_.toIpPort().c_str(),
+                 connectTimeout_);
+        int sockfd = removeAndResetChannel();
+        retry(sockfd, ETIMEDOUT);
+    }
+}
+
+void Connector::retry(int sockfd, int savedErrno) {
+    if (sockfd >= 0) {
+        ::close(sockfd);
+    }
+    setState(kDisconnected);
+    if (!connect_) {
+        return;
+    }
+    if (connectFailedCallback_) {
+        connectFailedCallback_(savedErrno);
+    }
+    // 回调里可能调用了 stop()
+    if (!connect_) {
+        return;
+    }
+    LOG_INFO("Connector::retry connecting to %s in %d ms\n", serverAddr_.toIpPort().c_str(),
+             retryDelayMs_);
+    std::weak_ptr<Connector> weakSelf(shared_from_this());
+    retryTimer_ = loop_->runAfter(retryDelayMs_ / 1000.0, [weakSelf]() {
+        ConnectorPtr connector = weakSelf.lock();
+        if (connector) {
+            connector->startInLoop();
+        }
+    });
+    retryDelayMs_ = retryDelayMs_ * 2 < kMaxRetryDelayMs ? retryDelayMs_ * 2 : kMaxRetryDelayMs;
+}
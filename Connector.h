@@ -0,0 +1,72 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "InetAddress.h"
+#include "TimerId.h"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+
+class Channel;
+class EventLoop;
+
+// 主动发起的非阻塞连接：connect 返回 EINPROGRESS 后关注可写事件，可写时检查 SO_ERROR。
+// 失败时按 500ms、1s、2s ... 最长 30s 的间隔退避重试，直到成功或 stop()。
+// 连接建立后把 sockfd 交给 NewConnectionCallback，Connector 不再管理它。
+class Connector : noncopyable,
+    public std::enable_shared_from_this<Connector>
+{
+public:
+    using NewConnectionCallback = std::function<void(int sockfd)>;
+    // 每次连接失败都会调用，随后按退避间隔重试
+    using ConnectFailedCallback = std::function<void(int savedErrno)>;
+
+    Connector(EventLoop *loop, const InetAddress &serverAddr);
+    ~Connector();
+
+    void setNewConnectionCallback(const NewConnectionCallback &cb) { newConnectionCallback_ = cb; }
+    void setConnectFailedCallback(const ConnectFailedCallback &cb) { connectFailedCallback_ = cb; }
+    // 单次 connect 的超时，单位秒，0 表示等内核超时，需在 start() 之前设置
+    void setConnectTimeout(double seconds) { connectTimeout_ = seconds; }
+
+    const InetAddress& serverAddress() const { return serverAddr_; }
+
+    // 可跨线程调用
+    void start();
+    // 只能在 loop 线程中调用，重置退避间隔后立即重连
+    void restart();
+    // 可跨线程调用
+    void stop();
+
+private:
+    enum States { kDisconnected, kConnecting, kConnected };
+    static const int kMaxRetryDelayMs = 30 * 1000;
+    static const int kInitRetryDelayMs = 500;
+
+    void setState(States s) { state_ = s; }
+    void startInLoop();
+    void stopInLoop();
+    void connect();
+    void connecting(int sockfd);
+    void handleWrite();
+    void handleError();
+    void handleTimeout();
+    void retry(int sockfd, int savedErrno);
+    int removeAndResetChannel();
+    void resetChannel();
+
+    EventLoop *loop_;
+    const InetAddress serverAddr_;
+    std::atomic_bool connect_;
+    std::atomic_int state_;
+    std::unique_ptr<Channel> channel_;
+    NewConnectionCallback newConnectionCallback_;
+    ConnectFailedCallback connectFailedCallback_;
+    int retryDelayMs_;
+    double connectTimeout_;
+    TimerId retryTimer_;
+    TimerId timeoutTimer_;
+};
+
+using ConnectorPtr = std::shared_ptr<Connector>;
@@ -38,7 +38,8 @@ Timestamp EPollPoller::poll(int timeoutMs, ChannelList *activeChannels) {
     Timestamp now(Timestamp::now());
 
     if (numEvents > 0) {
-        LOG_INFO("%d events happend \n", numEvents);
+        // 每次 epoll_wait 返回都会执行，用 DEBUG 级别
+        LOG_DEBUG("%d events happend \n", numEvents);
         fillActiveChannels(numEvents, activeChannels);
         //LOG_INFO("fillActiveChannels %s", __FUNCTION__);
         if (numEvents >= events_.size()){
@@ -66,7 +67,7 @@ void EPollPoller::updateChannel(Channel *channel) {
         // 新加入的channel
         if(index == kNew){
             int fd = channel->fd();
-            LOG_INFO("Adding new channel with fd=%d to channels_", fd); 
+            LOG_DEBUG("Adding new channel with fd=%d to channels_", fd);
             channels_[fd] = channel;
         }
         channel->set_index(kAdded);
@@ -2,6 +2,7 @@
 #include "Logger.h"
 #include "Poller.h"
 #include "Channel.h"
+#include "TimerQueue.h"
 
 #include <unistd.h>
 #include <fcntl.h>
@@ -34,7 +35,11 @@ EventLoop::EventLoop()
     , poller_(Poller::newDefaultPoller(this))
     , wakeupFd_(createEventfd())
     , wakeupChannel_(new Channel(this, wakeupFd_))
-    , currentActiveChannel_(nullptr){
+    , timerQueue_(new TimerQueue(this))
+    , currentActiveChannel_(nullptr)
+    , pendingFunctorsSize_(0)
+    , lagMicroSeconds_(0)
+    , iterationStart_(0){
         LOG_DEBUG("EventLoop created %p in thread %d \n", this, threadId_);
         if(t_loopInThisThread){
             LOG_FATAL("Another EventLoop %p exists in this thread %d \n", t_loopInThisThread, threadId_);
@@ -46,9 +51,11 @@ EventLoop::EventLoop()
         // wakeupChannel_是独占此channel的智能指针
         wakeupChannel_->setReadCallback(std::bind(&EventLoop::handleRead, this));
         wakeupChannel_->enableReading();
+        MetricsRegistry::instance().addLoop(this);
 }
 
 EventLoop::~EventLoop(){
+    MetricsRegistry::instance().removeLoop(this);
     wakeupChannel_->disableAll();
     wakeupChannel_->remove();
     // Close the file descriptor FD.
@@ -68,13 +75,33 @@ void EventLoop::loop(){
         activeChannels_.clear();
         // 监听两类fd, client 的 fd 和 wakeupfd --> mainloop 唤醒 subloop 用,
         // 调用 poller_ 的 poll 方法进行事件轮询
+        tracer_.begin(LoopTracer::kPoll);
         pollReturnTime_ = poller_->poll(kPollTimeMs, &activeChannels_);
+        tracer_.end(LoopTracer::kPoll);
+        // 本轮的回调都用这个时间，不必各自再取一次时钟
+        Timestamp::setCachedNow(pollReturnTime_);
+        iterationStart_.store(pollReturnTime_.microSecondsSinceEpoch(), std::memory_order_relaxed);
+        metrics_.pollEvents.observe(static_cast<int64_t>(activeChannels_.size()));
         for (Channel *channel : activeChannels_){
+            // 回调里 channel 可能被析构，先取出 fd 和 revents
+            const int fd = channel->fd();
+            const int revents = channel->revents();
+            tracer_.begin(LoopTracer::kChannel, fd, revents);
             channel->handleEvevnt(pollReturnTime_);
+            tracer_.end(LoopTracer::kChannel, fd, revents);
         }
         // 执行当前EventLoop事件循环需要处理的回调操作
         // mainLoop事先注册一个回调cb,wakeup subloop后,执行下面的方法(是mainLoop注册的cb)
         doPendingFunctors();
+
+        // 本轮耗时做指数平滑（1/8 权重），只有本线程写
+        int64_t lag = Timestamp::now() - pollReturnTime_;
+        int64_t smoothed = lagMicroSeconds_.load(std::memory_order_relaxed);
+        lagMicroSeconds_.store(smoothed + (lag - smoothed) / 8, std::memory_order_relaxed);
+        iterationStart_.store(0, std::memory_order_relaxed);
+        metrics_.iterations.add();
+        metrics_.iterationMicros.observe(lag);
+        tracer_.iterationFinished(lag, threadId_);
     }
     LOG_INFO("EventLoop %p stop looping \n", this);
     looping_ = false;
@@ -107,6 +134,7 @@ void EventLoop::queueInLoop(Functor cb){
     {
         std::unique_lock<std::mutex> lock(mutex_);
         pendingFunctors_.emplace_back(cb);
+        pendingFunctorsSize_.store(pendingFunctors_.size(), std::memory_order_relaxed);
     }
     // callingPendingFunctors_ = true 表示有新的回调要执行
     // 如果不加这个判断,事件循环在doPendingFunctors()之后又卡在poll上
@@ -117,12 +145,42 @@ void EventLoop::queueInLoop(Functor cb){
 
 
 
+TimerId EventLoop::runAt(Timestamp time, TimerCallback cb){
+    return timerQueue_->addTimer(std::move(cb), time, 0.0);
+}
+
+TimerId EventLoop::runAfter(double delay, TimerCallback cb){
+    Timestamp time(addTime(Timestamp::now(), delay));
+    return runAt(time, std::move(cb));
+}
+
+TimerId EventLoop::runEvery(double interval, TimerCallback cb){
+    Timestamp time(addTime(Timestamp::now(), interval));
+    return timerQueue_->addTimer(std::move(cb), time, interval);
+}
+
+void EventLoop::cancel(TimerId timerId){
+    timerQueue_->cancel(timerId);
+}
+
+int64_t EventLoop::loopLagMicroSeconds() const{
+    int64_t start = iterationStart_.load(std::memory_order_relaxed);
+    if(start == 0){
+        // 正在 epoll_wait 中等待事件，说明 loop 现在有空闲
+        return 0;
+    }
+    int64_t current = Timestamp::now().microSecondsSinceEpoch() - start;
+    int64_t smoothed = lagMicroSeconds_.load(std::memory_order_relaxed);
+    return current > smoothed ? current : smoothed;
+}
+
 void EventLoop::handleRead(){
     uint64_t one = 1;
     ssize_t n = read(wakeupFd_, &one, sizeof one);
     if (n != sizeof one){
         LOG_ERROR("EventLoop::handleRead() reads %ld bytes instead of 8", n);
     }
+    metrics_.wakeups.add();
 }
 
 // 通过向wakeupFd_写入数据，触发wakeupChannel_的可读事件，从而唤醒正在阻塞的事件循环
@@ -153,11 +211,15 @@ void EventLoop::doPendingFunctors(){
     {
         std::unique_lock<std::mutex> lock(mutex_);
         functors.swap(pendingFunctors_);
+        pendingFunctorsSize_.store(0, std::memory_order_relaxed);
     }
 
     for(const Functor &functor : functors){
         // 执行当前事件循环需要执行的回调操作
+        tracer_.begin(LoopTracer::kFunctor);
         functor();
+        tracer_.end(LoopTracer::kFunctor);
     }
+    metrics_.functors.add(static_cast<int64_t>(functors.size()));
     callingPendingFunctors_ = false;
 }
\ No newline at end of file
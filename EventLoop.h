@@ -2,6 +2,10 @@
 
 #include "CurrentThread.h"
 #include "Timestamp.h"
+#include "TimerId.h"
+#include "Callbacks.h"
+#include "Metrics.h"
+#include "LoopTracer.h"
 #include "noncopyable.h"
 #include <atomic>
 #include <functional>
@@ -11,6 +15,7 @@
 
 class Channel;
 class Poller;
+class TimerQueue;
 
 // include channel poller(epoll的抽象)
 class EventLoop {
@@ -25,6 +30,7 @@ public:
   // 退出事件循环
   void quit();
 
+  // 本轮 epoll_wait 返回的时间，也是本线程 Timestamp::cachedNow() 的值
   Timestamp pollReturnTime() const { return pollReturnTime_; }
 
   // 在当前loop中执行cb
@@ -35,6 +41,35 @@ public:
   // 唤醒loop所在线程
   void wakeup();
 
+  // 定时器，可跨线程调用，回调在 loop 线程中执行
+  // 在 time 时刻执行 cb
+  TimerId runAt(Timestamp time, TimerCallback cb);
+  // delay 秒之后执行 cb
+  TimerId runAfter(double delay, TimerCallback cb);
+  // 每隔 interval 秒执行一次 cb
+  TimerId runEvery(double interval, TimerCallback cb);
+  void cancel(TimerId timerId);
+
+  // loop 的延迟，单位微秒，可跨线程读取，用于判断 loop 是否过载：
+  // 取平滑后的每轮迭代耗时（从 epoll_wait 返回到事件回调和 pendingFunctors_ 都执行完）
+  // 与当前这一轮已经执行的时间中较大的一个；正阻塞在 epoll_wait 中时为 0
+  int64_t loopLagMicroSeconds() const;
+  // 等待执行的回调个数，可跨线程读取
+  size_t queueSize() const {
+    return pendingFunctorsSize_.load(std::memory_order_relaxed);
+  }
+
+  // 本 loop 的运行指标，只能在 loop 线程中更新，任意线程可读，见 MetricsRegistry
+  LoopMetrics& metrics() { return metrics_; }
+  const LoopMetrics& metrics() const { return metrics_; }
+  pid_t threadId() const { return threadId_; }
+  // 是否正在 loop() 中，任意线程可读
+  bool looping() const { return looping_; }
+  // 本 loop 的事件追踪（poll、Channel 分发、pendingFunctors_），默认开启；
+  // 任意线程可导出，慢迭代自动导出用 tracer().setSlowIterationDump()（在 loop 线程中调用）
+  LoopTracer& tracer() { return tracer_; }
+  const LoopTracer& tracer() const { return tracer_; }
+
   // EventLoop的方法->Poller的方法
   void updateChannel(Channel *channel);
   void removeChannel(Channel *channel);
@@ -58,6 +93,7 @@ private:
 
   int wakeupFd_; // 当mainLoop获取一个新用户的channel，通过轮询算法选择一个subloop,通过该成员唤醒subloop处理channel
   std::unique_ptr<Channel> wakeupChannel_;
+  std::unique_ptr<TimerQueue> timerQueue_;
 
   ChannelList activeChannels_;
   Channel *currentActiveChannel_;
@@ -66,4 +102,10 @@ private:
       callingPendingFunctors_; // 标识当前loop是否有需要执行的回调操作
   std::vector<Functor> pendingFunctors_; // 存储loop需要执行的所以回调操作
   std::mutex mutex_; // 互斥锁，保护上面vector容器的线程安全操作
+  std::atomic<size_t> pendingFunctorsSize_; // 在 mutex_ 内更新，供其他线程无锁读取
+  std::atomic<int64_t> lagMicroSeconds_;
+  std::atomic<int64_t> iterationStart_; // 本轮 epoll_wait 返回的时间，阻塞在 epoll_wait 中时为 0
+
+  LoopMetrics metrics_;
+  LoopTracer tracer_;
 };
\ No newline at end of file
@@ -4,18 +4,15 @@
 EventLoopThreadPool::EventLoopThreadPool(EventLoop *baseLoop,
                                          const std::string &nameArg)
     : baseLoop_(baseLoop), name_(nameArg), started_(false), numThreads_(0),
-      next_(0) {}
+      next_(0), nextThreadIndex_(0) {}
 
 EventLoopThreadPool::~EventLoopThreadPool() {}
 
 void EventLoopThreadPool::start(const ThreadInitCallback &cb) {
   started_ = true;
+  threadInitCallback_ = cb;
   for (int i = 0; i < numThreads_; ++i) {
-    // char buf[name_.size() + 32];
-    // snprintf(buf, sizeof buf, "%s%d", name_.c_str(), i);
-    std::string threadName = name_ + std::to_string(i);
-    EventLoopThread *t = new EventLoopThread(cb, threadName.c_str());
-    threads_.push_back(std::unique_ptr<EventLoopThread>(t));
+    EventLoopThread *t = newThread();
     // startLoop创建事件循环，并返回指向该事件循环的指针
     loops_.push_back(t->startLoop());
   }
@@ -27,6 +24,39 @@ void EventLoopThreadPool::start(const ThreadInitCallback &cb) {
   }
 }
 
+EventLoopThread *EventLoopThreadPool::newThread() {
+  // char buf[name_.size() + 32];
+  // snprintf(buf, sizeof buf, "%s%d", name_.c_str(), i);
+  std::string threadName = name_ + std::to_string(nextThreadIndex_++);
+  EventLoopThread *t = new EventLoopThread(threadInitCallback_, threadName.c_str());
+  threads_.push_back(std::unique_ptr<EventLoopThread>(t));
+  return t;
+}
+
+EventLoop *EventLoopThreadPool::addLoop() {
+  // startLoop 会等新线程里的 loop 构造完成，阻塞 baseloop 的时间是创建一个线程
+  EventLoop *loop = newThread()->startLoop();
+  loops_.push_back(loop);
+  numThreads_ = static_cast<int>(loops_.size());
+  return loop;
+}
+
+std::unique_ptr<EventLoopThread> EventLoopThreadPool::removeLoop(EventLoop *loop) {
+  std::unique_ptr<EventLoopThread> thread;
+  for (size_t i = 0; i < loops_.size(); ++i) {
+    if (loops_[i] == loop) {
+      thread = std::move(threads_[i]);
+      threads_.erase(threads_.begin() + i);
+      loops_.erase(loops_.begin() + i);
+      break;
+    }
+  }
+  if (next_ >= static_cast<int>(loops_.size())) {
+    next_ = 0;
+  }
+  numThreads_ = static_cast<int>(loops_.size());
+  return thread;
+}
 
 EventLoop *EventLoopThreadPool::getNextLoop() {
   // 如果没有设置多个线程，只有主线程，返回的loop就是主线程
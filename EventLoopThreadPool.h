@@ -23,16 +23,29 @@ public:
 
     std::vector<EventLoop*> getAllLoops();
 
+    // start() 之后在运行中增减 subloop，都只能在 baseLoop_ 线程中调用（和 getNextLoop 同一线程）
+    // 新建一个 subloop 加入轮转，用 start() 时的 ThreadInitCallback 初始化
+    EventLoop* addLoop();
+    // 把 loop 移出轮转，之后 getNextLoop 不再返回它；返回它的线程，
+    // 调用者清理完 loop 上的对象后析构返回值，即退出 loop 并 join。loop 不在池中时返回空
+    std::unique_ptr<EventLoopThread> removeLoop(EventLoop *loop);
+    // 当前参与轮转的 subloop 个数
+    int numLoops() const { return static_cast<int>(loops_.size()); }
+
     bool started() const { return started_; }
     const std::string name() const { return name_; }
 
 
 private:
+    EventLoopThread* newThread();
+
     EventLoop *baseLoop_;
     std::string name_;
     bool started_;
     int numThreads_;
     int next_;
+    int nextThreadIndex_; // 线程名的序号，移除 loop 后不复用
+    ThreadInitCallback threadInitCallback_;
     std::vector<std::unique_ptr<EventLoopThread>> threads_;
-    std::vector<EventLoop*> loops_;
+    std::vector<EventLoop*> loops_; // 与 threads_ 一一对应
 };
\ No newline at end of file
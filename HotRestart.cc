@@ -0,0 +1,293 @@
+#include "HotRestart.h"
+#include "Channel.h"
+#include "EventLoop.h"
+#include "InetAddress.h"
+#include "Logger.h"
+#include "Socket.h"
+#include "TcpServer.h"
+
+#include <errno.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+// 新进程 -> 旧进程：索要监听 fd
+const char kRequestFds = 'Q';
+// 新进程 -> 旧进程：已经开始服务，旧进程可以停止 accept
+const char kTakeoverDone = 'A';
+
+const int kMaxFds = 64;
+
+bool fillUnixAddr(const std::string &path, sockaddr_un *addr) {
+    bzero(addr, sizeof *addr);
+    addr->sun_family = AF_UNIX;
+    if (path.size() >= sizeof addr->sun_path) {
+        LOG_ERROR("HotRestart socket path too long: %s\n", path.c_str());
+        return false;
+    }
+    strncpy(addr->sun_path, path.c_str(), sizeof addr->sun_path - 1);
+    return true;
+}
+
+// 一次 sendmsg 带上所有 fd，正文是 fd 的个数
+bool sendFds(int sockfd, const std::vector<int> &fds) {
+    uint32_t count = static_cast<uint32_t>(fds.size());
+    iovec iov;
+    iov.iov_base = &count;
+    iov.iov_len = sizeof count;
+
+    char control[CMSG_SPACE(sizeof(int) * kMaxFds)];
+    bzero(control, sizeof control);
+    msghdr msg;
+    bzero(&msg, sizeof msg);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    if (!fds.empty()) {
+        msg.msg_control = control;
+        msg.msg_controllen = CMSG_SPACE(sizeof(int) * fds.size());
+        cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int) * fds.size());
+        memcpy(CMSG_DATA(cmsg), fds.data(), sizeof(int) * fds.size());
+    }
+    return ::sendmsg(sockfd, &msg, MSG_NOSIGNAL) == static_cast<ssize_t>(sizeof count);
+}
+
+bool recvFds(int sockfd, std::vector<int> *fds) {
+    uint32_t count = 0;
+    iovec iov;
+    iov.iov_base = &count;
+    iov.iov_len = sizeof count;
+
+    char control[CMSG_SPACE(sizeof(int) * kMaxFds)];
+    msghdr msg;
+    bzero(&msg, sizeof msg);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof control;
+
+    ssize_t n = ::recvmsg(sockfd, &msg, MSG_CMSG_CLOEXEC);
+    if (n != static_cast<ssize_t>(sizeof count)) {
+        return false;
+    }
+    for (cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+            size_t num = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            const int *data = reinterpret_cast<const int*>(CMSG_DATA(cmsg));
+            fds->insert(fds->end(), data, data + num);
+        }
+    }
+    if (msg.msg_flags & MSG_CTRUNC) {
+        LOG_ERROR("HotRestart received truncated fd list\n");
+    }
+    return fds->size() == count;
+}
+
+} // namespace
+
+HotRestart::HotRestart(EventLoop *loop, const std::string &socketPath)
+    : loop_(loop)
+    , socketPath_(socketPath)
+    , inheritSocket_(-1)
+    , listenFd_(-1)
+    , peerFd_(-1)
+    , fdsSent_(false)
+{
+}
+
+HotRestart::~HotRestart() {
+    if (inheritSocket_ >= 0) {
+        ::close(inheritSocket_);
+    }
+    for (int fd : inheritedFds_) {
+        ::close(fd);
+    }
+    if (peerChannel_) {
+        peerChannel_->disableAll();
+        peerChannel_->remove();
+        ::close(peerFd_);
+    }
+    if (listenChannel_) {
+        listenChannel_->disableAll();
+        listenChannel_->remove();
+        ::close(listenFd_);
+    }
+}
+
+bool HotRestart::inheritListenFds() {
+    sockaddr_un addr;
+    if (!fillUnixAddr(socketPath_, &addr)) {
+        return false;
+    }
+    int sockfd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (sockfd < 0) {
+        LOG_ERROR("HotRestart socket err:%d\n", errno);
+        return false;
+    }
+    if (::connect(sockfd, (sockaddr*)&addr, sizeof addr) < 0) {
+        // 没有正在运行的旧进程，正常 bind 即可
+        LOG_INFO("HotRestart no running process on %s\n", socketPath_.c_str());
+        ::close(sockfd);
+        return false;
+    }
+
+    // 启动阶段，阻塞等待旧进程回复，但不能无限等下去
+    timeval tv;
+    tv.tv_sec = 5;
+    tv.tv_usec = 0;
+    ::setsockopt(sockfd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof tv);
+    ::setsockopt(sockfd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof tv);
+
+    std::vector<int> fds;
+    if (::write(sockfd, &kRequestFds, 1) != 1 || !recvFds(sockfd, &fds)) {
+        LOG_ERROR("HotRestart failed to receive listen fds from %s\n", socketPath_.c_str());
+        for (int fd : fds) {
+            ::close(fd);
+        }
+        ::close(sockfd);
+        return false;
+    }
+    LOG_INFO("HotRestart inherited %lu listen fds\n", static_cast<unsigned long>(fds.size()));
+    inheritSocket_ = sockfd;
+    inheritedFds_.insert(inheritedFds_.end(), fds.begin(), fds.end());
+    return true;
+}
+
+int HotRestart::takeListenFd(const InetAddress &listenAddr) {
+    std::string wanted = listenAddr.toIpPort();
+    for (auto it = inheritedFds_.begin(); it != inheritedFds_.end(); ++it) {
+        if (sockets::getLocalAddr(*it).toIpPort() == wanted) {
+            int fd = *it;
+            inheritedFds_.erase(it);
+            return fd;
+        }
+    }
+    return -1;
+}
+
+void HotRestart::confirmTakeover() {
+    if (inheritSocket_ < 0) {
+        return;
+    }
+    if (::write(inheritSocket_, &kTakeoverDone, 1) != 1) {
+        LOG_ERROR("HotRestart confirmTakeover err:%d\n", errno);
+    }
+    ::close(inheritSocket_);
+    inheritSocket_ = -1;
+    // 没有被任何 server 取走的 fd 不再需要
+    for (int fd : inheritedFds_) {
+        ::close(fd);
+    }
+    inheritedFds_.clear();
+}
+
+void HotRestart::addServer(TcpServer *server) {
+    servers_.push_back(server);
+}
+
+void HotRestart::listen(const TakeoverCallback &cb) {
+    takeoverCallback_ = cb;
+
+    sockaddr_un addr;
+    if (!fillUnixAddr(socketPath_, &addr)) {
+        return;
+    }
+    // 旧进程的 socket 文件由接替它的进程覆盖
+    ::unlink(socketPath_.c_str());
+    listenFd_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listenFd_ < 0 ||
+        ::bind(listenFd_, (sockaddr*)&addr, sizeof addr) < 0 ||
+        ::listen(listenFd_, 4) < 0) {
+        LOG_ERROR("HotRestart listen on %s err:%d\n", socketPath_.c_str(), errno);
+        if (listenFd_ >= 0) {
+            ::close(listenFd_);
+            listenFd_ = -1;
+        }
+        return;
+    }
+    listenChannel_.reset(new Channel(loop_, listenFd_));
+    listenChannel_->setReadCallback(std::bind(&HotRestart::handleAccept, this));
+    listenChannel_->enableReading();
+}
+
+void HotRestart::handleAccept() {
+    int connfd = ::accept4(listenFd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (connfd < 0) {
+        LOG_ERROR("HotRestart accept err:%d\n", errno);
+        return;
+    }
+    if (peerFd_ >= 0) {
+        // 同一时间只交接给一个新进程
+        LOG_ERROR("HotRestart takeover already in progress\n");
+        ::close(connfd);
+        return;
+    }
+    peerFd_ = connfd;
+    fdsSent_ = false;
+    peerChannel_.reset(new Channel(loop_, peerFd_));
+    peerChannel_->setReadCallback(std::bind(&HotRestart::handlePeerRead, this));
+    peerChannel_->enableReading();
+}
+
+void HotRestart::handlePeerRead() {
+    char buf[16];
+    ssize_t n = ::read(peerFd_, buf, sizeof buf);
+    if (n <= 0) {
+        if (n < 0 && errno == EAGAIN) {
+            return;
+        }
+        // 新进程没有确认就退出了，继续由本进程服务
+        LOG_ERROR("HotRestart new process went away before takeover\n");
+        closePeer();
+        return;
+    }
+    for (ssize_t i = 0; i < n; ++i) {
+        if (buf[i] == kRequestFds) {
+            std::vector<int> fds;
+            for (TcpServer *server : servers_) {
+                fds.push_back(server->listenFd());
+            }
+            if (!sendFds(peerFd_, fds)) {
+                LOG_ERROR("HotRestart sendFds err:%d\n", errno);
+                closePeer();
+                return;
+            }
+            fdsSent_ = true;
+            LOG_INFO("HotRestart sent %lu listen fds\n", static_cast<unsigned long>(fds.size()));
+        } else if (buf[i] == kTakeoverDone && fdsSent_) {
+            LOG_INFO("HotRestart takeover confirmed, stop accepting\n");
+            for (TcpServer *server : servers_) {
+                server->handOffListenFd();
+            }
+            closePeer();
+            // 后续的重启由新进程负责
+            listenChannel_->disableAll();
+            listenChannel_->remove();
+            ::close(listenFd_);
+            listenFd_ = -1;
+            std::shared_ptr<Channel> listenChannel(listenChannel_.release());
+            loop_->queueInLoop([listenChannel]() {});
+            if (takeoverCallback_) {
+                takeoverCallback_();
+            }
+            return;
+        }
+    }
+}
+
+void HotRestart::closePeer() {
+    peerChannel_->disableAll();
+    peerChannel_->remove();
+    ::close(peerFd_);
+    peerFd_ = -1;
+    // 可能正处在 peerChannel_ 自己的回调里，延后到本轮事件处理完再销毁
+    std::shared_ptr<Channel> peerChannel(peerChannel_.release());
+    loop_->queueInLoop([peerChannel]() {});
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "noncopyable.h"
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+class Channel;
+class EventLoop;
+class InetAddress;
+class TcpServer;
+
+// 零停机热重启：新进程通过 Unix 域套接字向旧进程索要监听 fd（SCM_RIGHTS），
+// 直接接管而不重新 bind；新进程确认开始服务后，旧进程停止 accept 并排空已有连接。
+// 监听 socket 始终没有关闭，重启期间到来的连接留在内核的 accept 队列里，不会被拒绝。
+//
+// 新进程：
+//   HotRestart restart(&loop, "/run/server.sock");
+//   restart.inheritListenFds();              // 没有旧进程时什么也不做
+//   int fd = restart.takeListenFd(addr);
+//   std::unique_ptr<TcpServer> server(fd >= 0 ? new TcpServer(&loop, fd, name)
+//                                             : new TcpServer(&loop, addr, name));
+//   server->start();
+//   restart.confirmTakeover();               // 通知旧进程停止 accept
+//   restart.addServer(server.get());
+//   restart.listen([&]{ server->gracefulStop([&]{ loop.quit(); }); });
+class HotRestart : noncopyable {
+public:
+    // 旧进程交出监听 fd 并得到新进程确认后调用，在 loop 线程中执行
+    using TakeoverCallback = std::function<void()>;
+
+    HotRestart(EventLoop *loop, const std::string &socketPath);
+    ~HotRestart();
+
+    // 新进程：连接旧进程取回所有监听 fd，没有旧进程或交接失败时返回 false
+    bool inheritListenFds();
+    // 新进程：取出与 listenAddr 匹配的继承 fd，交给 TcpServer；没有匹配时返回 -1
+    int takeListenFd(const InetAddress &listenAddr);
+    // 新进程：已经在继承的 fd 上开始服务，通知旧进程停止 accept
+    void confirmTakeover();
+
+    // 登记可交接的 server，下一个新进程来取时一并交出它们的监听 fd
+    void addServer(TcpServer *server);
+    // 在 socketPath 上等待下一个新进程
+    void listen(const TakeoverCallback &cb);
+
+private:
+    void handleAccept();
+    void handlePeerRead();
+    void closePeer();
+
+    EventLoop *loop_;
+    const std::string socketPath_;
+
+    // 新进程一侧
+    int inheritSocket_; // 与旧进程的连接，confirmTakeover 后关闭
+    std::vector<int> inheritedFds_;
+
+    // 旧进程一侧
+    std::vector<TcpServer*> servers_;
+    TakeoverCallback takeoverCallback_;
+    int listenFd_;
+    std::unique_ptr<Channel> listenChannel_;
+    int peerFd_; // 正在交接的新进程
+    std::unique_ptr<Channel> peerChannel_;
+    bool fdsSent_;
+};
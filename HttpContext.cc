@@ -0,0 +1,322 @@
+#include "HttpContext.h"
+#include "Buffer.h"
+
+#include <string.h>
+
+namespace {
+
+struct MethodEntry {
+    const char *name;
+    size_t length;
+    HttpRequest::Method method;
+};
+
+const MethodEntry kMethods[] = {
+    { "GET", 3, HttpRequest::kGet },
+    { "POST", 4, HttpRequest::kPost },
+    { "HEAD", 4, HttpRequest::kHead },
+    { "PUT", 3, HttpRequest::kPut },
+    { "DELETE", 6, HttpRequest::kDelete },
+    { "OPTIONS", 7, HttpRequest::kOptions },
+    { "PATCH", 5, HttpRequest::kPatch },
+};
+
+bool isSpace(char c) {
+    return c == ' ' || c == '\t';
+}
+
+StringPiece trim(const char *begin, const char *end) {
+    while (begin < end && isSpace(*begin)) {
+        ++begin;
+    }
+    while (end > begin && isSpace(end[-1])) {
+        --end;
+    }
+    return StringPiece(begin, end - begin);
+}
+
+// 严格的十进制/十六进制解析，溢出或含非法字符时返回 false
+bool parseSize(const StringPiece &s, int base, size_t *value) {
+    if (s.empty() || s.size() > 16) {
+        return false;
+    }
+    size_t n = 0;
+    for (char c : s) {
+        int digit;
+        if (c >= '0' && c <= '9') {
+            digit = c - '0';
+        } else if (base == 16 && c >= 'a' && c <= 'f') {
+            digit = c - 'a' + 10;
+        } else if (base == 16 && c >= 'A' && c <= 'F') {
+            digit = c - 'A' + 10;
+        } else {
+            return false;
+        }
+        n = n * base + digit;
+    }
+    *value = n;
+    return true;
+}
+
+} // namespace
+
+HttpContext::HttpContext(size_t maxHeaderBytes, size_t maxBodyBytes)
+    : maxHeaderBytes_(maxHeaderBytes)
+    , maxBodyBytes_(maxBodyBytes)
+    , closing_(false)
+{
+    reset();
+}
+
+void HttpContext::reset() {
+    state_ = kExpectRequestLine;
+    pos_ = 0;
+    errorCode_ = HttpResponse::kUnknown;
+    method_ = path_ = query_ = body_ = Span{0, 0};
+    headers_.clear();
+    hasContentLength_ = false;
+    contentLength_ = 0;
+    chunked_ = false;
+    connectionClose_ = false;
+    connectionKeepAlive_ = false;
+    chunkRemaining_ = 0;
+    chunkedBody_.clear();
+}
+
+HttpContext::ParseResult HttpContext::fail(HttpResponse::StatusCode code) {
+    errorCode_ = code;
+    return kError;
+}
+
+HttpContext::ParseResult HttpContext::parse(const Buffer *buf, Timestamp receiveTime) {
+    const char *base = buf->peek();
+    const size_t readable = buf->readableBytes();
+
+    while (true) {
+        switch (state_)
+        {
+        case kExpectRequestLine:
+        case kExpectHeaders:
+        case kExpectChunkTrailer: {
+            const char *crlf = buf->findCRLF(base + pos_);
+            // 请求行和头部一起受 maxHeaderBytes_ 限制，分块编码的 trailer 单独受同样的限制，
+            // 防止慢速发送的超长头部撑大缓冲区
+            size_t lineEnd = crlf ? crlf - base : readable;
+            size_t limitFrom = state_ == kExpectChunkTrailer ? body_.offset : 0;
+            if (lineEnd - limitFrom > maxHeaderBytes_) {
+                return fail(HttpResponse::k431HeaderFieldsTooLarge);
+            }
+            if (crlf == nullptr) {
+                return kNeedMore;
+            }
+            const char *line = base + pos_;
+            pos_ = crlf + 2 - base;
+            if (state_ == kExpectRequestLine) {
+                // 请求之间多余的空行忽略掉（RFC 7230 3.5）
+                if (crlf == line) {
+                    continue;
+                }
+                if (!parseRequestLine(base, line, crlf)) {
+                    return kError;
+                }
+                state_ = kExpectHeaders;
+            } else if (state_ == kExpectHeaders) {
+                if (crlf == line) {
+                    if (!headersComplete()) {
+                        return kError;
+                    }
+                } else if (!parseHeader(base, line, crlf)) {
+                    return kError;
+                }
+            } else {
+                // trailer 的内容不关心，空行表示请求结束
+                if (crlf == line) {
+                    state_ = kGotAll;
+                }
+            }
+            break;
+        }
+        case kExpectBody:
+            if (readable - pos_ < contentLength_) {
+                return kNeedMore;
+            }
+            body_ = Span{pos_, contentLength_};
+            pos_ += contentLength_;
+            state_ = kGotAll;
+            break;
+        case kExpectChunkSize: {
+            const char *crlf = buf->findCRLF(base + pos_);
+            if (crlf == nullptr) {
+                // 分块大小行不会很长
+                if (readable - pos_ > 64) {
+                    return fail(HttpResponse::k400BadRequest);
+                }
+                return kNeedMore;
+            }
+            const char *line = base + pos_;
+            // 忽略分块扩展 ";name=value"
+            const char *semicolon = static_cast<const char*>(memchr(line, ';', crlf - line));
+            size_t size = 0;
+            if (!parseSize(trim(line, semicolon ? semicolon : crlf), 16, &size)) {
+                return fail(HttpResponse::k400BadRequest);
+            }
+            if (size > maxBodyBytes_ - chunkedBody_.size()) {
+                return fail(HttpResponse::k413PayloadTooLarge);
+            }
+            pos_ = crlf + 2 - base;
+            chunkRemaining_ = size;
+            if (size == 0) {
+                // 分块编码的 body 在 chunkedBody_ 里，body_ 用来记录 trailer 的起点
+                body_.offset = pos_;
+                state_ = kExpectChunkTrailer;
+            } else {
+                state_ = kExpectChunkData;
+            }
+            break;
+        }
+        case kExpectChunkData:
+            if (readable - pos_ < chunkRemaining_ + 2) {
+                return kNeedMore;
+            }
+            if (base[pos_ + chunkRemaining_] != '\r' || base[pos_ + chunkRemaining_ + 1] != '\n') {
+                return fail(HttpResponse::k400BadRequest);
+            }
+            chunkedBody_.append(base + pos_, chunkRemaining_);
+            pos_ += chunkRemaining_ + 2;
+            state_ = kExpectChunkSize;
+            break;
+        case kGotAll:
+            bindRequest(base, receiveTime);
+            return kGotRequest;
+        }
+    }
+}
+
+bool HttpContext::parseRequestLine(const char *base, const char *begin, const char *end) {
+    const char *space = static_cast<const char*>(memchr(begin, ' ', end - begin));
+    if (space == nullptr) {
+        fail(HttpResponse::k400BadRequest);
+        return false;
+    }
+    request_.method_ = HttpRequest::kInvalid;
+    for (const MethodEntry &entry : kMethods) {
+        if (entry.length == static_cast<size_t>(space - begin) &&
+            memcmp(entry.name, begin, entry.length) == 0) {
+            request_.method_ = entry.method;
+            break;
+        }
+    }
+    if (request_.method_ == HttpRequest::kInvalid) {
+        fail(HttpResponse::k501NotImplemented);
+        return false;
+    }
+    method_ = Span{static_cast<size_t>(begin - base), static_cast<size_t>(space - begin)};
+
+    const char *target = space + 1;
+    space = static_cast<const char*>(memchr(target, ' ', end - target));
+    if (space == nullptr || space == target) {
+        fail(HttpResponse::k400BadRequest);
+        return false;
+    }
+    const char *question = static_cast<const char*>(memchr(target, '?', space - target));
+    const char *pathEnd = question ? question : space;
+    path_ = Span{static_cast<size_t>(target - base), static_cast<size_t>(pathEnd - target)};
+    if (question) {
+        query_ = Span{static_cast<size_t>(question + 1 - base), static_cast<size_t>(space - question - 1)};
+    }
+
+    StringPiece version(space + 1, end - space - 1);
+    if (version == "HTTP/1.1") {
+        request_.version_ = HttpRequest::kHttp11;
+    } else if (version == "HTTP/1.0") {
+        request_.version_ = HttpRequest::kHttp10;
+    } else {
+        fail(HttpResponse::k400BadRequest);
+        return false;
+    }
+    return true;
+}
+
+bool HttpContext::parseHeader(const char *base, const char *begin, const char *end) {
+    const char *colon = static_cast<const char*>(memchr(begin, ':', end - begin));
+    // 不支持已废弃的折行（obs-fold），名字中也不允许有空白
+    if (colon == nullptr || colon == begin || isSpace(*begin) || isSpace(colon[-1])) {
+        fail(HttpResponse::k400BadRequest);
+        return false;
+    }
+    StringPiece name(begin, colon - begin);
+    StringPiece value = trim(colon + 1, end);
+    headers_.push_back(std::make_pair(
+        Span{static_cast<size_t>(begin - base), name.size()},
+        Span{static_cast<size_t>(value.data() - base), value.size()}));
+
+    // 决定 body 长度和连接去留的头部在这里就提取出来
+    if (name.equalsIgnoreCase("Content-Length")) {
+        size_t length = 0;
+        if (!parseSize(value, 10, &length) ||
+            (hasContentLength_ && length != contentLength_)) {
+            fail(HttpResponse::k400BadRequest);
+            return false;
+        }
+        hasContentLength_ = true;
+        contentLength_ = length;
+    } else if (name.equalsIgnoreCase("Transfer-Encoding")) {
+        // 只支持 chunked 作为最后一种编码
+        StringPiece last = value;
+        const char *comma = static_cast<const char*>(memrchr(value.data(), ',', value.size()));
+        if (comma) {
+            last = trim(comma + 1, value.end());
+        }
+        if (!last.equalsIgnoreCase("chunked")) {
+            fail(HttpResponse::k501NotImplemented);
+            return false;
+        }
+        chunked_ = true;
+    } else if (name.equalsIgnoreCase("Connection")) {
+        connectionClose_ = connectionClose_ || HttpRequest::containsToken(value, "close");
+        connectionKeepAlive_ = connectionKeepAlive_ || HttpRequest::containsToken(value, "keep-alive");
+    }
+    return true;
+}
+
+bool HttpContext::headersComplete() {
+    if (request_.version_ == HttpRequest::kHttp11) {
+        request_.keepAlive_ = !connectionClose_;
+    } else {
+        request_.keepAlive_ = connectionKeepAlive_ && !connectionClose_;
+    }
+    if (chunked_) {
+        // 同时带 Content-Length 的请求可能是请求走私，以分块编码为准，处理完后关闭连接
+        if (hasContentLength_) {
+            request_.keepAlive_ = false;
+        }
+        state_ = kExpectChunkSize;
+    } else if (contentLength_ > 0) {
+        if (contentLength_ > maxBodyBytes_) {
+            fail(HttpResponse::k413PayloadTooLarge);
+            return false;
+        }
+        state_ = kExpectBody;
+    } else {
+        state_ = kGotAll;
+    }
+    return true;
+}
+
+void HttpContext::bindRequest(const char *base, Timestamp receiveTime) {
+    request_.methodString_ = StringPiece(base + method_.offset, method_.length);
+    request_.path_ = StringPiece(base + path_.offset, path_.length);
+    request_.query_ = StringPiece(base + query_.offset, query_.length);
+    request_.headers_.clear();
+    for (const auto &header : headers_) {
+        request_.headers_.push_back(std::make_pair(
+            StringPiece(base + header.first.offset, header.first.length),
+            StringPiece(base + header.second.offset, header.second.length)));
+    }
+    if (chunked_) {
+        request_.body_ = StringPiece(chunkedBody_);
+    } else {
+        request_.body_ = StringPiece(base + body_.offset, body_.length);
+    }
+    request_.receiveTime_ = receiveTime;
+}
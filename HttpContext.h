@@ -0,0 +1,92 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "HttpRequest.h"
+#include "HttpResponse.h"
+#include "Timestamp.h"
+
+#include <stddef.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+class Buffer;
+
+// 每个连接一个的 HTTP/1.x 请求解析器，增量解析，不拷贝报文。
+// 解析时不从 Buffer 中取走数据，只记录各字段相对 peek() 的偏移，
+// 期间 Buffer 扩容或搬移数据都不影响；整个请求到齐后才把偏移换成指向 Buffer 的 StringPiece。
+// 调用方处理完请求后 retrieve(requestBytes()) 并 reset()，Buffer 中剩下的就是流水线里的下一个请求。
+class HttpContext : noncopyable {
+public:
+    enum ParseResult {
+        kNeedMore,   // 请求还不完整
+        kGotRequest, // request() 可用
+        kError,      // 报文非法或超限，应回复 errorCode() 并关闭连接
+    };
+
+    HttpContext(size_t maxHeaderBytes, size_t maxBodyBytes);
+
+    ParseResult parse(const Buffer *buf, Timestamp receiveTime);
+
+    const HttpRequest& request() const { return request_; }
+    // 当前请求在 Buffer 中占用的字节数，kGotRequest 之后有效
+    size_t requestBytes() const { return pos_; }
+    HttpResponse::StatusCode errorCode() const { return errorCode_; }
+
+    // 准备解析下一个请求，保留各个 vector/string 的容量
+    void reset();
+
+    // 连接已经决定关闭，之后收到的数据直接丢弃
+    void setClosing() { closing_ = true; }
+    bool closing() const { return closing_; }
+
+private:
+    enum State {
+        kExpectRequestLine,
+        kExpectHeaders,
+        kExpectBody,
+        kExpectChunkSize,
+        kExpectChunkData,
+        kExpectChunkTrailer,
+        kGotAll,
+    };
+    // 相对 Buffer::peek() 的一段数据
+    struct Span {
+        size_t offset;
+        size_t length;
+    };
+
+    bool parseRequestLine(const char *base, const char *begin, const char *end);
+    bool parseHeader(const char *base, const char *begin, const char *end);
+    // 头部结束，确定 body 的读法，失败时设置 errorCode_
+    bool headersComplete();
+    void bindRequest(const char *base, Timestamp receiveTime);
+    ParseResult fail(HttpResponse::StatusCode code);
+
+    const size_t maxHeaderBytes_;
+    const size_t maxBodyBytes_;
+
+    State state_;
+    size_t pos_; // 已解析到的位置，相对 peek()
+    HttpResponse::StatusCode errorCode_;
+    bool closing_;
+
+    Span method_;
+    Span path_;
+    Span query_;
+    std::vector<std::pair<Span, Span>> headers_;
+    Span body_;
+
+    // 从头部中提取的信息
+    bool hasContentLength_;
+    size_t contentLength_;
+    bool chunked_;
+    bool connectionClose_;
+    bool connectionKeepAlive_;
+
+    size_t chunkRemaining_;
+    // 分块编码的 body 需要去掉分块标记拼接起来，是唯一需要拷贝的情况
+    std::string chunkedBody_;
+
+    HttpRequest request_;
+};
@@ -0,0 +1,24 @@
+#include "HttpRequest.h"
+
+#include <string.h>
+
+bool HttpRequest::containsToken(const StringPiece &list, const StringPiece &token) {
+    const char *p = list.begin();
+    while (p < list.end()) {
+        const char *comma = static_cast<const char*>(memchr(p, ',', list.end() - p));
+        const char *next = comma ? comma : list.end();
+        const char *begin = p;
+        const char *end = next;
+        while (begin < end && (*begin == ' ' || *begin == '\t')) {
+            ++begin;
+        }
+        while (end > begin && (end[-1] == ' ' || end[-1] == '\t')) {
+            --end;
+        }
+        if (StringPiece(begin, end - begin).equalsIgnoreCase(token)) {
+            return true;
+        }
+        p = next + 1;
+    }
+    return false;
+}
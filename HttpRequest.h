@@ -0,0 +1,82 @@
+#pragma once
+
+#include "StringPiece.h"
+#include "Timestamp.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+// 一个已经解析完的 HTTP 请求，由 HttpContext 填充。
+// 除了分块编码的 body，所有 StringPiece 都直接指向连接 inputBuffer_ 中的原始报文，
+// 只在 HttpServer::HttpCallback 执行期间有效，需要保留时用 toString() 拷贝。
+class HttpRequest {
+public:
+    enum Method {
+        kInvalid,
+        kGet,
+        kPost,
+        kHead,
+        kPut,
+        kDelete,
+        kOptions,
+        kPatch,
+    };
+    enum Version {
+        kUnknown,
+        kHttp10,
+        kHttp11,
+    };
+    using Header = std::pair<StringPiece, StringPiece>;
+
+    HttpRequest()
+        : method_(kInvalid)
+        , version_(kUnknown)
+        , keepAlive_(false)
+    {}
+
+    Method method() const { return method_; }
+    StringPiece methodString() const { return methodString_; }
+    Version version() const { return version_; }
+    // 请求目标中 '?' 之前的部分
+    StringPiece path() const { return path_; }
+    // '?' 之后的部分，不含 '?'
+    StringPiece query() const { return query_; }
+
+    // 按出现顺序排列，名字保留原始大小写
+    const std::vector<Header>& headers() const { return headers_; }
+    // 名字大小写不敏感，没有时返回空
+    StringPiece header(const StringPiece &name) const {
+        for (const Header &h : headers_) {
+            if (h.first.equalsIgnoreCase(name)) {
+                return h.second;
+            }
+        }
+        return StringPiece();
+    }
+
+    // 逗号分隔的头部值中是否有 token，大小写不敏感，例如 Connection: keep-alive, Upgrade
+    bool headerHasToken(const StringPiece &name, const StringPiece &token) const {
+        return containsToken(header(name), token);
+    }
+    static bool containsToken(const StringPiece &list, const StringPiece &token);
+
+    StringPiece body() const { return body_; }
+    // 收到请求最后一部分数据的时间
+    Timestamp receiveTime() const { return receiveTime_; }
+    // 处理完这个请求之后是否保持连接
+    bool keepAlive() const { return keepAlive_; }
+
+private:
+    friend class HttpContext;
+
+    Method method_;
+    Version version_;
+    StringPiece methodString_;
+    StringPiece path_;
+    StringPiece query_;
+    std::vector<Header> headers_;
+    StringPiece body_;
+    Timestamp receiveTime_;
+    bool keepAlive_;
+};
@@ -0,0 +1,77 @@
+#include "HttpResponse.h"
+
+#include <stdio.h>
+
+void HttpResponse::appendToString(std::string *output, const StringPiece &date, bool headOnly) const {
+    char buf[64];
+    int n = snprintf(buf, sizeof buf, "HTTP/1.1 %d ", static_cast<int>(statusCode_));
+    output->append(buf, n);
+    if (statusMessage_.empty()) {
+        output->append(reasonPhrase(statusCode_));
+    } else {
+        output->append(statusMessage_);
+    }
+    output->append("\r\n");
+
+    if (!date.empty()) {
+        output->append("Date: ");
+        output->append(date.data(), date.size());
+        output->append("\r\n");
+    }
+    // 1xx、204、304 不允许带 body
+    if (statusCode_ != k204NoContent && statusCode_ != k304NotModified) {
+        n = snprintf(buf, sizeof buf, "Content-Length: %lu\r\n",
+                     static_cast<unsigned long>(body_.size()));
+        output->append(buf, n);
+    }
+    // HTTP/1.1 默认保持连接，只有关闭时才需要说明
+    if (closeConnection_) {
+        output->append("Connection: close\r\n");
+    }
+    for (const auto &header : headers_) {
+        output->append(header.first);
+        output->append(": ");
+        output->append(header.second);
+        output->append("\r\n");
+    }
+    output->append("\r\n");
+    if (!headOnly) {
+        output->append(body_);
+    }
+}
+
+const char* HttpResponse::reasonPhrase(StatusCode code) {
+    switch (code)
+    {
+    case k200Ok:
+        return "OK";
+    case k204NoContent:
+        return "No Content";
+    case k301MovedPermanently:
+        return "Moved Permanently";
+    case k302Found:
+        return "Found";
+    case k304NotModified:
+        return "Not Modified";
+    case k400BadRequest:
+        return "Bad Request";
+    case k403Forbidden:
+        return "Forbidden";
+    case k404NotFound:
+        return "Not Found";
+    case k405MethodNotAllowed:
+        return "Method Not Allowed";
+    case k413PayloadTooLarge:
+        return "Payload Too Large";
+    case k431HeaderFieldsTooLarge:
+        return "Request Header Fields Too Large";
+    case k500InternalServerError:
+        return "Internal Server Error";
+    case k501NotImplemented:
+        return "Not Implemented";
+    case k503ServiceUnavailable:
+        return "Service Unavailable";
+    default:
+        return "Unknown";
+    }
+}
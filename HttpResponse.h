@@ -0,0 +1,67 @@
+#pragma once
+
+#include "StringPiece.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+// HTTP 响应，由 HttpServer::HttpCallback 填写，HttpServer 负责加上
+// Date、Content-Length 和 Connection 头部后序列化。
+class HttpResponse {
+public:
+    enum StatusCode {
+        kUnknown = 0,
+        k200Ok = 200,
+        k204NoContent = 204,
+        k301MovedPermanently = 301,
+        k302Found = 302,
+        k304NotModified = 304,
+        k400BadRequest = 400,
+        k403Forbidden = 403,
+        k404NotFound = 404,
+        k405MethodNotAllowed = 405,
+        k413PayloadTooLarge = 413,
+        k431HeaderFieldsTooLarge = 431,
+        k500InternalServerError = 500,
+        k501NotImplemented = 501,
+        k503ServiceUnavailable = 503,
+    };
+
+    explicit HttpResponse(bool closeConnection)
+        : statusCode_(k200Ok)
+        , closeConnection_(closeConnection)
+    {}
+
+    // message 为空时使用标准的原因短语
+    void setStatusCode(StatusCode code, const std::string &message = std::string()) {
+        statusCode_ = code;
+        statusMessage_ = message;
+    }
+    StatusCode statusCode() const { return statusCode_; }
+
+    void setCloseConnection(bool on) { closeConnection_ = on; }
+    bool closeConnection() const { return closeConnection_; }
+
+    void setContentType(const std::string &contentType) { addHeader("Content-Type", contentType); }
+    void addHeader(const std::string &name, const std::string &value) {
+        headers_.push_back(std::make_pair(name, value));
+    }
+
+    void setBody(const std::string &body) { body_ = body; }
+    void setBody(std::string &&body) { body_ = std::move(body); }
+    const std::string& body() const { return body_; }
+
+    // 把完整的响应追加到 output；headOnly 为 true 时（HEAD 请求）不带 body，
+    // Content-Length 仍然是 body 的长度
+    void appendToString(std::string *output, const StringPiece &date, bool headOnly) const;
+
+    static const char* reasonPhrase(StatusCode code);
+
+private:
+    StatusCode statusCode_;
+    std::string statusMessage_;
+    std::vector<std::pair<std::string, std::string>> headers_;
+    std::string body_;
+    bool closeConnection_;
+};
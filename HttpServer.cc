@@ -0,0 +1,107 @@
+#include "HttpServer.h"
+#include "HttpContext.h"
+#include "HttpRequest.h"
+#include "HttpResponse.h"
+#include "Logger.h"
+
+#include <time.h>
+
+namespace {
+
+// 每个 loop 线程缓存一份格式化好的 Date，同一秒内的响应直接复用
+thread_local time_t t_dateSecond = 0;
+thread_local char t_date[32];
+thread_local size_t t_dateLength = 0;
+
+StringPiece httpDate(Timestamp now) {
+    time_t seconds = now.secondsSinceEpoch();
+    if (seconds != t_dateSecond) {
+        t_dateSecond = seconds;
+        tm tm_time;
+        gmtime_r(&seconds, &tm_time);
+        t_dateLength = strftime(t_date, sizeof t_date, "%a, %d %b %Y %H:%M:%S GMT", &tm_time);
+    }
+    return StringPiece(t_date, t_dateLength);
+}
+
+// 一次可读事件里所有响应拼在这里，每个 loop 线程一份，容量反复使用
+thread_local std::string t_output;
+
+void defaultHttpCallback(const HttpRequest&, HttpResponse *resp) {
+    resp->setStatusCode(HttpResponse::k404NotFound);
+}
+
+} // namespace
+
+HttpServer::HttpServer(EventLoop *loop,
+                       const InetAddress &listenAddr,
+                       const std::string &name,
+                       TcpServer::Option option)
+    : loop_(loop)
+    , server_(loop, listenAddr, name, option)
+    , httpCallback_(defaultHttpCallback)
+    , maxHeaderBytes_(64 * 1024)
+    , maxBodyBytes_(8 * 1024 * 1024)
+{
+    server_.setConnectionCallback(std::bind(&HttpServer::onConnection, this, std::placeholders::_1));
+    server_.setMessageCallback(std::bind(&HttpServer::onMessage, this, std::placeholders::_1,
+                                         std::placeholders::_2, std::placeholders::_3));
+}
+
+void HttpServer::start() {
+    server_.start();
+}
+
+void HttpServer::onConnection(const TcpConnectionPtr &conn) {
+    if (conn->connected()) {
+        conn->setContext(std::make_shared<HttpContext>(maxHeaderBytes_, maxBodyBytes_));
+    }
+}
+
+void HttpServer::onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp receiveTime) {
+    HttpContext *context = static_cast<HttpContext*>(conn->getContext().get());
+    if (context == nullptr || context->closing()) {
+        buf->retrieveAll();
+        return;
+    }
+
+    std::string &output = t_output;
+    output.clear();
+    while (buf->readableBytes() > 0) {
+        HttpContext::ParseResult result = context->parse(buf, receiveTime);
+        if (result == HttpContext::kNeedMore) {
+            break;
+        }
+        if (result == HttpContext::kError) {
+            LOG_ERROR("HttpServer bad request from %s, reply %d\n",
+                      conn->peerAddress().toIpPort().c_str(), static_cast<int>(context->errorCode()));
+            HttpResponse response(true);
+            response.setStatusCode(context->errorCode());
+            response.appendToString(&output, httpDate(receiveTime), false);
+            context->setClosing();
+            buf->retrieveAll();
+            break;
+        }
+
+        const HttpRequest &request = context->request();
+        HttpResponse response(!request.keepAlive());
+        httpCallback_(request, &response);
+        response.appendToString(&output, httpDate(receiveTime),
+                                request.method() == HttpRequest::kHead);
+        // request 中的 StringPiece 指向 buf，回调返回之后才能取走
+        buf->retrieve(context->requestBytes());
+        context->reset();
+        if (response.closeConnection()) {
+            context->setClosing();
+            buf->retrieveAll();
+            break;
+        }
+    }
+
+    if (!output.empty()) {
+        conn->send(output);
+    }
+    if (context->closing()) {
+        conn->shutdown();
+    }
+}
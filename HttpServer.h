@@ -0,0 +1,50 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "TcpServer.h"
+
+#include <functional>
+#include <string>
+
+class HttpRequest;
+class HttpResponse;
+
+// 基于 TcpServer 的 HTTP/1.1 服务器。
+// 支持 keep-alive 和流水线：一次可读事件里到齐的多个请求依次解析、依次回调，
+// 响应按请求顺序拼在一起，只调用一次 send；请求体支持 Content-Length 和分块编码。
+// HttpCallback 在连接所属的 loop 线程中同步执行，填好 response 返回即可。
+// 客户端只发不收时，可以用 server()->setFlowControl 限制积压的响应。
+class HttpServer : noncopyable {
+public:
+    using HttpCallback = std::function<void(const HttpRequest&, HttpResponse*)>;
+
+    HttpServer(EventLoop *loop,
+               const InetAddress &listenAddr,
+               const std::string &name,
+               TcpServer::Option option = TcpServer::kNoReusePort);
+
+    EventLoop* getLoop() const { return loop_; }
+    // 底层的 TcpServer，用来设置 TLS、准入控制、内存预算等
+    TcpServer* server() { return &server_; }
+
+    // 默认对所有请求回复 404
+    void setHttpCallback(const HttpCallback &cb) { httpCallback_ = cb; }
+    void setThreadNum(int numThreads) { server_.setThreadNum(numThreads); }
+
+    // 请求行加头部的上限，超出回复 431；默认 64KB
+    void setMaxHeaderBytes(size_t bytes) { maxHeaderBytes_ = bytes; }
+    // 请求体上限，超出回复 413；默认 8MB
+    void setMaxBodyBytes(size_t bytes) { maxBodyBytes_ = bytes; }
+
+    void start();
+
+private:
+    void onConnection(const TcpConnectionPtr &conn);
+    void onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp receiveTime);
+
+    EventLoop *loop_;
+    TcpServer server_;
+    HttpCallback httpCallback_;
+    size_t maxHeaderBytes_;
+    size_t maxBodyBytes_;
+};
@@ -1,32 +1,87 @@
 #include "InetAddress.h"
+#include <stddef.h>
 #include <strings.h>
 #include <string.h>
 
 InetAddress::InetAddress(uint16_t port, std::string ip){
     bzero(&addr_, sizeof addr_);
-    addr_.sin_family = AF_INET;
-    addr_.sin_port = htons(port);
+    addr_.in.sin_family = AF_INET;
+    addr_.in.sin_port = htons(port);
     //inet_pton(AF_INET, ip.c_str(), &addr_.sin_addr.s_addr);
-    addr_.sin_addr.s_addr = inet_addr(ip.c_str());
+    addr_.in.sin_addr.s_addr = inet_addr(ip.c_str());
+    len_ = sizeof addr_.in;
+}
+
+InetAddress::InetAddress(const sockaddr *addr, socklen_t len){
+    setSockAddr(addr, len);
+}
+
+void InetAddress::setSockAddr(const sockaddr *addr, socklen_t len){
+    bzero(&addr_, sizeof addr_);
+    if(len > sizeof addr_){
+        len = sizeof addr_;
+    }
+    memcpy(&addr_, addr, len);
+    len_ = len;
+}
+
+InetAddress InetAddress::unixPath(const std::string &path){
+    InetAddress addr;
+    bzero(&addr.addr_, sizeof addr.addr_);
+    addr.addr_.un.sun_family = AF_UNIX;
+    // 超长的路径被截断，bind/connect 时会失败
+    strncpy(addr.addr_.un.sun_path, path.c_str(), sizeof addr.addr_.un.sun_path - 1);
+    addr.len_ = static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) +
+                                       strlen(addr.addr_.un.sun_path) + 1);
+    return addr;
+}
+
+InetAddress InetAddress::unixAbstract(const std::string &name){
+    InetAddress addr;
+    bzero(&addr.addr_, sizeof addr.addr_);
+    addr.addr_.un.sun_family = AF_UNIX;
+    // sun_path[0] 为 '\0'，名字不以 '\0' 结尾，长度由 len_ 决定
+    size_t n = name.size() < sizeof addr.addr_.un.sun_path - 1 ? name.size()
+                                                                : sizeof addr.addr_.un.sun_path - 1;
+    memcpy(addr.addr_.un.sun_path + 1, name.data(), n);
+    addr.len_ = static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + 1 + n);
+    return addr;
 }
 
 std::string InetAddress::toIP() const{
+    if(isUnix()){
+        size_t pathLen = len_ > offsetof(sockaddr_un, sun_path) ? len_ - offsetof(sockaddr_un, sun_path) : 0;
+        if(pathLen == 0){
+            // 客户端没有 bind 的 Unix 域 socket
+            return "";
+        }
+        if(addr_.un.sun_path[0] == '\0'){
+            return "@" + std::string(addr_.un.sun_path + 1, pathLen - 1);
+        }
+        return std::string(addr_.un.sun_path, strnlen(addr_.un.sun_path, pathLen));
+    }
     char buf[64] = {0};
-    inet_ntop(AF_INET, &addr_.sin_addr, buf, sizeof buf);
+    inet_ntop(AF_INET, &addr_.in.sin_addr, buf, sizeof buf);
     return buf;
 }
 
 std::string InetAddress::toIpPort() const{
+    if(isUnix()){
+        return "unix:" + toIP();
+    }
     char buf[64] = {0};
-    inet_ntop(AF_INET, &addr_.sin_addr, buf, sizeof buf);
+    inet_ntop(AF_INET, &addr_.in.sin_addr, buf, sizeof buf);
     size_t end = strlen(buf);
-    uint16_t port = ntohs(addr_.sin_port);
+    uint16_t port = ntohs(addr_.in.sin_port);
     sprintf(buf + end, ":%u", port);
     //snprintf(buf + end,64 - end, ":%u", port);
     return buf;
 }
 uint16_t InetAddress::toPort() const{
-    return ntohs(addr_.sin_port);
+    if(isUnix()){
+        return 0;
+    }
+    return ntohs(addr_.in.sin_port);
 }
 
 // #include <iostream>
@@ -35,4 +90,4 @@ uint16_t InetAddress::toPort() const{
 //     std::cout <<  ia.toPort() << std::endl;
 //     char buf[64] = {0};
 //     return 0;
-// }
\ No newline at end of file
+// }
@@ -1,21 +1,45 @@
 #pragma once
 #include <arpa/inet.h>
 #include <netinet/in.h> // sockaddr_in
+#include <sys/un.h>     // sockaddr_un
 #include <string>
 
+// socket 地址，IPv4 或 Unix 域（文件路径或抽象命名空间）
 class InetAddress{
 public:
     explicit InetAddress(uint16_t port = 0, std::string ip = "127.0.0.1");
-    explicit InetAddress(const sockaddr_in &addr) : addr_(addr){};
+    explicit InetAddress(const sockaddr_in &addr) : len_(sizeof addr) { addr_.in = addr; }
+    // accept/getsockname 等返回的任意地址
+    InetAddress(const sockaddr *addr, socklen_t len);
 
+    // 文件系统中的 Unix 域 socket
+    static InetAddress unixPath(const std::string &path);
+    // Linux 抽象命名空间，不在文件系统中留下文件，最后一个引用关闭时自动消失
+    static InetAddress unixAbstract(const std::string &name);
+
+    sa_family_t family() const { return addr_.sa.sa_family; }
+    bool isUnix() const { return family() == AF_UNIX; }
+
+    // Unix 域地址：toIP() 返回路径（抽象命名空间以 @ 开头），toPort() 返回 0，
+    // toIpPort() 返回 "unix:路径"
     std::string toIP() const;
     std::string toIpPort() const;
     uint16_t toPort() const;
 
-    const sockaddr_in* getSockAddr() const {return &addr_;}
+    const sockaddr* getSockAddr() const { return &addr_.sa; }
+    socklen_t getSockAddrLen() const { return len_; }
+    // 只对 IPv4 地址有意义
+    const sockaddr_in* getSockAddrInet() const { return &addr_.in; }
     void setSockAddr(const sockaddr_in &addr){
-        addr_ = addr;
+        addr_.in = addr;
+        len_ = sizeof addr;
     }
+    void setSockAddr(const sockaddr *addr, socklen_t len);
 private:
-    sockaddr_in addr_;
-};
\ No newline at end of file
+    union {
+        sockaddr sa;
+        sockaddr_in in;
+        sockaddr_un un;
+    } addr_;
+    socklen_t len_;
+};
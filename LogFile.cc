@@ -0,0 +1,103 @@
+#include "LogFile.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+LogFile::LogFile(const std::string &basename, off_t rollSize)
+    : basename_(basename)
+    , rollSize_(rollSize)
+    , fd_(-1)
+    , writtenBytes_(0)
+    , startOfPeriod_(0)
+    , lastRoll_(0)
+{
+    rollFile();
+}
+
+LogFile::~LogFile(){
+    if(fd_ >= 0){
+        ::close(fd_);
+    }
+}
+
+void LogFile::append(const char *data, size_t len){
+    time_t now = ::time(NULL);
+    if(writtenBytes_ > rollSize_ || now / kRollPerSeconds * kRollPerSeconds != startOfPeriod_){
+        rollFile();
+    }
+    if(fd_ < 0){
+        return;
+    }
+
+    size_t written = 0;
+    while(written < len){
+        ssize_t n = ::write(fd_, data + written, len - written);
+        if(n < 0){
+            if(errno == EINTR){
+                continue;
+            }
+            fprintf(stderr, "LogFile::append() failed: %s\n", strerror(errno));
+            break;
+        }
+        written += n;
+    }
+    writtenBytes_ += written;
+}
+
+void LogFile::flush(){
+    if(fd_ >= 0){
+        ::fdatasync(fd_);
+    }
+}
+
+void LogFile::rollFile(){
+    time_t now = 0;
+    std::string filename = getLogFileName(basename_, &now);
+    // 同一秒内不重复滚动，否则文件名会冲突
+    if(now == lastRoll_ && fd_ >= 0){
+        return;
+    }
+
+    int fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if(fd < 0){
+        fprintf(stderr, "LogFile::rollFile() open %s failed: %s\n", filename.c_str(), strerror(errno));
+        return;
+    }
+    if(fd_ >= 0){
+        ::close(fd_);
+    }
+    fd_ = fd;
+    writtenBytes_ = 0;
+    lastRoll_ = now;
+    startOfPeriod_ = now / kRollPerSeconds * kRollPerSeconds;
+}
+
+// basename.20260101-120000.hostname.pid.log
+std::string LogFile::getLogFileName(const std::string &basename, time_t *now){
+    std::string filename;
+    filename.reserve(basename.size() + 64);
+    filename = basename;
+
+    char timebuf[32];
+    struct tm tm;
+    *now = ::time(NULL);
+    localtime_r(now, &tm);
+    strftime(timebuf, sizeof timebuf, ".%Y%m%d-%H%M%S.", &tm);
+    filename += timebuf;
+
+    char hostname[256] = {0};
+    if(::gethostname(hostname, sizeof hostname - 1) == 0){
+        filename += hostname;
+    }else{
+        filename += "unknownhost";
+    }
+
+    char pidbuf[32];
+    snprintf(pidbuf, sizeof pidbuf, ".%d", ::getpid());
+    filename += pidbuf;
+    filename += ".log";
+    return filename;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "noncopyable.h"
+
+#include <string>
+#include <time.h>
+#include <sys/types.h>
+
+// 滚动日志文件，只由 AsyncLogging 的后台线程使用，不加锁
+// 写满 rollSize 字节或跨天时换一个新文件
+class LogFile : noncopyable {
+public:
+    LogFile(const std::string &basename, off_t rollSize);
+    ~LogFile();
+
+    // 一次 write 写入一整块数据
+    void append(const char *data, size_t len);
+    void flush();
+    void rollFile();
+
+private:
+    static std::string getLogFileName(const std::string &basename, time_t *now);
+
+    static const int kRollPerSeconds = 60 * 60 * 24;
+
+    const std::string basename_;
+    const off_t rollSize_;
+
+    int fd_;
+    off_t writtenBytes_;
+    time_t startOfPeriod_; // 当前文件所属的那一天的零点（UTC）
+    time_t lastRoll_;
+};
@@ -1,40 +1,87 @@
 #include <iostream>
+#include <stdarg.h>
+#include <stdio.h>
 
 #include "Logger.h"
 #include "Timestamp.h"
 
+// 运行期阈值默认等于编译期最低级别
+std::atomic_int Logger::threshold_(MYMUDUO_MIN_LOG_LEVEL);
+
+static const char* levelName(int level){
+    switch (level)
+    {
+    case INFO:
+        return "[INFO]";
+    case ERROR:
+        return "[ERROR]";
+    case FATAL:
+        return "[FATAL]";
+    case DEBUG:
+        return "[DEBUG]";
+    default:
+        return "";
+    }
+}
+
+// 同一秒内的日志复用上次格式化好的 年月日时分秒，只补上微秒
+static thread_local time_t t_lastSecond = 0;
+static thread_local char t_time[32];
+
+static std::string formatTime(Timestamp now){
+    time_t seconds = now.secondsSinceEpoch();
+    if(seconds != t_lastSecond){
+        t_lastSecond = seconds;
+        tm tm_time;
+        localtime_r(&seconds, &tm_time);
+        strftime(t_time, sizeof t_time, "%Y/%m/%d %H:%M:%S", &tm_time);
+    }
+    char buf[48];
+    int microseconds = static_cast<int>(now.microSecondsSinceEpoch() % Timestamp::kMicroSecondsPerSecond);
+    snprintf(buf, sizeof buf, "%s.%06d", t_time, microseconds);
+    return buf;
+}
+
 // 获取日志唯一实例对象
 Logger& Logger::instance(){
     static Logger logger;
     return logger;
 }
 
-// 设置日志级别
-void Logger::setLogLevel(int level){
-    logLevel_ = level;
+void Logger::logf(int level, const char *fmt, ...){
+    char buf[1024];
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(buf, sizeof buf, fmt, args);
+    va_end(args);
+    if(n < 0){
+        return;
+    }
+    if(n >= static_cast<int>(sizeof buf)){
+        n = sizeof buf - 1;
+    }
+    log(level, buf, n);
 }
 
 // 写日志： [级别] time : msg
-void Logger::log(std::string msg){
-    std::lock_guard<std::mutex> lock(mutex_);
-    switch (logLevel_)
-    {
-    case INFO:
-        std::cout << "[INFO]" ;
-        break;
-    case ERROR:
-        std::cout << "[ERROR]" ;
-        break;
-    case FATAL:
-        std::cout << "[FATAL]" ;
-        break;
-    case DEBUG:
-        std::cout << "[DEBUG]" ;
-        break;
-    default:
-        break;
+void Logger::log(int level, const char *msg, size_t len){
+    if(output_){
+        // 交给后端输出，由后端保证线程安全，这里不加锁
+        std::string line(levelName(level));
+        line += formatTime(Timestamp::now());
+        line += " : ";
+        line.append(msg, len);
+        line += '\n';
+        output_(line.data(), line.size());
+        if(level == FATAL && flush_){
+            flush_();
+        }
+        return;
     }
 
-    std::cout << Timestamp::now().toString() << " : " << msg << std::endl;
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::cout << levelName(level);
+    std::cout << formatTime(Timestamp::now()) << " : ";
+    std::cout.write(msg, len) << std::endl;
     std::cout << std::flush;
-}
\ No newline at end of file
+}
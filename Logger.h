@@ -2,73 +2,107 @@
 
 #include <string>
 #include <mutex>
+#include <atomic>
+#include <functional>
+#include <stdlib.h>
 
 #include "noncopyable.h"
 
-#define LOG_INFO(logmsgFormat, ...) \
+// 编译期的最低日志级别，低于它的 LOG_* 语句整个被编译掉
+// 0 - DEBUG, 1 - INFO, 2 - ERROR, 3 - FATAL
+#ifndef MYMUDUO_MIN_LOG_LEVEL
+#ifdef MUDEBUG
+#define MYMUDUO_MIN_LOG_LEVEL 0
+#else
+#define MYMUDUO_MIN_LOG_LEVEL 1
+#endif
+#endif
+
+// 级别在调用处传入，不再修改 Logger 的共享状态；
+// 先检查运行期阈值再格式化，关闭的级别只有一次分支判断
+#define LOG_IMPL_IF(enabled, level, logmsgFormat, ...) \
     do \
     { \
-        Logger &logger = Logger::instance(); \
-        logger.setLogLevel(INFO); \
-        char buf[1024] = {0}; \
-        snprintf(buf, 1024, logmsgFormat, ##__VA_ARGS__); \
-        logger.log(buf); \
-    } while (0)
-    
-#define LOG_ERROR(logmsgFormat, ...) \
-    do\
-    {\
-        Logger &logger = Logger::instance();\
-        logger.setLogLevel(ERROR);\
-        char buf[1024] = {0};\
-        snprintf(buf, 1024, logmsgFormat, ##__VA_ARGS__);\
-        logger.log(buf);\
+        if (enabled) \
+        { \
+            Logger::instance().logf(level, logmsgFormat, ##__VA_ARGS__); \
+        } \
     } while (0)
-  
+
+#define LOG_IMPL(level, logmsgFormat, ...) \
+    LOG_IMPL_IF(Logger::enabled(level), level, logmsgFormat, ##__VA_ARGS__)
+
+#if MYMUDUO_MIN_LOG_LEVEL <= 1
+#define LOG_INFO(logmsgFormat, ...) LOG_IMPL(INFO, logmsgFormat, ##__VA_ARGS__)
+#else
+#define LOG_INFO(logmsgFormat, ...) do {} while (0)
+#endif
+
+#if MYMUDUO_MIN_LOG_LEVEL <= 2
+#define LOG_ERROR(logmsgFormat, ...) LOG_IMPL(ERROR, logmsgFormat, ##__VA_ARGS__)
+#else
+#define LOG_ERROR(logmsgFormat, ...) do {} while (0)
+#endif
+
+// FATAL 不受阈值影响，总是输出并退出
 #define LOG_FATAL(logmsgFormat, ...) \
     do\
     {\
-        Logger &logger = Logger::instance();\
-        logger.setLogLevel(FATAL);\
-        char buf[1024] = {0};\
-        snprintf(buf, 1024, logmsgFormat, ##__VA_ARGS__);\
-        logger.log(buf);\
+        Logger::instance().logf(FATAL, logmsgFormat, ##__VA_ARGS__);\
         exit(-1);\
     } while (0)
-  
-#ifdef MUDEBUG
+
+// 默认阈值下 DEBUG 是关闭的，只给它标上冷分支；INFO 默认打开，不加提示
+#if MYMUDUO_MIN_LOG_LEVEL <= 0
 #define LOG_DEBUG(logmsgFormat, ...) \
-    do\
-    {\
-        Logger &logger = Logger::instance();\
-        logger.setLogLevel(DEBUG);\
-        char buf[1024] = {0};\
-        snprintf(buf, 1024, logmsgFormat, ##__VA_ARGS__);\
-        logger.log(buf);\
-    } while (0)
+    LOG_IMPL_IF(__builtin_expect(Logger::enabled(DEBUG), 0), DEBUG, logmsgFormat, ##__VA_ARGS__)
 #else
-    #define LOG_DEBUG(logmsgFormat, ...)
+#define LOG_DEBUG(logmsgFormat, ...) do {} while (0)
 #endif
 
-// 定义日志的级别
+// 定义日志的级别，按严重程度递增
 enum LogLevel{
+    DEBUG,
     INFO,
     ERROR,
     FATAL,
-    DEBUG,
 };
 
 // 输出一个日志类
 class Logger : noncopyable{
 public:
+    // 日志输出目的地，默认写到标准输出；可以换成 AsyncLogging::append
+    using OutputFunc = std::function<void(const char *msg, size_t len)>;
+    using FlushFunc = std::function<void()>;
+
     // 获取日志唯一实例对象
     static Logger& instance();
-    // 设置日志级别
-    void setLogLevel(int level);
+
+    // 运行期阈值，低于阈值的日志不格式化、不输出，可在任意线程随时修改
+    static void setLogThreshold(LogLevel level) {
+        threshold_.store(level, std::memory_order_relaxed);
+    }
+    static LogLevel logThreshold() {
+        return static_cast<LogLevel>(threshold_.load(std::memory_order_relaxed));
+    }
+    static bool enabled(int level) {
+        return level >= threshold_.load(std::memory_order_relaxed);
+    }
+
+    // 格式化并写日志
+    void logf(int level, const char *fmt, ...) __attribute__((format(printf, 3, 4)));
     // 写日志
-    void log(std::string msg);
+    void log(int level, const char *msg, size_t len);
+
+    // 在开始写日志之前设置
+    void setOutput(const OutputFunc &out) { output_ = out; }
+    // LOG_FATAL 退出进程前调用
+    void setFlush(const FlushFunc &flush) { flush_ = flush; }
 private:
-    int logLevel_;
+    static std::atomic_int threshold_;
+
     std::mutex mutex_;
+    OutputFunc output_;
+    FlushFunc flush_;
     //Logger(){}
-};
\ No newline at end of file
+};
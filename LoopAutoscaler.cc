@@ -0,0 +1,57 @@
+#include "LoopAutoscaler.h"
+#include "EventLoop.h"
+#include "Logger.h"
+
+#include <thread>
+
+LoopAutoscaler::LoopAutoscaler(const Options &options)
+    : options_(options)
+    , maxThreads_(options.maxThreads > 0 ? options.maxThreads
+                                         : static_cast<int>(std::thread::hardware_concurrency()))
+    , utilization_(0)
+{
+    // TcpServer 启动后至少保留一个 subloop
+    if (options_.minThreads < 1) {
+        LOG_FATAL("LoopAutoscaler minThreads must be at least 1, got %d\n", options_.minThreads);
+    }
+}
+
+int LoopAutoscaler::desiredThreads(const std::vector<EventLoop*> &loops, Timestamp now) {
+    const int current = static_cast<int>(loops.size());
+    const int maxThreads = maxThreads_ > options_.minThreads ? maxThreads_ : options_.minThreads;
+    const int64_t elapsed = lastCheck_.valid() ? now - lastCheck_ : 0;
+
+    double total = 0;
+    int measured = 0;
+    std::unordered_map<EventLoop*, Sample> samples;
+    for (EventLoop *loop : loops) {
+        Sample sample = { loop->threadId(), loop->metrics().iterationMicros.sum() };
+        auto it = samples_.find(loop);
+        // 新加入的 loop 先记下基准，下一次检查才计入
+        if (elapsed > 0 && it != samples_.end() && it->second.tid == sample.tid) {
+            total += static_cast<double>(sample.busyMicros - it->second.busyMicros) / elapsed;
+            ++measured;
+        }
+        samples[loop] = sample;
+    }
+    samples_.swap(samples);
+    lastCheck_ = now;
+
+    int desired = current;
+    if (measured > 0) {
+        utilization_ = total / measured;
+        if (utilization_ > options_.highUtilization) {
+            desired = current + 1;
+        } else if (utilization_ < options_.lowUtilization && current > 1 &&
+                   utilization_ * current / (current - 1) < options_.highUtilization) {
+            desired = current - 1;
+        }
+    }
+    if (desired < options_.minThreads) {
+        desired = options_.minThreads;
+    }
+    if (desired > maxThreads) {
+        desired = maxThreads;
+    }
+    return desired;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "Timestamp.h"
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <unordered_map>
+#include <vector>
+
+class EventLoop;
+
+// subloop 个数的自动伸缩策略，由 TcpServer 在 baseloop 中定期调用，见 TcpServer::setAutoscaler。
+// 依据是各 loop 的忙碌比例：两次检查之间 LoopMetrics::iterationMicros 的累计值（事件回调和
+// pendingFunctors_ 的执行时间，不含阻塞在 epoll_wait 中的时间）除以经过的时间，再对所有 loop 取平均。
+// 每次检查最多增减一个 loop；减少时要求去掉一个 loop 后的预计忙碌比例仍低于 highUtilization，避免来回抖动。
+class LoopAutoscaler : noncopyable {
+public:
+    struct Options {
+        Options()
+            : minThreads(1)
+            , maxThreads(0)
+            , highUtilization(0.75)
+            , lowUtilization(0.25)
+            , intervalSeconds(5.0)
+            , drainTimeoutSeconds(30.0)
+        {}
+        int minThreads;             // subloop 个数下限，至少为 1
+        int maxThreads;             // subloop 个数上限，0 表示 CPU 核数
+        double highUtilization;     // 平均忙碌比例高于它时加一个 loop
+        double lowUtilization;      // 平均忙碌比例低于它时减一个 loop
+        double intervalSeconds;     // 检查间隔
+        double drainTimeoutSeconds; // 减少 loop 时等待连接关闭的时间，见 TcpServer::resizeThreadPool
+    };
+
+    explicit LoopAutoscaler(const Options &options);
+
+    // 在 baseloop 中调用，loops 是当前参与轮转的 loop，返回目标 subloop 个数
+    int desiredThreads(const std::vector<EventLoop*> &loops, Timestamp now);
+
+    // 上一次检查得到的平均忙碌比例
+    double utilization() const { return utilization_; }
+    const Options& options() const { return options_; }
+
+private:
+    struct Sample {
+        pid_t tid; // 同一地址上析构后新建的 loop 不沿用旧的累计值
+        int64_t busyMicros;
+    };
+
+    const Options options_;
+    const int maxThreads_;
+    std::unordered_map<EventLoop*, Sample> samples_;
+    Timestamp lastCheck_;
+    double utilization_;
+};
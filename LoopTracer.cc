@@ -0,0 +1,177 @@
+#include "LoopTracer.h"
+#include "Logger.h"
+
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <vector>
+
+namespace {
+
+// 10 秒内同一个 loop 只写一次慢迭代的记录，避免持续过载时写满磁盘
+const int64_t kSlowDumpIntervalNs = 10LL * 1000 * 1000 * 1000;
+
+size_t roundUpPowerOfTwo(size_t n) {
+    size_t capacity = 2;
+    while (capacity < n) {
+        capacity <<= 1;
+    }
+    return capacity;
+}
+
+} // namespace
+
+LoopTracer::LoopTracer(size_t capacity)
+    : capacity_(roundUpPowerOfTwo(capacity))
+    , mask_(capacity_ - 1)
+    , slots_(new Slot[capacity_])
+    , next_(0)
+    , enabled_(true)
+    , slowThresholdMicros_(0)
+    , lastSlowDumpNs_(0)
+{
+    for (size_t i = 0; i < capacity_; ++i) {
+        slots_[i].timeNs.store(0, std::memory_order_relaxed);
+        slots_[i].info.store(0, std::memory_order_relaxed);
+    }
+}
+
+LoopTracer::~LoopTracer() = default;
+
+int64_t LoopTracer::nowNs() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+const char* LoopTracer::eventName(int type) {
+    switch (type) {
+    case kPoll:
+        return "poll";
+    case kChannel:
+        return "channel";
+    case kFunctor:
+        return "functor";
+    default:
+        return "unknown";
+    }
+}
+
+void LoopTracer::setSlowIterationDump(int64_t thresholdMicros, const std::string &pathPrefix) {
+    slowThresholdMicros_ = thresholdMicros;
+    slowDumpPrefix_ = pathPrefix;
+}
+
+size_t LoopTracer::appendChromeEvents(std::string *output, int pid, int tid) const {
+    struct Record {
+        uint64_t timeNs;
+        uint64_t info;
+    };
+
+    // 先拷贝再检查：拷贝期间被 loop 线程覆盖的槽位，其序号一定小于 end2 + 1 - capacity_
+    const uint64_t end = next_.load(std::memory_order_acquire);
+    const uint64_t begin = end > capacity_ ? end - capacity_ : 0;
+    std::vector<Record> records;
+    records.reserve(static_cast<size_t>(end - begin));
+    for (uint64_t i = begin; i < end; ++i) {
+        const Slot &slot = slots_[i & mask_];
+        Record r = { slot.timeNs.load(std::memory_order_relaxed), slot.info.load(std::memory_order_relaxed) };
+        records.push_back(r);
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const uint64_t end2 = next_.load(std::memory_order_relaxed);
+    const uint64_t firstValid = end2 + 1 > capacity_ ? end2 + 1 - capacity_ : 0;
+    size_t skip = firstValid > begin ? static_cast<size_t>(firstValid - begin) : 0;
+    if (skip > records.size()) {
+        skip = records.size();
+    }
+
+    size_t count = 0;
+    int depth = 0;
+    char buf[256];
+    for (size_t i = skip; i < records.size(); ++i) {
+        const int type = static_cast<int>(records[i].info >> 56);
+        const bool isBegin = (records[i].info >> 55) & 1;
+        const int revents = static_cast<int>((records[i].info >> 32) & 0x7FFFFF);
+        const int fd = static_cast<int32_t>(records[i].info & 0xFFFFFFFF);
+        // 环形缓冲开头可能是一条前半段已被覆盖的记录，只剩结束事件，trace viewer 不认，丢掉
+        if (isBegin) {
+            ++depth;
+        } else if (depth == 0) {
+            continue;
+        } else {
+            --depth;
+        }
+
+        int n = snprintf(buf, sizeof buf, "%s{\"name\":\"%s\",\"cat\":\"loop\",\"ph\":\"%s\",\"ts\":%.3f,"
+                         "\"pid\":%d,\"tid\":%d",
+                         count == 0 ? "" : ",\n", eventName(type), isBegin ? "B" : "E",
+                         static_cast<double>(records[i].timeNs) / 1000.0, pid, tid);
+        output->append(buf, static_cast<size_t>(n));
+        if (type == kChannel) {
+            n = snprintf(buf, sizeof buf, ",\"args\":{\"fd\":%d,\"revents\":\"0x%x\"}", fd, revents);
+            output->append(buf, static_cast<size_t>(n));
+        }
+        output->push_back('}');
+        ++count;
+    }
+    return count;
+}
+
+bool LoopTracer::lastEvent(Event *event) const {
+    const uint64_t end = next_.load(std::memory_order_acquire);
+    if (end == 0) {
+        return false;
+    }
+    const Slot &slot = slots_[(end - 1) & mask_];
+    const uint64_t timeNs = slot.timeNs.load(std::memory_order_relaxed);
+    const uint64_t info = slot.info.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    // 读取期间整个环都被写了一遍，这条已被覆盖；此时 loop 显然没有卡住，退回上一次读到的结果即可
+    if (next_.load(std::memory_order_relaxed) - end >= capacity_) {
+        return false;
+    }
+    event->seq = end - 1;
+    event->type = static_cast<EventType>(info >> 56);
+    event->isBegin = (info >> 55) & 1;
+    event->revents = static_cast<int>((info >> 32) & 0x7FFFFF);
+    event->fd = static_cast<int32_t>(info & 0xFFFFFFFF);
+    event->timeNs = static_cast<int64_t>(timeNs);
+    return true;
+}
+
+std::string LoopTracer::toChromeTrace(int pid, int tid) const {
+    std::string output("{\"traceEvents\":[\n");
+    appendChromeEvents(&output, pid, tid);
+    output.append("\n]}\n");
+    return output;
+}
+
+void LoopTracer::dumpSlowIteration(int64_t lagMicros, int tid) {
+    const int64_t now = nowNs();
+    if (lastSlowDumpNs_ != 0 && now - lastSlowDumpNs_ < kSlowDumpIntervalNs) {
+        return;
+    }
+    lastSlowDumpNs_ = now;
+
+    char suffix[64];
+    time_t seconds = ::time(nullptr);
+    struct tm tm;
+    localtime_r(&seconds, &tm);
+    strftime(suffix, sizeof suffix, "%Y%m%d-%H%M%S", &tm);
+    char path[512];
+    snprintf(path, sizeof path, "%s-%d-%s.json", slowDumpPrefix_.c_str(), tid, suffix);
+
+    FILE *fp = ::fopen(path, "we");
+    if (fp == nullptr) {
+        LOG_ERROR("LoopTracer: slow iteration %ld us in loop %d, cannot open %s\n",
+                  static_cast<long>(lagMicros), tid, path);
+        return;
+    }
+    const std::string trace = toChromeTrace(static_cast<int>(::getpid()), tid);
+    ::fwrite(trace.data(), 1, trace.size(), fp);
+    ::fclose(fp);
+    LOG_ERROR("LoopTracer: slow iteration %ld us in loop %d, trace written to %s\n",
+              static_cast<long>(lagMicros), tid, path);
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "noncopyable.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <string>
+
+// 每个 EventLoop 一个的事件追踪环形缓冲，默认一直开启。
+// loop 线程在 epoll_wait、每个 Channel 的事件分发（fd、revents）和每个 pendingFunctor 前后各写一条记录，
+// 写满后覆盖最旧的记录。每条记录是两个 64 位字，只由 loop 线程写（relaxed store，没有 lock 前缀），
+// 其他线程可以随时拷贝一份快照：拷贝前后各读一次写入位置，丢掉拷贝期间可能被覆盖的记录。
+// 所以 loop 卡死时也能导出，最后一条没有结束的记录就是卡住的回调。
+//
+// 导出格式是 Chrome trace-event JSON，可以用 chrome://tracing 或 Perfetto 打开；
+// 所有 loop 的记录一起导出见 MetricsServer 的 /debug/trace。
+class LoopTracer : noncopyable {
+public:
+    enum EventType {
+        kPoll = 1,
+        kChannel = 2,
+        kFunctor = 3,
+    };
+
+    // 解码后的一条记录
+    struct Event {
+        uint64_t seq;    // 记录序号，loop 每写一条加一
+        EventType type;
+        bool isBegin;
+        int fd;          // 只有 kChannel 有效
+        int revents;
+        int64_t timeNs;  // CLOCK_MONOTONIC，见 nowNs()
+    };
+
+    // capacity 向上取整为 2 的幂
+    explicit LoopTracer(size_t capacity = kDefaultCapacity);
+    ~LoopTracer();
+
+    // 默认开启；关闭后每个记录点只剩一次分支判断
+    void setEnabled(bool on) { enabled_.store(on, std::memory_order_relaxed); }
+    bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+    // 以下只能在 loop 线程中调用
+    void begin(EventType type, int fd = -1, int revents = 0) {
+        if (enabled()) {
+            record(type, true, fd, revents);
+        }
+    }
+    void end(EventType type, int fd = -1, int revents = 0) {
+        if (enabled()) {
+            record(type, false, fd, revents);
+        }
+    }
+
+    // 迭代耗时超过 thresholdMicros 时，把本 loop 的记录写到 pathPrefix-<tid>-<时间>.json 并打一条 ERROR 日志；
+    // 同一个 loop 至少间隔 10 秒才会再写一次。thresholdMicros 为 0 表示关闭（默认）。只能在 loop 线程中调用
+    void setSlowIterationDump(int64_t thresholdMicros, const std::string &pathPrefix);
+    // EventLoop 在每轮迭代结束时调用
+    void iterationFinished(int64_t lagMicros, int tid) {
+        if (slowThresholdMicros_ > 0 && lagMicros >= slowThresholdMicros_) {
+            dumpSlowIteration(lagMicros, tid);
+        }
+    }
+
+    // 把当前缓冲中的记录按 Chrome trace-event 格式追加到 output（只有事件，不含外层的 traceEvents 数组），
+    // 第一条事件前面不加逗号，返回追加的事件数。可在任意线程调用
+    size_t appendChromeEvents(std::string *output, int pid, int tid) const;
+    // 完整的 Chrome trace JSON，只含本 loop
+    std::string toChromeTrace(int pid, int tid) const;
+    // 最近写入的一条记录，即 loop 当前所处的阶段。可在任意线程调用，还没有记录时返回 false
+    bool lastEvent(Event *event) const;
+
+    // 记录使用的时钟
+    static int64_t nowNs();
+    static const char* eventName(int type);
+
+    static const size_t kDefaultCapacity = 8192;
+
+private:
+    struct Slot {
+        std::atomic<uint64_t> timeNs;
+        // type(8) | begin(1) | revents(23) | fd(32)
+        std::atomic<uint64_t> info;
+    };
+
+    void record(EventType type, bool isBegin, int fd, int revents) {
+        const uint64_t index = next_.load(std::memory_order_relaxed);
+        Slot &slot = slots_[index & mask_];
+        uint64_t info = (static_cast<uint64_t>(type) << 56) | (static_cast<uint64_t>(isBegin) << 55) |
+                        ((static_cast<uint64_t>(revents) & 0x7FFFFF) << 32) | static_cast<uint32_t>(fd);
+        // 读者看到覆盖后的内容时，也一定能看到推进过的 next_，从而丢掉这条记录；x86 上只是编译器屏障
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.timeNs.store(static_cast<uint64_t>(nowNs()), std::memory_order_relaxed);
+        slot.info.store(info, std::memory_order_relaxed);
+        next_.store(index + 1, std::memory_order_release);
+    }
+
+    void dumpSlowIteration(int64_t lagMicros, int tid);
+
+    const size_t capacity_;
+    const uint64_t mask_;
+    std::unique_ptr<Slot[]> slots_;
+    std::atomic<uint64_t> next_; // 下一条记录的序号，只有 loop 线程写
+    std::atomic<bool> enabled_;
+
+    int64_t slowThresholdMicros_;
+    std::string slowDumpPrefix_;
+    int64_t lastSlowDumpNs_;
+};
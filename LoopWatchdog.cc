@@ -0,0 +1,193 @@
+#include "LoopWatchdog.h"
+#include "EventLoop.h"
+#include "Logger.h"
+#include "Metrics.h"
+
+#include <errno.h>
+#include <execinfo.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <vector>
+
+namespace {
+
+const int kMaxFrames = 64;
+// 等待目标线程执行信号处理函数的时间，线程屏蔽了该信号时就拿不到栈
+const int kCaptureTimeoutMillis = 200;
+
+// 抓栈状态：0 空闲，1 已发信号等待目标线程，2 目标线程正在 backtrace，3 完成。
+// 同一时刻只有一个 watchdog 线程在抓，信号处理函数里只用无锁原子量和静态数组
+std::atomic<int> g_captureState(0);
+std::atomic<pid_t> g_captureTid(0);
+void *g_frames[kMaxFrames];
+int g_numFrames = 0;
+
+void captureSignalHandler(int) {
+    int savedErrno = errno;
+    int expected = 1;
+    if (static_cast<pid_t>(::syscall(SYS_gettid)) == g_captureTid.load(std::memory_order_acquire) &&
+        g_captureState.compare_exchange_strong(expected, 2)) {
+        g_numFrames = ::backtrace(g_frames, kMaxFrames);
+        g_captureState.store(3, std::memory_order_release);
+    }
+    errno = savedErrno;
+}
+
+} // namespace
+
+LoopWatchdog::LoopWatchdog(int64_t thresholdMillis, int64_t checkIntervalMillis)
+    : thresholdNs_(thresholdMillis * 1000 * 1000)
+    , checkIntervalMillis_(checkIntervalMillis)
+    , stackSignal_(0)
+    , running_(false)
+    , stallCount_(0)
+    , thread_(std::bind(&LoopWatchdog::threadFunc, this), "LoopWatchdog")
+{}
+
+LoopWatchdog::~LoopWatchdog() {
+    if (running_) {
+        stop();
+    }
+}
+
+void LoopWatchdog::enableStackCapture(int signo) {
+    struct sigaction sa;
+    memset(&sa, 0, sizeof sa);
+    sa.sa_handler = captureSignalHandler;
+    sa.sa_flags = SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    if (::sigaction(signo, &sa, nullptr) < 0) {
+        LOG_ERROR("LoopWatchdog: sigaction(%d) failed, errno=%d\n", signo, errno);
+        return;
+    }
+    // 第一次调用 backtrace 会加载 libgcc 并分配内存，提前在这里做掉，信号处理函数里就不再分配
+    void *frames[1];
+    ::backtrace(frames, 1);
+    stackSignal_ = signo;
+}
+
+void LoopWatchdog::start() {
+    running_ = true;
+    thread_.start();
+}
+
+void LoopWatchdog::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+    }
+    cond_.notify_one();
+    thread_.join();
+}
+
+void LoopWatchdog::threadFunc() {
+    while (running_) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cond_.wait_for(lock, std::chrono::milliseconds(checkIntervalMillis_), [this] { return !running_; });
+        }
+        if (running_) {
+            checkOnce();
+        }
+    }
+}
+
+void LoopWatchdog::checkOnce() {
+    const int64_t now = LoopTracer::nowNs();
+    std::vector<Stall> stalls;
+    std::vector<Reported> recovered;
+    std::map<EventLoop*, Reported> stillStuck;
+
+    // 持 registry 的锁期间 loop 不会析构；日志和抓栈放到锁外，不耽误 loop 的创建和析构
+    MetricsRegistry::instance().forEachLoop([&](EventLoop *loop) {
+        LoopTracer::Event event;
+        // loop() 还没开始或已经返回的 loop 停在最后一条记录上，但线程不在 loop 里，不算卡住
+        const bool stuck = loop->looping() && loop->tracer().enabled() && loop->tracer().lastEvent(&event) &&
+                           !(event.type == LoopTracer::kPoll && event.isBegin) &&
+                           now - event.timeNs >= thresholdNs_;
+        auto it = reported_.find(loop);
+        // 地址相同但线程不同，是析构后新建在同一地址上的 loop
+        const bool known = it != reported_.end() && it->second.tid == loop->threadId();
+        if (known && stuck && it->second.seq == event.seq) {
+            stillStuck[loop] = it->second;
+            return;
+        }
+        if (known) {
+            recovered.push_back(it->second);
+        }
+        if (stuck) {
+            loop->metrics().stalls.add();
+            Stall stall = { loop, loop->threadId(), event, (now - event.timeNs) / (1000 * 1000) };
+            stalls.push_back(stall);
+            Reported r = { loop->threadId(), event.seq, event.timeNs };
+            stillStuck[loop] = r;
+        }
+    });
+    reported_.swap(stillStuck);
+
+    for (const Reported &r : recovered) {
+        LOG_ERROR("LoopWatchdog: loop %d recovered, stuck for about %ld ms\n", static_cast<int>(r.tid),
+                  static_cast<long>((now - r.sinceNs) / (1000 * 1000)));
+    }
+    for (const Stall &stall : stalls) {
+        report(stall);
+    }
+}
+
+void LoopWatchdog::report(const Stall &stall) {
+    stallCount_.fetch_add(1, std::memory_order_relaxed);
+    const LoopTracer::Event &event = stall.event;
+    if (event.type == LoopTracer::kChannel && event.isBegin) {
+        LOG_ERROR("LoopWatchdog: loop %d stuck for %ld ms in channel callback, fd=%d revents=0x%x\n",
+                  static_cast<int>(stall.tid), static_cast<long>(stall.elapsedMillis), event.fd, event.revents);
+    } else if (event.isBegin) {
+        LOG_ERROR("LoopWatchdog: loop %d stuck for %ld ms in %s\n", static_cast<int>(stall.tid),
+                  static_cast<long>(stall.elapsedMillis), LoopTracer::eventName(event.type));
+    } else {
+        // 两个回调之间，例如 doPendingFunctors 取队列时等锁
+        LOG_ERROR("LoopWatchdog: loop %d stuck for %ld ms after %s\n", static_cast<int>(stall.tid),
+                  static_cast<long>(stall.elapsedMillis), LoopTracer::eventName(event.type));
+    }
+    if (stackSignal_ != 0) {
+        captureStack(stall.tid);
+    }
+    if (stallCallback_) {
+        stallCallback_(stall);
+    }
+}
+
+void LoopWatchdog::captureStack(pid_t tid) {
+    g_captureTid.store(tid, std::memory_order_release);
+    g_captureState.store(1);
+    if (::syscall(SYS_tgkill, ::getpid(), tid, stackSignal_) < 0) {
+        g_captureState.store(0);
+        LOG_ERROR("LoopWatchdog: tgkill(%d) failed, errno=%d\n", static_cast<int>(tid), errno);
+        return;
+    }
+    for (int i = 0; i < kCaptureTimeoutMillis && g_captureState.load() != 3; ++i) {
+        ::usleep(1000);
+    }
+    int expected = 1;
+    if (g_captureState.compare_exchange_strong(expected, 0)) {
+        LOG_ERROR("LoopWatchdog: no stack from loop %d, signal %d blocked?\n", static_cast<int>(tid), stackSignal_);
+        return;
+    }
+    // 目标线程已经开始 backtrace，等它写完
+    while (g_captureState.load(std::memory_order_acquire) != 3) {
+        ::usleep(100);
+    }
+
+    char **symbols = ::backtrace_symbols(g_frames, g_numFrames);
+    // 第 0 帧是信号处理函数自己
+    for (int i = 1; i < g_numFrames; ++i) {
+        LOG_ERROR("LoopWatchdog: loop %d  #%d %s\n", static_cast<int>(tid), i - 1,
+                  symbols ? symbols[i] : "?");
+    }
+    ::free(symbols);
+    g_captureState.store(0);
+}
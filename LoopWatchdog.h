@@ -0,0 +1,83 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "LoopTracer.h"
+#include "Thread.h"
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+
+class EventLoop;
+
+// 卡住的 loop 的检查线程。MessageCallback 里一个阻塞调用会让同一个 subloop 上的所有连接停住，
+// watchdog 定期检查 MetricsRegistry 里登记的所有 loop：每个 loop 在 poll、Channel 分发和 pendingFunctor
+// 前后都会往 LoopTracer 写一条带时间的记录，最后一条记录就是 loop 当前所处的阶段。
+// 除了阻塞在 epoll_wait 中，同一阶段停留超过阈值就判定为卡住，打印 ERROR 日志
+// （fd、回调类型、已经卡了多久），mymuduo_loop_stalls_total 加一；恢复后再打印一次总耗时。
+// 依赖 LoopTracer，关闭了 tracer 的 loop 不会被检查；只检查正在 loop() 中的 loop。
+//
+// 可选地用信号抓取卡住线程的调用栈：watchdog 用 tgkill 给 loop 线程发 signo，
+// 信号处理函数里 backtrace()，watchdog 线程再符号化后打印（链接时加 -rdynamic 才有函数名）。
+// signo 必须是进程里没有别的用途的信号，例如 SIGRTMIN + 1；
+// 信号会打断 loop 线程中正在进行的 sleep、epoll_wait 之类不会自动重启的系统调用，让它们提前返回 EINTR。
+//
+//   LoopWatchdog watchdog(500);
+//   watchdog.enableStackCapture(SIGRTMIN + 1);
+//   watchdog.start();
+class LoopWatchdog : noncopyable {
+public:
+    // 一次卡住的现场
+    struct Stall {
+        EventLoop *loop;
+        pid_t tid;                // loop 线程
+        LoopTracer::Event event;  // 卡住时所处的阶段
+        int64_t elapsedMillis;    // 已经卡了多久
+    };
+    using StallCallback = std::function<void(const Stall&)>;
+
+    explicit LoopWatchdog(int64_t thresholdMillis = 1000, int64_t checkIntervalMillis = 100);
+    ~LoopWatchdog();
+
+    // start() 之前调用
+    void enableStackCapture(int signo);
+    // 判定卡住时除了打日志还调用 cb，在 watchdog 线程中执行，loop 可能已经析构，不要访问它
+    void setStallCallback(StallCallback cb) { stallCallback_ = std::move(cb); }
+
+    void start();
+    void stop();
+
+    // 判定为卡住的总次数
+    uint64_t stallCount() const { return stallCount_.load(std::memory_order_relaxed); }
+
+private:
+    // 已经报告过、还没恢复的卡顿，按 loop 记录
+    struct Reported {
+        pid_t tid;
+        uint64_t seq;
+        int64_t sinceNs;
+    };
+
+    void threadFunc();
+    void checkOnce();
+    void report(const Stall &stall);
+    void captureStack(pid_t tid);
+
+    const int64_t thresholdNs_;
+    const int64_t checkIntervalMillis_;
+    int stackSignal_;
+    StallCallback stallCallback_;
+
+    std::atomic_bool running_;
+    std::atomic<uint64_t> stallCount_;
+    std::map<EventLoop*, Reported> reported_; // 只在 watchdog 线程访问
+
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    Thread thread_;
+};
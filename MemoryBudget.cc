@@ -0,0 +1,150 @@
+#include "MemoryBudget.h"
+#include "EventLoop.h"
+#include "Logger.h"
+#include "TcpConnection.h"
+#include "Timestamp.h"
+
+#include <algorithm>
+
+MemoryBudget::MemoryBudget(int64_t budgetBytes, Policy policy)
+    : budget_(budgetBytes)
+    , lowMark_(budgetBytes - budgetBytes / 8)
+    , policy_(policy)
+    , publishStep_(std::max<int64_t>(1, std::min<int64_t>(64 * 1024, budgetBytes / kMaxSlots)))
+    , overBudget_(false)
+    , approxTotal_(0)
+    , lastCallback_(0)
+    , slots_(new Slot[kMaxSlots])
+    , numSlots_(0)
+{
+    for (int i = 0; i < kMaxSlots; ++i) {
+        slots_[i].bytes = 0;
+        slots_[i].published = 0;
+        slots_[i].loop = nullptr;
+    }
+}
+
+MemoryBudget::~MemoryBudget() {}
+
+MemoryBudget::Slot* MemoryBudget::addLoop(EventLoop *loop) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Slot *slot = slotOf(loop);
+    if (slot == nullptr) {
+        slot = slotOf(nullptr);
+    }
+    if (slot) {
+        slot->loop = loop;
+        return slot;
+    }
+    int n = numSlots_.load();
+    if (n >= kMaxSlots) {
+        LOG_FATAL("%s:%s:%d too many loops for MemoryBudget\n", __FILE__, __FUNCTION__, __LINE__);
+    }
+    slots_[n].loop = loop;
+    // 先填好槽再发布数量，汇总线程看到的槽都是完整的
+    numSlots_.store(n + 1, std::memory_order_release);
+    return &slots_[n];
+}
+
+void MemoryBudget::removeLoop(EventLoop *loop) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Slot *slot = slotOf(loop);
+    if (slot) {
+        // 连接都已关闭，bytes 应该已经回到 0；不是 0 说明有连接没有走完 connectDestroyed，
+        // 清零后再交给下一个使用者，不能把残留的计数永久算进预算。paused 里只剩失效的 weak_ptr
+        int64_t bytes = slot->bytes.load(std::memory_order_relaxed);
+        if (bytes != 0) {
+            LOG_ERROR("MemoryBudget::removeLoop %ld bytes left in slot of loop %p\n", (long)bytes, loop);
+            slot->bytes.store(0, std::memory_order_relaxed);
+        }
+        approxTotal_.fetch_sub(slot->published, std::memory_order_relaxed);
+        slot->published = 0;
+        slot->loop = nullptr;
+    }
+}
+
+MemoryBudget::Slot* MemoryBudget::slotOf(EventLoop *loop) const {
+    int n = numSlots_.load(std::memory_order_acquire);
+    for (int i = 0; i < n; ++i) {
+        if (slots_[i].loop == loop) {
+            return &slots_[i];
+        }
+    }
+    return nullptr;
+}
+
+int64_t MemoryBudget::totalBytes() const {
+    int n = numSlots_.load(std::memory_order_acquire);
+    int64_t total = 0;
+    for (int i = 0; i < n; ++i) {
+        total += slots_[i].bytes.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+void MemoryBudget::update(Slot *slot, int64_t delta) {
+    // 槽只有所属 loop 线程写，load + store 即可，不需要 fetch_add 的总线锁
+    int64_t bytes = slot->bytes.load(std::memory_order_relaxed) + delta;
+    slot->bytes.store(bytes, std::memory_order_relaxed);
+    // 攒够 publishStep_ 才改一次共享的近似总数，其余更新不碰共享的 cache line
+    int64_t unpublished = bytes - slot->published;
+    if (unpublished >= publishStep_ || unpublished <= -publishStep_) {
+        approxTotal_.fetch_add(unpublished, std::memory_order_relaxed);
+        slot->published = bytes;
+    }
+    int64_t approx = approxTotal_.load(std::memory_order_relaxed);
+
+    bool over = overBudget();
+    if (delta > 0 && !over) {
+        // 近似总数离预算还远时不用精确汇总
+        if (approx + slack() > budget_ && totalBytes() > budget_ && !overBudget_.exchange(true)) {
+            LOG_ERROR("MemoryBudget over budget, total=%ld budget=%ld\n",
+                      (long)totalBytes(), (long)budget_);
+            if (overBudgetCallback_) {
+                lastCallback_.store(Timestamp::cachedNow().microSecondsSinceEpoch(),
+                                    std::memory_order_relaxed);
+                overBudgetCallback_();
+            }
+        }
+    } else if (delta > 0 && over) {
+        // 上一轮处理完仍然超预算（例如当时没有可关闭的积压），积压还在增长就再调用一次，限制频率
+        if (overBudgetCallback_) {
+            int64_t now = Timestamp::cachedNow().microSecondsSinceEpoch();
+            int64_t last = lastCallback_.load(std::memory_order_relaxed);
+            if (now - last >= kRetryInterval &&
+                lastCallback_.compare_exchange_strong(last, now, std::memory_order_relaxed)) {
+                overBudgetCallback_();
+            }
+        }
+    } else if (delta < 0 && over) {
+        if (approx - slack() <= lowMark_ && totalBytes() <= lowMark_ && overBudget_.exchange(false)) {
+            LOG_INFO("MemoryBudget back under budget, total=%ld\n", (long)totalBytes());
+            if (policy_ == kPauseReading) {
+                // 每个 loop 只投递一次，恢复各自登记的连接；TcpServer 先 removeLoop 再退出 loop，持锁期间 loop 都还活着
+                std::lock_guard<std::mutex> lock(mutex_);
+                int n = numSlots_.load(std::memory_order_acquire);
+                for (int i = 0; i < n; ++i) {
+                    Slot *s = &slots_[i];
+                    if (s->loop) {
+                        s->loop->runInLoop(std::bind(&MemoryBudget::resumeSlotInLoop, this, s));
+                    }
+                }
+            }
+        }
+    }
+}
+
+void MemoryBudget::addPaused(Slot *slot, const TcpConnectionPtr &conn) {
+    slot->paused.push_back(conn);
+}
+
+void MemoryBudget::resumeSlotInLoop(Slot *slot) {
+    std::vector<std::weak_ptr<TcpConnection>> paused;
+    paused.swap(slot->paused);
+    for (const std::weak_ptr<TcpConnection> &weakConn : paused) {
+        TcpConnectionPtr conn = weakConn.lock();
+        if (conn) {
+            conn->resumeFromBudgetInLoop();
+        }
+    }
+}
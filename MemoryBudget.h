@@ -0,0 +1,80 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "Callbacks.h"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+class EventLoop;
+
+// 统计一个 TcpServer 所有连接 inputBuffer_/outputBuffer_ 中积压的字节数，并施加全局预算
+// 每个 loop 一个计数槽，只由该 loop 线程写，不加锁；汇总时把所有槽相加。
+// 槽的变化累计到 publishStep_ 才计入共享的近似总数，平时只看近似总数，接近预算时才精确汇总
+class MemoryBudget : noncopyable {
+public:
+    enum Policy {
+        kPauseReading,         // 超预算后暂停有积压的连接的读，回落到低水位后恢复
+        kRejectNewConnections, // 超预算期间拒绝新连接
+        kEvictLargest,         // 超预算时关闭积压最多的连接
+    };
+    using OverBudgetCallback = std::function<void()>;
+
+    // 一个 loop 的计数槽，填充到一个 cache line，避免不同 loop 之间伪共享
+    struct Slot {
+        std::atomic<int64_t> bytes;
+        int64_t published; // 已计入 approxTotal_ 的部分，只在 loop 线程中访问
+        EventLoop *loop;
+        // 因超预算被暂停读的连接，只在 loop 线程中访问
+        std::vector<std::weak_ptr<TcpConnection>> paused;
+        char pad[64];
+    };
+
+    static const int kMaxSlots = 256;
+
+    MemoryBudget(int64_t budgetBytes, Policy policy);
+    ~MemoryBudget();
+
+    // 在 TcpServer::start 和运行中增加 subloop 时为每个 subloop 分配一个计数槽，优先复用已释放的槽
+    Slot* addLoop(EventLoop *loop);
+    // loop 退出前释放它的槽，此时 loop 上应该已经没有连接，残留的计数会被清零
+    void removeLoop(EventLoop *loop);
+    Slot* slotOf(EventLoop *loop) const;
+
+    // 在 slot 所属 loop 线程中调用，delta 为连接缓冲区字节数的变化量
+    void update(Slot *slot, int64_t delta);
+    // kPauseReading：在连接所属 loop 线程中登记被暂停的连接
+    void addPaused(Slot *slot, const TcpConnectionPtr &conn);
+
+    int64_t totalBytes() const;
+    int64_t budget() const { return budget_; }
+    Policy policy() const { return policy_; }
+    bool overBudget() const { return overBudget_.load(std::memory_order_relaxed); }
+
+    // 由正常转为超预算时调用；仍超预算且积压继续增长时，最多每 kRetryInterval 再调用一次。
+    // 回调执行在触发的 loop 线程中
+    void setOverBudgetCallback(const OverBudgetCallback &cb) { overBudgetCallback_ = cb; }
+
+private:
+    static const int64_t kRetryInterval = 100 * 1000; // 微秒
+
+    void resumeSlotInLoop(Slot *slot);
+    // 近似总数与真实值的最大偏差，每个槽最多有 publishStep_ 没有计入
+    int64_t slack() const { return numSlots_.load(std::memory_order_relaxed) * publishStep_; }
+
+    const int64_t budget_;
+    const int64_t lowMark_; // 回落到这个值以下才解除超预算状态，避免在预算附近来回抖动
+    const Policy policy_;
+    const int64_t publishStep_;
+    std::atomic_bool overBudget_;
+    std::atomic<int64_t> approxTotal_;
+    std::atomic<int64_t> lastCallback_; // 上次调用 overBudgetCallback_ 的时间，微秒
+    std::unique_ptr<Slot[]> slots_;
+    std::atomic_int numSlots_;
+    // 保护 Slot::loop 的修改，以及跨线程遍历各槽的 loop（之后 loop 可能退出）
+    mutable std::mutex mutex_;
+    OverBudgetCallback overBudgetCallback_;
+};
@@ -0,0 +1,133 @@
+#include "Metrics.h"
+#include "EventLoop.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+
+#include <algorithm>
+
+namespace {
+
+// 每次 epoll_wait 返回的事件数
+const int64_t kPollEventsBounds[] = { 0, 1, 2, 4, 8, 16, 32, 64, 128, 256 };
+// 每轮迭代耗时，微秒
+const int64_t kIterationMicrosBounds[] = { 10, 50, 100, 250, 500, 1000, 2500, 5000, 10000, 50000, 100000, 1000000 };
+
+void appendFormat(std::string *output, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+void appendFormat(std::string *output, const char *fmt, ...) {
+    char buf[256];
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(buf, sizeof buf, fmt, args);
+    va_end(args);
+    if (n > 0) {
+        output->append(buf, std::min(static_cast<size_t>(n), sizeof buf - 1));
+    }
+}
+
+void appendHeader(std::string *output, const char *name, const char *type, const char *help) {
+    appendFormat(output, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+struct SimpleMetric {
+    const char *name;
+    const char *type;
+    const char *help;
+    const LocalCounter LoopMetrics::*counter;
+};
+
+const SimpleMetric kSimpleMetrics[] = {
+    { "mymuduo_loop_iterations_total", "counter", "Event loop iterations.", &LoopMetrics::iterations },
+    { "mymuduo_loop_functors_total", "counter", "Pending functors executed.", &LoopMetrics::functors },
+    { "mymuduo_loop_wakeups_total", "counter", "Times the loop was woken through its eventfd.", &LoopMetrics::wakeups },
+    { "mymuduo_loop_stalls_total", "counter", "Times the loop was found stuck in one callback by LoopWatchdog.",
+      &LoopMetrics::stalls },
+    { "mymuduo_read_bytes_total", "counter", "Bytes read from connections.", &LoopMetrics::bytesRead },
+    { "mymuduo_write_bytes_total", "counter", "Bytes written to connections.", &LoopMetrics::bytesWritten },
+    { "mymuduo_read_syscalls_total", "counter", "Read calls on connections.", &LoopMetrics::readCalls },
+    { "mymuduo_write_syscalls_total", "counter", "Write calls on connections.", &LoopMetrics::writeCalls },
+    { "mymuduo_read_eagain_total", "counter", "Reads that returned EAGAIN.", &LoopMetrics::readEagain },
+    { "mymuduo_write_eagain_total", "counter", "Writes that returned EAGAIN.", &LoopMetrics::writeEagain },
+    { "mymuduo_connections", "gauge", "Open connections.", &LoopMetrics::connections },
+    { "mymuduo_connections_opened_total", "counter", "Connections established.", &LoopMetrics::connectionsOpened },
+    { "mymuduo_output_backlog_bytes", "gauge", "Bytes waiting in connection output buffers.",
+      &LoopMetrics::outputBacklogBytes },
+};
+
+// scale 把内部单位换算成 Prometheus 的基本单位，例如微秒换成秒
+void appendHistogram(std::string *output, const char *name, const char *help, double scale,
+                     const std::vector<EventLoop*> &loops, const LocalHistogram LoopMetrics::*member) {
+    appendHeader(output, name, "histogram", help);
+    for (EventLoop *loop : loops) {
+        const LocalHistogram &h = loop->metrics().*member;
+        const int tid = static_cast<int>(loop->threadId());
+        int64_t cumulative = 0;
+        for (size_t i = 0; i < h.numBounds(); ++i) {
+            cumulative += h.bucket(i);
+            appendFormat(output, "%s_bucket{loop=\"%d\",le=\"%g\"} %ld\n", name, tid, h.bound(i) * scale,
+                         static_cast<long>(cumulative));
+        }
+        cumulative += h.bucket(h.numBounds());
+        appendFormat(output, "%s_bucket{loop=\"%d\",le=\"+Inf\"} %ld\n", name, tid, static_cast<long>(cumulative));
+        appendFormat(output, "%s_sum{loop=\"%d\"} %g\n", name, tid, h.sum() * scale);
+        appendFormat(output, "%s_count{loop=\"%d\"} %ld\n", name, tid, static_cast<long>(cumulative));
+    }
+}
+
+} // namespace
+
+LoopMetrics::LoopMetrics()
+    : pollEvents(kPollEventsBounds, sizeof kPollEventsBounds / sizeof kPollEventsBounds[0])
+    , iterationMicros(kIterationMicrosBounds, sizeof kIterationMicrosBounds / sizeof kIterationMicrosBounds[0])
+{}
+
+MetricsRegistry& MetricsRegistry::instance() {
+    static MetricsRegistry registry;
+    return registry;
+}
+
+void MetricsRegistry::addLoop(EventLoop *loop) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    loops_.push_back(loop);
+}
+
+void MetricsRegistry::removeLoop(EventLoop *loop) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    loops_.erase(std::remove(loops_.begin(), loops_.end(), loop), loops_.end());
+}
+
+void MetricsRegistry::forEachLoop(const std::function<void(EventLoop*)> &f) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (EventLoop *loop : loops_) {
+        f(loop);
+    }
+}
+
+void MetricsRegistry::renderPrometheus(std::string *output) {
+    // 持锁期间 loop 不会析构；读取计数不需要 loop 线程配合，loop 卡住时也能看到它的状态
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const SimpleMetric &metric : kSimpleMetrics) {
+        appendHeader(output, metric.name, metric.type, metric.help);
+        for (EventLoop *loop : loops_) {
+            appendFormat(output, "%s{loop=\"%d\"} %ld\n", metric.name, static_cast<int>(loop->threadId()),
+                         static_cast<long>((loop->metrics().*metric.counter).value()));
+        }
+    }
+
+    appendHeader(output, "mymuduo_loop_pending_functors", "gauge", "Functors queued and not yet run.");
+    for (EventLoop *loop : loops_) {
+        appendFormat(output, "mymuduo_loop_pending_functors{loop=\"%d\"} %lu\n", static_cast<int>(loop->threadId()),
+                     static_cast<unsigned long>(loop->queueSize()));
+    }
+    appendHeader(output, "mymuduo_loop_lag_seconds", "gauge", "Smoothed loop iteration time, 0 while idle.");
+    for (EventLoop *loop : loops_) {
+        appendFormat(output, "mymuduo_loop_lag_seconds{loop=\"%d\"} %g\n", static_cast<int>(loop->threadId()),
+                     loop->loopLagMicroSeconds() / 1e6);
+    }
+
+    appendHistogram(output, "mymuduo_loop_poll_events", "Events returned by one poll.", 1.0, loops_,
+                    &LoopMetrics::pollEvents);
+    appendHistogram(output, "mymuduo_loop_iteration_seconds", "Time spent handling one loop iteration.", 1e-6,
+                    loops_, &LoopMetrics::iterationMicros);
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "noncopyable.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class EventLoop;
+
+// 单写者计数器：只由所属 loop 线程修改，其他线程随时读取。
+// relaxed 的 load + store 在 x86-64 上就是普通的读-加-写，没有 lock 前缀，
+// 热路径上的开销和非原子的线程局部变量相同，同时跨线程读取也没有数据竞争。
+class LocalCounter : noncopyable {
+public:
+    LocalCounter() : value_(0) {}
+
+    void add(int64_t n = 1) {
+        value_.store(value_.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+    int64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<int64_t> value_;
+};
+
+// 单写者的固定分桶直方图，对应 Prometheus 的 histogram
+class LocalHistogram : noncopyable {
+public:
+    static const size_t kMaxBounds = 15;
+
+    // bounds 是各桶的上界（含），升序，不超过 kMaxBounds 个，最后隐含一个 +Inf 桶；
+    // bounds 必须比直方图活得久，一般是静态数组
+    LocalHistogram(const int64_t *bounds, size_t numBounds)
+        : bounds_(bounds)
+        , numBounds_(numBounds < kMaxBounds ? numBounds : kMaxBounds)
+    {}
+
+    void observe(int64_t value) {
+        size_t i = 0;
+        while (i < numBounds_ && value > bounds_[i]) {
+            ++i;
+        }
+        buckets_[i].add();
+        sum_.add(value);
+    }
+
+    size_t numBounds() const { return numBounds_; }
+    int64_t bound(size_t i) const { return bounds_[i]; }
+    // 第 i 个桶（不累计）的计数，i == numBounds() 是 +Inf 桶
+    int64_t bucket(size_t i) const { return buckets_[i].value(); }
+    int64_t sum() const { return sum_.value(); }
+
+private:
+    const int64_t *bounds_;
+    const size_t numBounds_;
+    LocalCounter buckets_[kMaxBounds + 1];
+    LocalCounter sum_;
+};
+
+// 每个 EventLoop 一份的运行指标，只在该 loop 线程中更新，汇总时由 MetricsRegistry 跨线程读取
+struct LoopMetrics : noncopyable {
+    LoopMetrics();
+
+    LocalCounter iterations;        // loop 迭代次数
+    LocalHistogram pollEvents;      // 每次 epoll_wait 返回的事件数
+    LocalHistogram iterationMicros; // 每轮迭代耗时（事件回调 + pendingFunctors_），微秒
+    LocalCounter functors;          // 执行的 pendingFunctors_ 个数
+    LocalCounter wakeups;           // 被 eventfd 唤醒的次数
+    LocalCounter stalls;            // 被 LoopWatchdog 判定卡住的次数，只由 watchdog 线程写
+
+    LocalCounter bytesRead;
+    LocalCounter bytesWritten;
+    LocalCounter readCalls;         // read/readv 系统调用次数（TLS 时是 transport 的读次数）
+    LocalCounter writeCalls;
+    LocalCounter readEagain;        // 读返回 EAGAIN 的次数
+    LocalCounter writeEagain;       // 写返回 EAGAIN 的次数，说明对端接收慢或发送缓冲区满
+
+    LocalCounter connections;       // 当前连接数（gauge）
+    LocalCounter connectionsOpened;
+    LocalCounter outputBacklogBytes; // 所有连接 outputBuffer_ 中待发送的字节数（gauge）
+};
+
+// 所有 EventLoop 的指标登记处。EventLoop 构造时登记、析构时注销，
+// 需要时（例如 MetricsServer 收到请求）遍历所有 loop 汇总成 Prometheus 文本格式
+class MetricsRegistry : noncopyable {
+public:
+    static MetricsRegistry& instance();
+
+    void addLoop(EventLoop *loop);
+    void removeLoop(EventLoop *loop);
+
+    // 按 Prometheus text exposition format 0.0.4 输出，每个 loop 一条序列，标签 loop="线程 id"
+    void renderPrometheus(std::string *output);
+    // 持锁遍历所有 loop，f 返回前 loop 不会析构；f 在调用者线程中执行，只能读 loop 的跨线程可读状态
+    void forEachLoop(const std::function<void(EventLoop*)> &f);
+
+private:
+    MetricsRegistry() {}
+
+    std::mutex mutex_;
+    std::vector<EventLoop*> loops_;
+};
@@ -0,0 +1,58 @@
+#include "MetricsServer.h"
+#include "HttpRequest.h"
+#include "HttpResponse.h"
+#include "Metrics.h"
+#include "EventLoop.h"
+
+#include <unistd.h>
+
+MetricsServer::MetricsServer(EventLoop *loop, const InetAddress &listenAddr, const std::string &name)
+    : server_(loop, listenAddr, name)
+{
+    // 抓取请求都很小，也不需要请求体
+    server_.setMaxHeaderBytes(8 * 1024);
+    server_.setMaxBodyBytes(0);
+    server_.setHttpCallback(std::bind(&MetricsServer::onRequest, this, std::placeholders::_1,
+                                      std::placeholders::_2));
+}
+
+void MetricsServer::onRequest(const HttpRequest &request, HttpResponse *response) {
+    const bool isMetrics = request.path() == "/metrics";
+    if (!isMetrics && request.path() != "/debug/trace") {
+        response->setStatusCode(HttpResponse::k404NotFound);
+        return;
+    }
+    if (request.method() != HttpRequest::kGet && request.method() != HttpRequest::kHead) {
+        response->setStatusCode(HttpResponse::k405MethodNotAllowed);
+        response->addHeader("Allow", "GET, HEAD");
+        return;
+    }
+    std::string body;
+    if (isMetrics) {
+        body.reserve(16 * 1024);
+        MetricsRegistry::instance().renderPrometheus(&body);
+        response->setContentType("text/plain; version=0.0.4; charset=utf-8");
+    } else {
+        renderTrace(&body);
+        response->setContentType("application/json");
+    }
+    response->setStatusCode(HttpResponse::k200Ok);
+    response->setBody(std::move(body));
+}
+
+void MetricsServer::renderTrace(std::string *output) {
+    // 每个 loop 一个 tid，在 trace viewer 里各占一行
+    const int pid = static_cast<int>(::getpid());
+    size_t count = 0;
+    output->append("{\"traceEvents\":[\n");
+    MetricsRegistry::instance().forEachLoop([&](EventLoop *loop) {
+        std::string events;
+        if (loop->tracer().appendChromeEvents(&events, pid, static_cast<int>(loop->threadId())) > 0) {
+            if (count++ > 0) {
+                output->append(",\n");
+            }
+            output->append(events);
+        }
+    });
+    output->append("\n]}\n");
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "HttpServer.h"
+
+#include <string>
+
+// 可选的管理端口：GET /metrics 按 Prometheus 文本格式返回 MetricsRegistry 汇总的所有 loop 的指标，
+// GET /debug/trace 返回所有 loop 的 LoopTracer 记录（Chrome trace-event JSON，可存成文件用 Perfetto 打开）。
+// 一般监听 127.0.0.1 上的单独端口，跑在主 loop 上，不占用业务的 subloop；
+// 汇总只读各 loop 的计数，业务 loop 卡住时仍然能抓到它的状态。
+//
+//   MetricsServer admin(&loop, InetAddress(9100, "127.0.0.1"));
+//   admin.start();
+class MetricsServer : noncopyable {
+public:
+    MetricsServer(EventLoop *loop, const InetAddress &listenAddr,
+                  const std::string &name = std::string("MetricsServer"));
+
+    void start() { server_.start(); }
+
+private:
+    void onRequest(const HttpRequest &request, HttpResponse *response);
+    void renderTrace(std::string *output);
+
+    HttpServer server_;
+};
@@ -0,0 +1,220 @@
+#include "RespCodec.h"
+#include "Buffer.h"
+
+#include <stdio.h>
+#include <string.h>
+
+namespace {
+
+// 解析 [begin, end) 中的十进制整数，格式错误返回 false
+bool parseInteger(const char *begin, const char *end, int64_t *value) {
+    if (begin == end) {
+        return false;
+    }
+    bool negative = false;
+    if (*begin == '-') {
+        negative = true;
+        ++begin;
+    }
+    if (begin == end || end - begin > 18) {
+        return false;
+    }
+    int64_t n = 0;
+    for (const char *p = begin; p < end; ++p) {
+        if (*p < '0' || *p > '9') {
+            return false;
+        }
+        n = n * 10 + (*p - '0');
+    }
+    *value = negative ? -n : n;
+    return true;
+}
+
+// 整数转十进制，写到 buf 末尾，返回起始位置
+char* formatInteger(int64_t value, char *bufEnd) {
+    char *p = bufEnd;
+    uint64_t n = value < 0 ? 0 - static_cast<uint64_t>(value) : static_cast<uint64_t>(value);
+    do {
+        *--p = static_cast<char>('0' + n % 10);
+        n /= 10;
+    } while (n != 0);
+    if (value < 0) {
+        *--p = '-';
+    }
+    return p;
+}
+
+bool isSpace(char c) {
+    return c == ' ' || c == '\t';
+}
+
+} // namespace
+
+bool RespCodec::decode(const Buffer *buf, RespBatch *batch) {
+    const char *base = buf->peek();
+    const char *end = buf->beginWrite();
+    const char *p = base + batch->consumedBytes_;
+
+    while (p < end) {
+        const size_t firstArg = batch->args_.size();
+        if (*p == '*') {
+            const char *crlf = buf->findCRLF(p);
+            if (crlf == nullptr) {
+                return end - p <= 32;
+            }
+            int64_t count = 0;
+            if (!parseInteger(p + 1, crlf, &count) || count > kMaxArgs) {
+                return false;
+            }
+            const char *q = crlf + 2;
+            bool complete = true;
+            for (int64_t i = 0; i < count; ++i) {
+                if (q == end) {
+                    complete = false;
+                    break;
+                }
+                if (*q != '$') {
+                    return false;
+                }
+                crlf = buf->findCRLF(q);
+                if (crlf == nullptr) {
+                    if (end - q > 32) {
+                        return false;
+                    }
+                    complete = false;
+                    break;
+                }
+                int64_t length = 0;
+                if (!parseInteger(q + 1, crlf, &length) || length < 0 || length > kMaxBulkLength) {
+                    return false;
+                }
+                const char *data = crlf + 2;
+                if (end - data < length + 2) {
+                    complete = false;
+                    break;
+                }
+                if (data[length] != '\r' || data[length + 1] != '\n') {
+                    return false;
+                }
+                batch->args_.push_back(StringPiece(data, static_cast<size_t>(length)));
+                q = data + length + 2;
+            }
+            if (!complete) {
+                // 最后一个命令还没收全，丢掉已经解析的参数，下次从命令开头重新解析
+                batch->args_.resize(firstArg);
+                break;
+            }
+            p = q;
+        } else {
+            // 内联命令
+            const char *lf = static_cast<const char*>(memchr(p, '\n', end - p));
+            if (lf == nullptr) {
+                return static_cast<size_t>(end - p) <= kMaxInlineLength;
+            }
+            const char *lineEnd = (lf > p && lf[-1] == '\r') ? lf - 1 : lf;
+            const char *q = p;
+            while (q < lineEnd) {
+                while (q < lineEnd && isSpace(*q)) {
+                    ++q;
+                }
+                const char *word = q;
+                while (q < lineEnd && !isSpace(*q)) {
+                    ++q;
+                }
+                if (q > word) {
+                    batch->args_.push_back(StringPiece(word, q - word));
+                }
+            }
+            p = lf + 1;
+        }
+        size_t argc = batch->args_.size() - firstArg;
+        // 空数组和空行不是命令
+        if (argc > 0) {
+            batch->commands_.push_back(std::make_pair(firstArg, argc));
+        }
+        batch->consumedBytes_ = p - base;
+    }
+    return true;
+}
+
+void RespWriter::appendLine(char prefix, int64_t value) {
+    char buf[32];
+    char *bufEnd = buf + sizeof buf;
+    char *begin = formatInteger(value, bufEnd - 2);
+    *--begin = prefix;
+    bufEnd[-2] = '\r';
+    bufEnd[-1] = '\n';
+    output_->append(begin, bufEnd - begin);
+}
+
+void RespWriter::status(const StringPiece &s) {
+    output_->ensureWriteableBytes(s.size() + 3);
+    char *p = output_->beginWrite();
+    *p = '+';
+    memcpy(p + 1, s.data(), s.size());
+    memcpy(p + 1 + s.size(), "\r\n", 2);
+    output_->hasWritten(s.size() + 3);
+}
+
+void RespWriter::error(const StringPiece &s) {
+    output_->ensureWriteableBytes(s.size() + 3);
+    char *p = output_->beginWrite();
+    *p = '-';
+    memcpy(p + 1, s.data(), s.size());
+    memcpy(p + 1 + s.size(), "\r\n", 2);
+    output_->hasWritten(s.size() + 3);
+}
+
+void RespWriter::integer(int64_t value) {
+    appendLine(':', value);
+}
+
+void RespWriter::bulk(const StringPiece &s) {
+    // 一次确保空间，头部、数据和结尾的 CRLF 直接写进去
+    output_->ensureWriteableBytes(s.size() + 32);
+    appendLine('$', static_cast<int64_t>(s.size()));
+    char *p = output_->beginWrite();
+    memcpy(p, s.data(), s.size());
+    memcpy(p + s.size(), "\r\n", 2);
+    output_->hasWritten(s.size() + 2);
+}
+
+void RespWriter::null() {
+    if (protocol_ >= 3) {
+        output_->append("_\r\n", 3);
+    } else {
+        output_->append("$-1\r\n", 5);
+    }
+}
+
+void RespWriter::arrayHeader(size_t n) {
+    appendLine('*', static_cast<int64_t>(n));
+}
+
+void RespWriter::mapHeader(size_t n) {
+    if (protocol_ >= 3) {
+        appendLine('%', static_cast<int64_t>(n));
+    } else {
+        appendLine('*', static_cast<int64_t>(n * 2));
+    }
+}
+
+void RespWriter::boolean(bool value) {
+    if (protocol_ >= 3) {
+        output_->append(value ? "#t\r\n" : "#f\r\n", 4);
+    } else {
+        integer(value ? 1 : 0);
+    }
+}
+
+void RespWriter::doubleValue(double value) {
+    char buf[32];
+    int n = snprintf(buf, sizeof buf, "%.17g", value);
+    if (protocol_ >= 3) {
+        output_->append(",", 1);
+        output_->append(buf, n);
+        output_->append("\r\n", 2);
+    } else {
+        bulk(StringPiece(buf, n));
+    }
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "StringPiece.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+class Buffer;
+
+// 一批解码出来的命令。参数是指向输入 Buffer 的 StringPiece，
+// 所有命令的参数连续存放在同一个 vector（arena）里，clear() 后容量保留，稳定运行时不再分配内存。
+// 只在 Buffer retrieve(consumedBytes()) 之前有效。
+class RespBatch {
+public:
+    RespBatch() : consumedBytes_(0) {}
+
+    size_t size() const { return commands_.size(); }
+    bool empty() const { return commands_.empty(); }
+    // 第 i 个命令的参数，argv(i)[0] 是命令名
+    const StringPiece* argv(size_t i) const { return args_.data() + commands_[i].first; }
+    size_t argc(size_t i) const { return commands_[i].second; }
+
+    // 这批完整命令在 Buffer 中占用的字节数
+    size_t consumedBytes() const { return consumedBytes_; }
+
+    void clear() {
+        args_.clear();
+        commands_.clear();
+        consumedBytes_ = 0;
+    }
+
+private:
+    friend class RespCodec;
+
+    std::vector<StringPiece> args_;
+    std::vector<std::pair<size_t, size_t>> commands_; // (第一个参数在 args_ 中的下标, 参数个数)
+    size_t consumedBytes_;
+};
+
+// RESP 请求解码。请求在 RESP2 和 RESP3 中格式相同：多条批量字符串组成的数组，
+// 或者 telnet 风格的内联命令（一行，空格分隔）。
+class RespCodec {
+public:
+    static const int64_t kMaxArgs = 1024 * 1024;
+    static const int64_t kMaxBulkLength = 64 * 1024 * 1024;
+    static const size_t kMaxInlineLength = 64 * 1024;
+
+    // 一遍扫描 buf，把其中所有完整的命令追加到 batch，不完整的命令留到下次；
+    // 协议错误时返回 false，此时 batch 中已经解出的命令仍然有效
+    static bool decode(const Buffer *buf, RespBatch *batch);
+};
+
+// 直接把回复编码进 Buffer（通常是 TcpConnection::outputBuffer()），不经过中间字符串。
+// protocol 为 3 时使用 RESP3 的 null、map、boolean、double 类型，否则退化为 RESP2 的表示。
+class RespWriter {
+public:
+    explicit RespWriter(Buffer *output, int protocol = 2)
+        : output_(output)
+        , protocol_(protocol)
+    {}
+
+    void setProtocol(int protocol) { protocol_ = protocol; }
+
+    void status(const StringPiece &s);     // +OK
+    void error(const StringPiece &s);      // -ERR ...
+    void integer(int64_t value);           // :1
+    void bulk(const StringPiece &s);       // $3 foo
+    void null();                           // $-1 / _
+    void arrayHeader(size_t n);            // *n
+    void mapHeader(size_t n);              // %n / *2n
+    void boolean(bool value);              // #t / :1
+    void doubleValue(double value);        // ,1.5 / $3 1.5
+
+private:
+    // prefix + 十进制整数 + CRLF
+    void appendLine(char prefix, int64_t value);
+
+    Buffer *output_;
+    int protocol_;
+};
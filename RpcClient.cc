@@ -0,0 +1,127 @@
+#include "RpcClient.h"
+#include "EventLoop.h"
+#include "Logger.h"
+
+RpcClient::RpcClient(EventLoop *loop, const InetAddress &serverAddr, const std::string &name)
+    : loop_(loop)
+    , client_(loop, serverAddr, name)
+    , connected_(false)
+    , nextId_(1)
+{
+    client_.setConnectionCallback(std::bind(&RpcClient::onConnection, this, std::placeholders::_1));
+    client_.setMessageCallback(std::bind(&RpcClient::onMessage, this, std::placeholders::_1,
+                                         std::placeholders::_2, std::placeholders::_3));
+}
+
+RpcClient::~RpcClient() {
+    for (auto &entry : pending_) {
+        if (entry.second.timer.valid()) {
+            loop_->cancel(entry.second.timer);
+        }
+    }
+}
+
+void RpcClient::connect() {
+    client_.connect();
+}
+
+void RpcClient::disconnect() {
+    client_.disconnect();
+}
+
+void RpcClient::call(const std::string &method, const std::string &request, double timeout,
+                     const Callback &cb) {
+    if (loop_->isInLoopThread()) {
+        callInLoop(method, request, timeout, cb);
+    } else {
+        loop_->queueInLoop([=]() { callInLoop(method, request, timeout, cb); });
+    }
+}
+
+void RpcClient::callInLoop(const std::string &method, const std::string &request, double timeout,
+                           const Callback &cb) {
+    uint64_t id = nextId_++;
+    PendingCall &call = pending_[id];
+    call.callback = cb;
+    uint32_t timeoutMs = 0;
+    if (timeout > 0) {
+        timeoutMs = static_cast<uint32_t>(timeout * 1000);
+        call.timer = loop_->runAfter(timeout, std::bind(&RpcClient::timeoutInLoop, this, id));
+    }
+    if (connection_) {
+        RpcWriteBatch *batch = static_cast<RpcWriteBatch*>(connection_->getContext().get());
+        RpcCodec::appendRequest(batch->output(), id, method, timeoutMs, request);
+        batch->flushSoon(connection_);
+    } else {
+        RpcCodec::appendRequest(&queued_, id, method, timeoutMs, request);
+    }
+}
+
+void RpcClient::onConnection(const TcpConnectionPtr &conn) {
+    if (conn->connected()) {
+        std::shared_ptr<RpcWriteBatch> batch = std::make_shared<RpcWriteBatch>();
+        conn->setContext(batch);
+        connection_ = conn;
+        connected_ = true;
+        if (!queued_.empty()) {
+            batch->output()->swap(queued_);
+            batch->flushSoon(conn);
+        }
+    } else {
+        LOG_INFO("RpcClient connection %s down, %lu calls failed\n", conn->name().c_str(),
+                 static_cast<unsigned long>(pending_.size()));
+        connection_.reset();
+        connected_ = false;
+        failAll(kRpcUnavailable);
+    }
+}
+
+void RpcClient::onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp) {
+    while (true) {
+        RpcFrame frame;
+        ssize_t n = RpcCodec::decode(buf, &frame);
+        if (n == 0) {
+            break;
+        }
+        if (n < 0 || frame.type != RpcFrame::kResponse) {
+            LOG_ERROR("RpcClient bad frame from %s\n", conn->peerAddress().toIpPort().c_str());
+            buf->retrieveAll();
+            conn->forceClose();
+            return;
+        }
+        auto it = pending_.find(frame.id);
+        // 找不到说明调用已经超时
+        if (it != pending_.end()) {
+            Callback cb;
+            cb.swap(it->second.callback);
+            if (it->second.timer.valid()) {
+                loop_->cancel(it->second.timer);
+            }
+            pending_.erase(it);
+            cb(frame.status, frame.body);
+        }
+        buf->retrieve(n);
+    }
+}
+
+void RpcClient::timeoutInLoop(uint64_t id) {
+    auto it = pending_.find(id);
+    if (it != pending_.end()) {
+        Callback cb;
+        cb.swap(it->second.callback);
+        pending_.erase(it);
+        cb(kRpcDeadlineExceeded, StringPiece());
+    }
+}
+
+void RpcClient::failAll(RpcStatus status) {
+    std::unordered_map<uint64_t, PendingCall> pending;
+    pending.swap(pending_);
+    queued_.clear();
+    for (auto &entry : pending) {
+        if (entry.second.timer.valid()) {
+            loop_->cancel(entry.second.timer);
+        }
+        entry.second.callback(status, StringPiece());
+    }
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "RpcCodec.h"
+#include "TcpClient.h"
+#include "TimerId.h"
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <unordered_map>
+
+// RpcServer 的客户端：一个连接上同时发出任意多个调用，响应按 id 匹配，到达顺序不限。
+// 同一轮 loop 迭代中发出的调用合成一次 send。连接建立之前发出的调用先排队，连上后一起发出；
+// 连接断开时所有未完成的调用以 kRpcUnavailable 结束。
+class RpcClient : noncopyable {
+public:
+    // 在 loop 线程中执行；response 指向连接的 inputBuffer_，只在回调执行期间有效
+    using Callback = std::function<void(RpcStatus status, const StringPiece &response)>;
+
+    RpcClient(EventLoop *loop, const InetAddress &serverAddr, const std::string &name);
+    // 需在 loop 线程中析构，未完成的调用不再回调
+    ~RpcClient();
+
+    void connect();
+    void disconnect();
+    // 断开后自动重连
+    void enableRetry() { client_.enableRetry(); }
+    bool connected() const { return connected_; }
+
+    // 可跨线程调用。timeout 单位秒，0 表示不限制；超时后以 kRpcDeadlineExceeded 回调，
+    // 之后到达的响应被丢弃。超时时间随请求发给服务端，服务端不再执行已经过期的请求
+    void call(const std::string &method, const std::string &request, double timeout, const Callback &cb);
+
+    // 未完成的调用个数，只在 loop 线程中调用
+    size_t numPending() const { return pending_.size(); }
+
+private:
+    struct PendingCall {
+        Callback callback;
+        TimerId timer;
+    };
+
+    void callInLoop(const std::string &method, const std::string &request, double timeout,
+                    const Callback &cb);
+    void onConnection(const TcpConnectionPtr &conn);
+    void onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp receiveTime);
+    void timeoutInLoop(uint64_t id);
+    void failAll(RpcStatus status);
+
+    EventLoop *loop_;
+    TcpClient client_;
+    std::atomic_bool connected_;
+    // 以下只在 loop 线程中访问
+    TcpConnectionPtr connection_;
+    std::string queued_; // 连接建立之前发出的请求
+    uint64_t nextId_;
+    std::unordered_map<uint64_t, PendingCall> pending_;
+};
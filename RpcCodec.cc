@@ -0,0 +1,110 @@
+#include "RpcCodec.h"
+#include "Buffer.h"
+#include "EventLoop.h"
+#include "TcpConnection.h"
+
+#include <endian.h>
+#include <string.h>
+
+namespace {
+
+void appendFrame(std::string *output, RpcFrame::Type type, RpcStatus status, uint64_t id,
+                 const StringPiece &method, uint32_t timeoutMs, const StringPiece &body) {
+    char header[RpcCodec::kHeaderSize];
+    uint32_t length = htobe32(static_cast<uint32_t>(RpcCodec::kHeaderSize - 4 + method.size() + body.size()));
+    uint16_t methodLen = htobe16(static_cast<uint16_t>(method.size()));
+    uint64_t beId = htobe64(id);
+    uint32_t timeout = htobe32(timeoutMs);
+    memcpy(header, &length, 4);
+    header[4] = static_cast<char>(type);
+    header[5] = static_cast<char>(status);
+    memcpy(header + 6, &methodLen, 2);
+    memcpy(header + 8, &beId, 8);
+    memcpy(header + 16, &timeout, 4);
+    output->append(header, sizeof header);
+    output->append(method.data(), method.size());
+    output->append(body.data(), body.size());
+}
+
+} // namespace
+
+const char* rpcStatusName(RpcStatus status) {
+    switch (status)
+    {
+    case kRpcOk:
+        return "ok";
+    case kRpcMethodNotFound:
+        return "method not found";
+    case kRpcDeadlineExceeded:
+        return "deadline exceeded";
+    case kRpcUnavailable:
+        return "unavailable";
+    case kRpcOverloaded:
+        return "overloaded";
+    case kRpcError:
+        return "error";
+    default:
+        return "unknown";
+    }
+}
+
+void RpcCodec::appendRequest(std::string *output, uint64_t id, const StringPiece &method,
+                             uint32_t timeoutMs, const StringPiece &body) {
+    appendFrame(output, RpcFrame::kRequest, kRpcOk, id, method, timeoutMs, body);
+}
+
+void RpcCodec::appendResponse(std::string *output, uint64_t id, RpcStatus status,
+                              const StringPiece &body) {
+    appendFrame(output, RpcFrame::kResponse, status, id, StringPiece(), 0, body);
+}
+
+ssize_t RpcCodec::decode(const Buffer *buf, RpcFrame *frame) {
+    if (buf->readableBytes() < kHeaderSize) {
+        return 0;
+    }
+    const char *data = buf->peek();
+    uint32_t length;
+    uint16_t methodLen;
+    uint64_t id;
+    uint32_t timeoutMs;
+    memcpy(&length, data, 4);
+    memcpy(&methodLen, data + 6, 2);
+    memcpy(&id, data + 8, 8);
+    memcpy(&timeoutMs, data + 16, 4);
+    length = be32toh(length);
+    methodLen = be16toh(methodLen);
+
+    uint8_t type = static_cast<uint8_t>(data[4]);
+    if (length < kHeaderSize - 4 || length > kMaxFrameSize ||
+        methodLen > length - (kHeaderSize - 4) ||
+        (type != RpcFrame::kRequest && type != RpcFrame::kResponse)) {
+        return -1;
+    }
+    size_t frameSize = length + 4;
+    if (buf->readableBytes() < frameSize) {
+        return 0;
+    }
+    frame->type = static_cast<RpcFrame::Type>(type);
+    frame->status = static_cast<RpcStatus>(static_cast<uint8_t>(data[5]));
+    frame->id = be64toh(id);
+    frame->timeoutMs = be32toh(timeoutMs);
+    frame->method = StringPiece(data + kHeaderSize, methodLen);
+    frame->body = StringPiece(data + kHeaderSize + methodLen, frameSize - kHeaderSize - methodLen);
+    return static_cast<ssize_t>(frameSize);
+}
+
+void RpcWriteBatch::flushSoon(const TcpConnectionPtr &conn) {
+    if (!scheduled_) {
+        scheduled_ = true;
+        // pendingFunctors_ 在本轮所有事件回调之后执行，期间追加的帧都会合进这一次 send
+        conn->getLoop()->queueInLoop(std::bind(&RpcWriteBatch::flush, this, conn));
+    }
+}
+
+void RpcWriteBatch::flush(const TcpConnectionPtr &conn) {
+    scheduled_ = false;
+    if (!output_.empty()) {
+        conn->send(output_);
+        output_.clear();
+    }
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "Callbacks.h"
+#include "StringPiece.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+class Buffer;
+
+enum RpcStatus {
+    kRpcOk = 0,
+    kRpcMethodNotFound,
+    kRpcDeadlineExceeded,
+    kRpcUnavailable, // 连接断开或还没有建立
+    kRpcOverloaded,  // 服务端计算线程池队列已满
+    kRpcError,       // 业务处理失败，响应体里是错误信息
+};
+
+const char* rpcStatusName(RpcStatus status);
+
+// 一个已解码的帧，method/body 指向输入 Buffer，只在解码后、retrieve 之前有效
+struct RpcFrame {
+    enum Type {
+        kRequest = 1,
+        kResponse = 2,
+    };
+    Type type;
+    RpcStatus status;   // 只对响应有意义
+    uint64_t id;        // 调用方分配，响应原样带回，用来匹配乱序到达的响应
+    uint32_t timeoutMs; // 请求发出时剩余的时间，0 表示不限制
+    StringPiece method;
+    StringPiece body;
+};
+
+// 帧格式，整数都是网络字节序：
+//   uint32 length     后面所有字节数
+//   uint8  type
+//   uint8  status
+//   uint16 methodLen
+//   uint64 id
+//   uint32 timeoutMs
+//   method, body
+class RpcCodec {
+public:
+    static const size_t kHeaderSize = 20;
+    static const size_t kMaxFrameSize = 64 * 1024 * 1024;
+
+    static void appendRequest(std::string *output, uint64_t id, const StringPiece &method,
+                              uint32_t timeoutMs, const StringPiece &body);
+    static void appendResponse(std::string *output, uint64_t id, RpcStatus status,
+                               const StringPiece &body);
+
+    // 解码 buf 开头的一个帧，返回整个帧的字节数；不完整返回 0，格式错误返回 -1
+    static ssize_t decode(const Buffer *buf, RpcFrame *frame);
+};
+
+// 同一轮 loop 迭代中产生的小帧先攒在一起，本轮的事件和回调都处理完之后合成一次 send，
+// 作为连接的 context 挂在 TcpConnection 上，只在 loop 线程中访问
+class RpcWriteBatch : noncopyable {
+public:
+    RpcWriteBatch() : scheduled_(false) {}
+
+    std::string* output() { return &output_; }
+    // 帧已经追加到 output() 之后调用
+    void flushSoon(const TcpConnectionPtr &conn);
+
+private:
+    void flush(const TcpConnectionPtr &conn);
+
+    std::string output_;
+    bool scheduled_;
+};
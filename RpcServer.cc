@@ -0,0 +1,127 @@
+#include "RpcServer.h"
+#include "Logger.h"
+
+RpcServer::RpcServer(EventLoop *loop, const InetAddress &listenAddr, const std::string &name)
+    : server_(loop, listenAddr, name)
+    , pool_(name + "-compute")
+    , computeThreads_(0)
+{
+    server_.setConnectionCallback(std::bind(&RpcServer::onConnection, this, std::placeholders::_1));
+    server_.setMessageCallback(std::bind(&RpcServer::onMessage, this, std::placeholders::_1,
+                                         std::placeholders::_2, std::placeholders::_3));
+}
+
+RpcServer::~RpcServer() {
+    pool_.stop();
+}
+
+void RpcServer::registerMethod(const std::string &method, const Handler &handler, ExecMode mode) {
+    Method &m = methods_[method];
+    m.handler = handler;
+    m.mode = mode;
+}
+
+void RpcServer::start() {
+    if (computeThreads_ > 0) {
+        pool_.start(computeThreads_);
+    }
+    server_.start();
+}
+
+void RpcServer::onConnection(const TcpConnectionPtr &conn) {
+    if (conn->connected()) {
+        conn->setContext(std::make_shared<Session>(conn->getLoop()));
+    } else if (conn->getContext()) {
+        Session *session = static_cast<Session*>(conn->getContext().get());
+        std::lock_guard<std::mutex> lock(session->loopRef->mutex);
+        session->loopRef->loop = nullptr;
+    }
+}
+
+void RpcServer::onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp receiveTime) {
+    // 一次读到的所有完整帧都在这里分发，它们的响应由 RpcWriteBatch 合并成一次 send
+    while (true) {
+        RpcFrame frame;
+        ssize_t n = RpcCodec::decode(buf, &frame);
+        if (n == 0) {
+            break;
+        }
+        if (n < 0 || frame.type != RpcFrame::kRequest) {
+            LOG_ERROR("RpcServer bad frame from %s\n", conn->peerAddress().toIpPort().c_str());
+            buf->retrieveAll();
+            conn->forceClose();
+            return;
+        }
+        dispatch(conn, frame, receiveTime);
+        buf->retrieve(n);
+    }
+}
+
+void RpcServer::dispatch(const TcpConnectionPtr &conn, const RpcFrame &frame, Timestamp receiveTime) {
+    auto it = methods_.find(frame.method.toString());
+    if (it == methods_.end()) {
+        sendResponse(conn, frame.id, kRpcMethodNotFound, frame.method);
+        return;
+    }
+    const Method &method = it->second;
+    Timestamp deadline;
+    if (frame.timeoutMs > 0) {
+        deadline = addTime(receiveTime, frame.timeoutMs / 1000.0);
+    }
+    Done done = makeDone(conn, frame.id);
+
+    if (method.mode == kInLoop || computeThreads_ == 0) {
+        method.handler(frame.body, deadline, done);
+        return;
+    }
+    // 请求体在 retrieve 之后就失效了，交给线程池前必须拷贝
+    // methods_ 在 start() 之后不再变化，可以直接引用其中的 Handler
+    const Handler *handler = &method.handler;
+    std::string request(frame.body.data(), frame.body.size());
+    bool queued = pool_.run([handler, request, deadline, done]() {
+        // 在队列里等待期间已经过期，调用方不再需要结果
+        if (deadline.valid() && Timestamp::now() > deadline) {
+            done(kRpcDeadlineExceeded, StringPiece());
+            return;
+        }
+        (*handler)(request, deadline, done);
+    });
+    if (!queued) {
+        done(kRpcOverloaded, StringPiece());
+    }
+}
+
+RpcServer::Done RpcServer::makeDone(const TcpConnectionPtr &conn, uint64_t id) {
+    std::weak_ptr<TcpConnection> weakConn(conn);
+    LoopRefPtr loopRef = static_cast<Session*>(conn->getContext().get())->loopRef;
+    return [weakConn, loopRef, id](RpcStatus status, const StringPiece &response) {
+        std::unique_lock<std::mutex> lock(loopRef->mutex);
+        EventLoop *loop = loopRef->loop;
+        // 连接已经断开，响应没有人要了，loop 也可能已经退出
+        if (loop == nullptr) {
+            return;
+        }
+        if (loop->isInLoopThread()) {
+            lock.unlock();
+            sendResponse(weakConn, id, status, response);
+        } else {
+            // 跨线程回复时拷贝一份响应，调用方的数据在 loop 执行前可能已经析构
+            std::string copy(response.data(), response.size());
+            loop->queueInLoop([weakConn, id, status, copy]() {
+                sendResponse(weakConn, id, status, copy);
+            });
+        }
+    };
+}
+
+void RpcServer::sendResponse(const std::weak_ptr<TcpConnection> &weakConn, uint64_t id,
+                             RpcStatus status, const StringPiece &response) {
+    TcpConnectionPtr conn = weakConn.lock();
+    // 连接已经断开，响应没有人要了
+    if (!conn || !conn->connected()) {
+        return;
+    }
+    RpcWriteBatch *batch = &static_cast<Session*>(conn->getContext().get())->batch;
+    RpcCodec::appendResponse(batch->output(), id, status, response);
+    batch->flushSoon(conn);
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "RpcCodec.h"
+#include "TcpServer.h"
+#include "ThreadPool.h"
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// 多路复用的 RPC 服务端：一个连接上可以同时有任意多个请求在途，
+// 每个请求带 id，处理完即回复，响应可以和请求的顺序不同。
+// 方法可以在连接所属的 loop 线程中直接执行（轻量的方法），
+// 也可以交给计算线程池（耗时的方法），线程池队列满时回复 kRpcOverloaded。
+// 请求带有调用方剩余的超时时间，开始执行前已经过期的请求不再执行，直接回复 kRpcDeadlineExceeded。
+class RpcServer : noncopyable {
+public:
+    // 回复请求，必须且只能调用一次，可跨线程调用
+    using Done = std::function<void(RpcStatus status, const StringPiece &response)>;
+    // request 在 kInLoop 方法中指向连接的 inputBuffer_，只在 Handler 执行期间有效；
+    // deadline 无效（!valid()）表示调用方没有限制时间
+    using Handler = std::function<void(const StringPiece &request, Timestamp deadline, const Done &done)>;
+
+    enum ExecMode {
+        kInLoop,
+        kInPool,
+    };
+
+    RpcServer(EventLoop *loop, const InetAddress &listenAddr, const std::string &name);
+    ~RpcServer();
+
+    // 需在 start() 之前注册
+    void registerMethod(const std::string &method, const Handler &handler, ExecMode mode = kInLoop);
+
+    void setThreadNum(int numThreads) { server_.setThreadNum(numThreads); }
+    // kInPool 方法使用的计算线程数和队列上限，需在 start() 之前设置
+    void setComputeThreadNum(int numThreads) { computeThreads_ = numThreads; }
+    void setComputeQueueSize(size_t maxSize) { pool_.setMaxQueueSize(maxSize); }
+
+    TcpServer* server() { return &server_; }
+
+    void start();
+
+private:
+    struct Method {
+        Handler handler;
+        ExecMode mode;
+    };
+
+    // 连接所属的 loop，连接断开时在 loop 线程中清空。计算线程里的 done 可能在连接断开、
+    // loop 因缩容退出（TcpServer::resizeThreadPool）之后才执行，跨线程回复前在锁内检查
+    struct LoopRef {
+        explicit LoopRef(EventLoop *l) : loop(l) {}
+        std::mutex mutex;
+        EventLoop *loop;
+    };
+    using LoopRefPtr = std::shared_ptr<LoopRef>;
+    // 连接的 context
+    struct Session {
+        explicit Session(EventLoop *loop) : loopRef(std::make_shared<LoopRef>(loop)) {}
+        RpcWriteBatch batch;
+        LoopRefPtr loopRef;
+    };
+
+    void onConnection(const TcpConnectionPtr &conn);
+    void onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp receiveTime);
+    void dispatch(const TcpConnectionPtr &conn, const RpcFrame &frame, Timestamp receiveTime);
+
+    static Done makeDone(const TcpConnectionPtr &conn, uint64_t id);
+    static void sendResponse(const std::weak_ptr<TcpConnection> &weakConn, uint64_t id,
+                             RpcStatus status, const StringPiece &response);
+
+    TcpServer server_;
+    ThreadPool pool_;
+    int computeThreads_;
+    // start() 之后只读
+    std::unordered_map<std::string, Method> methods_;
+};
@@ -17,7 +17,7 @@ Socket::~Socket(){
 }
 
 void Socket::bindAddress(const InetAddress &localaddr){
-    if (0 != ::bind(sockfd_, (sockaddr*)localaddr.getSockAddr(), sizeof(sockaddr_in))){
+    if (0 != ::bind(sockfd_, localaddr.getSockAddr(), localaddr.getSockAddrLen())){
         LOG_FATAL("bind sockfd: %d fail, errno: %d, error: %s\n", sockfd_, errno, strerror(errno));
     }
 }
@@ -30,13 +30,13 @@ void Socket::listen(){
 }
 
 int Socket::accept(InetAddress *peeraddr){
-    sockaddr_in addr;
+    sockaddr_storage addr;
     socklen_t len = sizeof addr;
     bzero(&addr, len);
     
     int connfd = ::accept4(sockfd_, (sockaddr*)&addr, &len, SOCK_NONBLOCK | SOCK_CLOEXEC);
     if (connfd >= 0){
-        peeraddr->setSockAddr(addr);
+        peeraddr->setSockAddr((sockaddr*)&addr, len);
     }
     return connfd;
 }
@@ -65,3 +65,54 @@ void Socket::setKeepAlive(bool on){
     ::setsockopt(sockfd_, SOL_SOCKET, SO_KEEPALIVE, &optval, sizeof optval);
 }
 
+namespace sockets {
+
+InetAddress getLocalAddr(int sockfd){
+    sockaddr_storage local;
+    bzero(&local, sizeof local);
+    socklen_t addrlen = sizeof local;
+    if(::getsockname(sockfd, (sockaddr*)&local, &addrlen) < 0){
+        LOG_ERROR("sockets::getLocalAddr err:%d\n", errno);
+    }
+    return InetAddress((sockaddr*)&local, addrlen);
+}
+
+InetAddress getPeerAddr(int sockfd){
+    sockaddr_storage peer;
+    bzero(&peer, sizeof peer);
+    socklen_t addrlen = sizeof peer;
+    if(::getpeername(sockfd, (sockaddr*)&peer, &addrlen) < 0){
+        LOG_ERROR("sockets::getPeerAddr err:%d\n", errno);
+    }
+    return InetAddress((sockaddr*)&peer, addrlen);
+}
+
+bool getPeerCredentials(int sockfd, ucred *cred){
+    socklen_t len = sizeof *cred;
+    if(::getsockopt(sockfd, SOL_SOCKET, SO_PEERCRED, cred, &len) < 0){
+        LOG_ERROR("sockets::getPeerCredentials err:%d\n", errno);
+        return false;
+    }
+    return true;
+}
+
+int getSocketError(int sockfd){
+    int optval;
+    socklen_t optlen = sizeof optval;
+    if(::getsockopt(sockfd, SOL_SOCKET, SO_ERROR, &optval, &optlen) < 0){
+        return errno;
+    }
+    return optval;
+}
+
+bool isSelfConnect(int sockfd){
+    InetAddress local = getLocalAddr(sockfd);
+    InetAddress peer = getPeerAddr(sockfd);
+    if(local.isUnix() || peer.isUnix()){
+        return false;
+    }
+    return local.getSockAddrInet()->sin_port == peer.getSockAddrInet()->sin_port &&
+           local.getSockAddrInet()->sin_addr.s_addr == peer.getSockAddrInet()->sin_addr.s_addr;
+}
+
+} // namespace sockets
@@ -1,8 +1,9 @@
 #pragma once
 
 #include "noncopyable.h"
+#include "InetAddress.h"
 
-class InetAddress;
+#include <sys/socket.h> // ucred
 
 class Socket : noncopyable {
 public:
@@ -27,4 +28,16 @@ public:
 
 private:
     const int sockfd_;
-};
\ No newline at end of file
+};
+
+// 直接操作 fd 的辅助函数，供还没有交给 Socket 管理的 fd 使用
+namespace sockets {
+InetAddress getLocalAddr(int sockfd);
+InetAddress getPeerAddr(int sockfd);
+// Unix 域连接对端进程的 pid/uid/gid（SO_PEERCRED），取的是对端 connect 或 listen 时的身份
+bool getPeerCredentials(int sockfd, ucred *cred);
+// 读取并清除 SO_ERROR
+int getSocketError(int sockfd);
+// 连接本机端口时，可能连到自己（源端口恰好等于目的端口）
+bool isSelfConnect(int sockfd);
+} // namespace sockets
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <string.h>
+#include <strings.h>
+
+#include <string>
+
+// 指向一段已有内存的只读字符串，不拥有数据，也不保证以 '\0' 结尾（C++11 里没有 std::string_view）。
+// 用来在不拷贝的前提下引用 Buffer 里的数据，只在被引用的内存有效期间有效。
+class StringPiece {
+public:
+    StringPiece()
+        : ptr_(nullptr)
+        , length_(0)
+    {}
+    StringPiece(const char *str)
+        : ptr_(str)
+        , length_(strlen(str))
+    {}
+    StringPiece(const std::string &str)
+        : ptr_(str.data())
+        , length_(str.size())
+    {}
+    StringPiece(const char *ptr, size_t len)
+        : ptr_(ptr)
+        , length_(len)
+    {}
+
+    const char* data() const { return ptr_; }
+    size_t size() const { return length_; }
+    bool empty() const { return length_ == 0; }
+    const char* begin() const { return ptr_; }
+    const char* end() const { return ptr_ + length_; }
+    char operator[](size_t i) const { return ptr_[i]; }
+
+    void clear() {
+        ptr_ = nullptr;
+        length_ = 0;
+    }
+    void removePrefix(size_t n) {
+        ptr_ += n;
+        length_ -= n;
+    }
+    void removeSuffix(size_t n) { length_ -= n; }
+
+    bool operator==(const StringPiece &x) const {
+        return length_ == x.length_ && memcmp(ptr_, x.ptr_, length_) == 0;
+    }
+    bool operator!=(const StringPiece &x) const { return !(*this == x); }
+
+    // ASCII 大小写不敏感的比较，HTTP 头部名字用
+    bool equalsIgnoreCase(const StringPiece &x) const {
+        return length_ == x.length_ && strncasecmp(ptr_, x.ptr_, length_) == 0;
+    }
+    bool startsWith(const StringPiece &x) const {
+        return length_ >= x.length_ && memcmp(ptr_, x.ptr_, x.length_) == 0;
+    }
+
+    std::string toString() const { return std::string(ptr_, length_); }
+
+private:
+    const char *ptr_;
+    size_t length_;
+};
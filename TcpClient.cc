@@ -0,0 +1,116 @@
+#include "TcpClient.h"
+#include "EventLoop.h"
+#include "Logger.h"
+#include "Socket.h"
+
+#include <functional>
+#include <unistd.h>
+
+static EventLoop *CheckLoopNotNull(EventLoop *loop) {
+    if (loop == nullptr) {
+        LOG_FATAL("%s:%s:%d loop is null! \n", __FILE__, __FUNCTION__, __LINE__);
+    }
+    return loop;
+}
+
+TcpClient::TcpClient(EventLoop *loop, const InetAddress &serverAddr, const std::string &nameArg)
+    : loop_(CheckLoopNotNull(loop))
+    , connector_(new Connector(loop, serverAddr))
+    , name_(nameArg)
+    , connNamePrefix_(std::make_shared<const std::string>(name_ + "-" + serverAddr.toIpPort()))
+    , connectionCallback_([](const TcpConnectionPtr&) {})
+    , messageCallback_([](const TcpConnectionPtr&, Buffer *buf, Timestamp) { buf->retrieveAll(); })
+    , retry_(false)
+    , connect_(true)
+    , nextConnId_(1)
+{
+    connector_->setNewConnectionCallback(
+        std::bind(&TcpClient::newConnection, this, std::placeholders::_1));
+    LOG_INFO("TcpClient::TcpClient[%s] - connector %p\n", name_.c_str(), connector_.get());
+}
+
+TcpClient::~TcpClient() {
+    LOG_INFO("TcpClient::~TcpClient[%s] - connector %p\n", name_.c_str(), connector_.get());
+    TcpConnectionPtr conn;
+    bool unique = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        unique = connection_.unique();
+        conn = connection_;
+    }
+    if (conn) {
+        // 连接的 closeCallback_ 还指向本对象，换成只销毁连接
+        EventLoop *loop = loop_;
+        CloseCallback cb = [loop](const TcpConnectionPtr &c) {
+            loop->queueInLoop(std::bind(&TcpConnection::connectDestroyed, c));
+        };
+        loop_->runInLoop([conn, cb]() { conn->setCloseCallback(cb); });
+        if (unique) {
+            conn->forceClose();
+        }
+    } else {
+        connector_->stop();
+    }
+}
+
+void TcpClient::connect() {
+    LOG_INFO("TcpClient::connect[%s] - connecting to %s\n", name_.c_str(),
+             connector_->serverAddress().toIpPort().c_str());
+    connect_ = true;
+    connector_->start();
+}
+
+void TcpClient::disconnect() {
+    connect_ = false;
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (connection_) {
+        connection_->shutdown();
+    }
+}
+
+void TcpClient::stop() {
+    connect_ = false;
+    connector_->stop();
+}
+
+void TcpClient::newConnection(int sockfd) {
+    std::unique_ptr<Transport> transport;
+    if (transportFactory_) {
+        transport = transportFactory_(sockfd);
+        if (!transport) {
+            LOG_ERROR("TcpClient::newConnection[%s] - create transport failed\n", name_.c_str());
+            ::close(sockfd);
+            return;
+        }
+    }
+    InetAddress peerAddr(sockets::getPeerAddr(sockfd));
+    InetAddress localAddr(sockets::getLocalAddr(sockfd));
+    TcpConnectionPtr conn(new TcpConnection(loop_, nextConnId_++, connNamePrefix_,
+                                            sockfd, localAddr, peerAddr));
+    conn->setConnectinCallback(connectionCallback_);
+    conn->setMessageCallback(messageCallback_);
+    conn->setWriteCompleteCallback(writeCompleteCallback_);
+    if (transport) {
+        conn->setTransport(std::move(transport));
+    }
+    conn->setCloseCallback(
+        std::bind(&TcpClient::removeConnection, this, std::placeholders::_1));
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        connection_ = conn;
+    }
+    conn->connectEstablished();
+}
+
+void TcpClient::removeConnection(const TcpConnectionPtr &conn) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        connection_.reset();
+    }
+    loop_->queueInLoop(std::bind(&TcpConnection::connectDestroyed, conn));
+    if (retry_ && connect_) {
+        LOG_INFO("TcpClient::removeConnection[%s] - reconnecting to %s\n", name_.c_str(),
+                 connector_->serverAddress().toIpPort().c_str());
+        connector_->restart();
+    }
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "Callbacks.h"
+#include "Connector.h"
+#include "InetAddress.h"
+#include "TcpConnection.h"
+#include "Transport.h"
+
+#include <mutex>
+#include <string>
+
+class EventLoop;
+
+// 客户端，与 TcpServer 对称：Connector 建立连接，之后交给 TcpConnection，
+// 回调和收发都和服务端的连接一样。每个 TcpClient 同一时刻最多一个连接。
+class TcpClient : noncopyable {
+public:
+    TcpClient(EventLoop *loop, const InetAddress &serverAddr, const std::string &nameArg);
+    ~TcpClient();
+
+    // 可跨线程调用
+    void connect();
+    // 关闭已建立的连接（等 outputBuffer_ 写完）
+    void disconnect();
+    // 停止正在进行的连接和重试
+    void stop();
+
+    // 可跨线程调用，没有连接时返回 nullptr
+    TcpConnectionPtr connection() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return connection_;
+    }
+
+    EventLoop* getLoop() const { return loop_; }
+    const std::string& name() const { return name_; }
+
+    // 连接断开后自动重连
+    bool retry() const { return retry_; }
+    void enableRetry() { retry_ = true; }
+    // 见 Connector::setConnectTimeout
+    void setConnectTimeout(double seconds) { connector_->setConnectTimeout(seconds); }
+
+    // 例如 TlsContext::clientTransportFactory，需在 connect() 之前设置
+    void setTransportFactory(const TransportFactory &factory) { transportFactory_ = factory; }
+
+    void setConnectionCallback(const ConnectionCallback &cb) { connectionCallback_ = cb; }
+    void setMessageCallback(const MessageCallback &cb) { messageCallback_ = cb; }
+    void setWriteCompleteCallback(const WriteCompleteCallback &cb) { writeCompleteCallback_ = cb; }
+
+private:
+    // 在 loop 线程中执行
+    void newConnection(int sockfd);
+    void removeConnection(const TcpConnectionPtr &conn);
+
+    EventLoop *loop_;
+    ConnectorPtr connector_;
+    const std::string name_;
+    const TcpConnection::NamePrefixPtr connNamePrefix_;
+
+    ConnectionCallback connectionCallback_;
+    MessageCallback messageCallback_;
+    WriteCompleteCallback writeCompleteCallback_;
+    TransportFactory transportFactory_;
+
+    std::atomic_bool retry_;
+    std::atomic_bool connect_;
+    // 只在 loop 线程中访问
+    uint64_t nextConnId_;
+    mutable std::mutex mutex_;
+    TcpConnectionPtr connection_; // 由 mutex_ 保护
+};
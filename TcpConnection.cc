@@ -5,6 +5,7 @@
 #include "Logger.h"
 #include "Socket.h"
 
+#include <algorithm>
 #include <errno.h> // errno
 #include <functional>
 #include <string.h> // strerror
@@ -23,15 +24,34 @@ static EventLoop *CheckLopNotNull(EventLoop *loop) {
 TcpConnection::TcpConnection(EventLoop *loop, const std::string &name,
                              int sockfd, const InetAddress &localAddr,
                              const InetAddress &peerAddr)
+    : TcpConnection(loop, 0, std::make_shared<const std::string>(name), sockfd,
+                    localAddr, peerAddr) {}
+
+TcpConnection::TcpConnection(EventLoop *loop, uint64_t id,
+                             const NamePrefixPtr &namePrefix, int sockfd,
+                             const InetAddress &localAddr,
+                             const InetAddress &peerAddr)
     : loop_(CheckLopNotNull(loop)), 
-    name_(name), 
+    id_(id),
+    namePrefix_(namePrefix),
     state_(kConnecting),
     reading_(true), 
+    readThrottles_(0),
     socket_(new Socket(sockfd)),
     channel_(new Channel(loop, sockfd)), 
     localAddr_(localAddr),
     peerAddr_(peerAddr),
-    highWaterMark_(64 * 1024 * 1024) // 64M
+    highWaterMark_(64 * 1024 * 1024), // 64M
+    flowHighMark_(0),
+    flowLowMark_(0),
+    flowPaused_(false),
+    hasFlowSource_(false),
+    budgetSlot_(nullptr),
+    accountedBytes_(0),
+    reportedBacklog_(0),
+    bufferedBytes_(0),
+    budgetPaused_(false),
+    handshakeTimeout_(10.0)
 {
   channel_->setReadCallback(
       std::bind(&TcpConnection::handleRead, this, std::placeholders::_1));
@@ -39,13 +59,33 @@ TcpConnection::TcpConnection(EventLoop *loop, const std::string &name,
   channel_->setCloseCallback(std::bind(&TcpConnection::handleClose, this));
   channel_->setErrorCallback(std::bind(&TcpConnection::handleError, this));
 
-  LOG_INFO("TcpConnection::ctor[%s] at fd=%d\n", name_.c_str(), sockfd);
-  // 设置 socket 的 keepalive 选项
-  socket_->setKeepAlive(true);
+  LOG_INFO("TcpConnection::ctor[%s] id=%lu at fd=%d\n", namePrefix_->c_str(),
+           static_cast<unsigned long>(id_), sockfd);
+  // 设置 socket 的 keepalive 选项，Unix 域连接不需要
+  if (!localAddr_.isUnix()) {
+    socket_->setKeepAlive(true);
+  }
 }
 
 TcpConnection::~TcpConnection() {
-  LOG_INFO("TcpConnection::dtor[%s] at fd=%d state=%d\n", name_.c_str(),channel_->fd(), (int)state_);
+  LOG_INFO("TcpConnection::dtor[%s] id=%lu at fd=%d state=%d\n",
+           namePrefix_->c_str(), static_cast<unsigned long>(id_), channel_->fd(),
+           (int)state_);
+}
+
+const std::string &TcpConnection::name() const {
+  std::call_once(nameOnce_, [this]() {
+    if (id_ == 0) {
+      name_ = *namePrefix_;
+    } else {
+      name_ = *namePrefix_ + "#" + std::to_string(id_);
+    }
+  });
+  return name_;
+}
+
+bool TcpConnection::peerCredentials(ucred *cred) const {
+  return sockets::getPeerCredentials(socket_->fd(), cred);
 }
 
 void TcpConnection::send(const std::string &msg) {
@@ -53,77 +93,136 @@ void TcpConnection::send(const std::string &msg) {
     if (loop_->isInLoopThread()) {
       sendInLoop(msg.c_str(), msg.size());
     } else {
-      loop_->runInLoop(
-          std::bind(&TcpConnection::sendInLoop, this, msg.c_str(), msg.size()));
+      // 跨线程发送必须拷贝一份 msg，调用方的 msg 在 loop 执行前可能已经析构
+      void (TcpConnection::*fp)(const std::string &) = &TcpConnection::sendInLoop;
+      loop_->runInLoop(std::bind(fp, shared_from_this(), msg));
     }
   }
 }
 
-// 流程：
-// 1.检查是否发送数据条件，符合则直接发送数据
-// 2.发送成功，回调writeCompleteCallback_
-// 3.发送失败，记录错误信息，非致命错误与 1.里 不符合条件的情况一起处理
-// ---
-// 4.未发送完和发送失败的情况，都会注册写事件，等待下一次发送
-void TcpConnection::sendInLoop(const void *data, size_t len) {
-  ssize_t nwrote = 0;
-  size_t remaining = len;
-  bool faultError = false;
+void TcpConnection::send(Buffer *buf) {
+  if (state_ == kConnected) {
+    if (loop_->isInLoopThread()) {
+      sendInLoop(buf->peek(), buf->readableBytes());
+      buf->retrieveAll();
+    } else {
+      void (TcpConnection::*fp)(const std::string &) = &TcpConnection::sendInLoop;
+      loop_->runInLoop(std::bind(fp, shared_from_this(), buf->retrieveAllAsString()));
+    }
+  }
+}
 
+void TcpConnection::send(const std::shared_ptr<const std::string> &message) {
+  if (state_ == kConnected) {
+    if (loop_->isInLoopThread()) {
+      sendInLoop(message->data(), message->size());
+    } else {
+      TcpConnectionPtr self(shared_from_this());
+      loop_->runInLoop([self, message]() {
+        self->sendInLoop(message->data(), message->size());
+      });
+    }
+  }
+}
+
+void TcpConnection::sendInLoop(const std::string &message) {
+  sendInLoop(message.data(), message.size());
+}
+
+void TcpConnection::sendInLoop(const void *data, size_t len) {
   // 之前调用过该connection的shutdown函数，不能再发送了
   if (state_ == kDisconnected) {
     LOG_ERROR("disconnected, give up writing\n");
     return;
   }
+  writeOrQueue(data, len, outputBuffer_.readableBytes());
+}
 
-  // 当前没有待发送的旧数据（outBuffer_可读为空），且未注册写事件，直接发送
-  if (!channel_->isWriting() && outputBuffer_.readableBytes() == 0) {
-    nwrote = ::write(channel_->fd(), data, len);
-    if (nwrote >= 0) {
-      remaining = len - nwrote;
-      // 全部发送成功，不用注册写事件，直接回调writeCompleteCallback_
-      if (remaining == 0 && writeCompleteCallback_) {
-        loop_->queueInLoop(
-            std::bind(writeCompleteCallback_, shared_from_this()));
-      }
-    } else { //一个都没发出去/发送失败
-      nwrote = 0;
-      if (errno != EWOULDBLOCK) {
-        LOG_ERROR("TcpConnection::senINLoop");
+void TcpConnection::sendOutputBuffer() {
+  if (state_ == kDisconnected) {
+    outputBuffer_.retrieveAll();
+    return;
+  }
+  // reportedBacklog_ 是应用追加数据之前 outputBuffer_ 中的积压
+  size_t oldLen = std::min(static_cast<size_t>(reportedBacklog_),
+                           outputBuffer_.readableBytes());
+  writeOrQueue(nullptr, 0, oldLen);
+}
+
+// sendInLoop 和 sendOutputBuffer 共用的发送流程：
+// 1.没有注册写事件、待发送的数据只有一段时直接发送：sendInLoop 发送 data（outputBuffer_ 为空），
+//   sendOutputBuffer 发送 outputBuffer_（len 为 0）
+// 2.全部发送成功，回调writeCompleteCallback_
+// 3.发送失败，记录错误信息；对端已经关闭时丢弃数据，等 handleClose 清理
+// ---
+// 4.未发送完的数据留在 outputBuffer_ 中，注册写事件，等待下一次发送，
+//   并检查高水位回调、流量控制和内存预算。oldLen 是本次发送之前已有的积压
+void TcpConnection::writeOrQueue(const void *data, size_t len, size_t oldLen) {
+  size_t nwrote = 0;
+
+  if (!channel_->isWriting() &&
+      (len == 0 || outputBuffer_.readableBytes() == 0)) {
+    const bool inBuffer = len == 0;
+    const void *pending = inBuffer ? outputBuffer_.peek() : data;
+    size_t pendingLen = inBuffer ? outputBuffer_.readableBytes() : len;
+    if (pendingLen > 0) {
+      ssize_t n = writeSocket(pending, pendingLen);
+      if (n >= 0) {
+        nwrote = n;
+      } else if (errno != EWOULDBLOCK) { //一个都没发出去/发送失败
+        int savedErrno = errno;
+        LOG_ERROR("TcpConnection::writeOrQueue errno=%d\n", savedErrno);
         // EPIPE: 对端关闭连接
         // ECONNRESET: 对端重置连接
-        if (errno == EPIPE || errno == ECONNRESET) {
-          faultError = true;
+        if (savedErrno == EPIPE || savedErrno == ECONNRESET) {
+          outputBuffer_.retrieveAll();
+          updateBufferAccounting();
+          return;
         }
       }
+      if (inBuffer) {
+        outputBuffer_.retrieve(nwrote);
+      }
+      // 全部发送成功，不用注册写事件，直接回调writeCompleteCallback_
+      if (nwrote == pendingLen && writeCompleteCallback_) {
+        loop_->queueInLoop(
+            std::bind(writeCompleteCallback_, shared_from_this()));
+      }
     }
   }
 
-  // 未全部发送
   // 剩余的数据保存到缓冲区，给channel注册epollout事件。
   // 待poller发现TCP发送缓冲区有空间，会通知相应的channel
   // channel调用writeCallback_ <-
   // TcpConnection::handlewrite(),处理发送缓冲区里的数据
-  if (!faultError && remaining > 0) {
-    size_t oldLen = outputBuffer_.readableBytes();
-    if (oldLen + remaining >= highWaterMark_ // 总数据量超过高水位线
-        &&
-        oldLen <
-            highWaterMark_ // 旧数据未超（确保是首次超过水位线，避免重复触发）
-        && highWaterMark_) {
-      loop_->queueInLoop(std::bind(highWaterMarkCallback_, shared_from_this(),
-                                   oldLen + remaining));
-    }
-    outputBuffer_.append(static_cast<const char *>(data) + nwrote, remaining);
+  if (len > nwrote) {
+    outputBuffer_.append(static_cast<const char *>(data) + nwrote,
+                         len - nwrote);
+  }
+  size_t backlog = outputBuffer_.readableBytes();
+  if (backlog > 0) {
+    // 总数据量超过高水位线，且旧数据未超（确保是首次超过水位线，避免重复触发）
+    if (highWaterMark_ && highWaterMarkCallback_ &&
+        backlog >= highWaterMark_ && oldLen < highWaterMark_) {
+      loop_->queueInLoop(
+          std::bind(highWaterMarkCallback_, shared_from_this(), backlog));
+    }
     if (!channel_->isWriting()) {
       channel_->enableWriting();
     }
+    // 积压越过高水位，暂停 source 的读，等 handleWrite 把积压写到低水位再恢复
+    if (flowHighMark_ && !flowPaused_ && backlog >= flowHighMark_) {
+      flowPaused_ = true;
+      pauseFlowSource(true);
+    }
   }
+  updateBufferAccounting();
 }
 
 void TcpConnection::shutdown() {
   if (state_ == kConnected) {
-    setState(kDisconnected);
+    // kDisconnecting：outputBuffer_ 中还有数据时，由 handleWrite 写完后再关闭写端
+    setState(kDisconnecting);
     loop_->runInLoop(std::bind(&TcpConnection::shutdownInLoop, this));
   }
 }
@@ -131,33 +230,291 @@ void TcpConnection::shutdown() {
 void TcpConnection::shutdownInLoop() {
   // 此时，outputBuffer_中的数据已经发送完毕
   if (!channel_->isWriting()) {
+    if (transport_) {
+      transport_->shutdown();
+    }
     socket_->shutdownWrite();
   }
 }
 
+void TcpConnection::forceClose() {
+  if (state_ == kConnected || state_ == kDisconnecting) {
+    setState(kDisconnecting);
+    loop_->queueInLoop(std::bind(&TcpConnection::forceCloseInLoop, shared_from_this()));
+  }
+}
+
+void TcpConnection::forceCloseInLoop() {
+  if (state_ == kConnected || state_ == kDisconnecting) {
+    handleClose();
+  }
+}
+
+void TcpConnection::updateBufferAccounting() {
+  int64_t backlog = state_ != kDisconnected
+                        ? static_cast<int64_t>(outputBuffer_.readableBytes())
+                        : 0;
+  if (backlog != reportedBacklog_) {
+    loop_->metrics().outputBacklogBytes.add(backlog - reportedBacklog_);
+    reportedBacklog_ = backlog;
+  }
+  if (!memoryBudget_) {
+    return;
+  }
+  int64_t bytes = 0;
+  if (state_ != kDisconnected) {
+    bytes = static_cast<int64_t>(inputBuffer_.readableBytes() +
+                                 outputBuffer_.readableBytes());
+  }
+  if (bytes != accountedBytes_) {
+    memoryBudget_->update(budgetSlot_, bytes - accountedBytes_);
+    accountedBytes_ = bytes;
+    bufferedBytes_.store(bytes, std::memory_order_relaxed);
+  }
+}
+
+void TcpConnection::resumeFromBudgetInLoop() {
+  if (budgetPaused_) {
+    budgetPaused_ = false;
+    throttleReadInLoop(false);
+  }
+}
+
+void TcpConnection::startRead() {
+  loop_->runInLoop(std::bind(&TcpConnection::startReadInLoop, shared_from_this()));
+}
+
+void TcpConnection::stopRead() {
+  loop_->runInLoop(std::bind(&TcpConnection::stopReadInLoop, shared_from_this()));
+}
+
+void TcpConnection::startReadInLoop() {
+  reading_ = true;
+  updateReadingInLoop();
+}
+
+void TcpConnection::stopReadInLoop() {
+  reading_ = false;
+  updateReadingInLoop();
+}
+
+void TcpConnection::throttleReadInLoop(bool pause) {
+  if (pause) {
+    ++readThrottles_;
+  } else if (readThrottles_ > 0) {
+    --readThrottles_;
+  }
+  updateReadingInLoop();
+}
+
+// 只有用户允许读且没有被流量控制暂停时，才在 poller 上关注读事件
+void TcpConnection::updateReadingInLoop() {
+  if (state_ != kConnected && state_ != kDisconnecting) {
+    return;
+  }
+  bool wantRead = reading_ && readThrottles_ == 0;
+  if (wantRead && !channel_->isReading()) {
+    channel_->enableReading();
+  } else if (!wantRead && channel_->isReading()) {
+    channel_->disableReading();
+  }
+}
+
+void TcpConnection::setFlowControl(size_t highMark, size_t lowMark) {
+  flowHighMark_ = highMark;
+  flowLowMark_ = lowMark < highMark ? lowMark : highMark / 2;
+}
+
+void TcpConnection::setFlowControlSource(const TcpConnectionPtr &source) {
+  flowSource_ = source;
+  hasFlowSource_ = true;
+}
+
+void TcpConnection::pauseFlowSource(bool pause) {
+  if (!hasFlowSource_) {
+    throttleReadInLoop(pause);
+    return;
+  }
+  TcpConnectionPtr source = flowSource_.lock();
+  if (source) {
+    // source 可能在另一个 subloop 中
+    source->getLoop()->runInLoop(
+        std::bind(&TcpConnection::throttleReadInLoop, source, pause));
+  }
+}
+
 void TcpConnection::connectEstablished() {
-  setState(kConnected);
   channel_->tie(shared_from_this());
+  loop_->metrics().connections.add(1);
+  loop_->metrics().connectionsOpened.add();
+  if (transport_) {
+    // 保持 kConnecting，握手完成后再进入 kConnected
+    if (handshakeTimeout_ > 0) {
+      std::weak_ptr<TcpConnection> weakSelf(shared_from_this());
+      handshakeTimer_ = loop_->runAfter(handshakeTimeout_, [weakSelf]() {
+        TcpConnectionPtr conn = weakSelf.lock();
+        if (conn) {
+          conn->handshakeTimeoutInLoop();
+        }
+      });
+    }
+    continueHandshake();
+    return;
+  }
+  setState(kConnected);
   channel_->enableReading();
 
   connectionCallback_(shared_from_this());
 }
+
+void TcpConnection::continueHandshake() {
+  switch (transport_->handshake()) {
+  case Transport::kHandshakeDone:
+    loop_->cancel(handshakeTimer_);
+    setState(kConnected);
+    if (channel_->isWriting()) {
+      channel_->disableWriting();
+    }
+    updateReadingInLoop();
+    connectionCallback_(shared_from_this());
+    // 握手期间对端可能已经发来了应用数据，被 transport 读进了内部缓冲区
+    if (state_ == kConnected && transport_->pending() > 0) {
+      handleRead(Timestamp::cachedNow());
+    }
+    break;
+  case Transport::kHandshakeWantRead:
+    if (channel_->isWriting()) {
+      channel_->disableWriting();
+    }
+    if (!channel_->isReading()) {
+      channel_->enableReading();
+    }
+    break;
+  case Transport::kHandshakeWantWrite:
+    if (!channel_->isWriting()) {
+      channel_->enableWriting();
+    }
+    break;
+  case Transport::kHandshakeFailed:
+    handshakeFailed();
+    break;
+  }
+}
+
+// 用户没有见过这个连接，只通知所有者移除它
+void TcpConnection::handshakeFailed() {
+  loop_->cancel(handshakeTimer_);
+  setState(kDisconnected);
+  channel_->disableAll();
+  closeCallback_(shared_from_this());
+}
+
+void TcpConnection::handshakeTimeoutInLoop() {
+  if (state_ == kConnecting) {
+    LOG_ERROR("TcpConnection::handshakeTimeout [%s] after %.1fs\n", name().c_str(),
+              handshakeTimeout_);
+    handshakeFailed();
+  }
+}
+
+ssize_t TcpConnection::readTransport(int *savedErrno) {
+  // 一次可读事件最多读这么多，和 readFd 一样不让一个连接占住 loop
+  static const size_t kMaxReadPerEvent = 64 * 1024;
+  // 不小于一个 TLS 记录，每次都能读出一整条记录
+  static const size_t kReadChunk = 16 * 1024 + 512;
+  ssize_t total = 0;
+  while (static_cast<size_t>(total) < kMaxReadPerEvent || transport_->pending() > 0) {
+    inputBuffer_.ensureWriteableBytes(kReadChunk);
+    ssize_t n = transport_->read(inputBuffer_.beginWrite(), inputBuffer_.writableBytes());
+    loop_->metrics().readCalls.add();
+    if (n > 0) {
+      inputBuffer_.hasWritten(n);
+      total += n;
+    } else if (n == 0) {
+      break;
+    } else {
+      if (total == 0) {
+        *savedErrno = errno;
+        return -1;
+      }
+      break;
+    }
+  }
+  return total;
+}
+
+ssize_t TcpConnection::writeSocket(const void *data, size_t len) {
+  ssize_t n = transport_ ? transport_->write(data, len)
+                         : ::write(channel_->fd(), data, len);
+  countWrite(n, errno);
+  return n;
+}
+
+void TcpConnection::countRead(ssize_t n, int savedErrno) {
+  LoopMetrics &metrics = loop_->metrics();
+  if (n > 0) {
+    metrics.bytesRead.add(n);
+  } else if (n < 0 && (savedErrno == EAGAIN || savedErrno == EWOULDBLOCK)) {
+    metrics.readEagain.add();
+  }
+}
+
+void TcpConnection::countWrite(ssize_t n, int savedErrno) {
+  LoopMetrics &metrics = loop_->metrics();
+  metrics.writeCalls.add();
+  if (n > 0) {
+    metrics.bytesWritten.add(n);
+  } else if (n < 0 && (savedErrno == EAGAIN || savedErrno == EWOULDBLOCK)) {
+    metrics.writeEagain.add();
+  }
+}
 void TcpConnection::connectDestroyed() {
+  // 连接销毁时解除对 source 的暂停，否则 source 再也不会恢复读
+  if (flowPaused_) {
+    flowPaused_ = false;
+    pauseFlowSource(false);
+  }
   if (state_ == kConnected) {
     setState(kDisconnected);
     channel_->disableAll();
     connectionCallback_(shared_from_this());
   }
   channel_->remove();
+  // 从 kDisconnecting 销毁时状态还没有变，统一置为 kDisconnected 再归还记在预算上的字节
+  setState(kDisconnected);
+  updateBufferAccounting();
+  loop_->metrics().connections.add(-1);
 }
 
 void TcpConnection::handleRead(Timestamp receiveTime) {
+  if (state_ == kConnecting && transport_) {
+    continueHandshake();
+    return;
+  }
   int savedErrno = 0;
-  ssize_t n = inputBuffer_.readFd(channel_->fd(), &savedErrno);
+  ssize_t n = 0;
+  if (transport_) {
+    n = readTransport(&savedErrno);
+  } else {
+    n = inputBuffer_.readFd(channel_->fd(), &savedErrno);
+    loop_->metrics().readCalls.add();
+  }
+  countRead(n, savedErrno);
   if (n > 0) {
     messageCallback_(shared_from_this(), &inputBuffer_, receiveTime);
+    updateBufferAccounting();
+    // 超预算时暂停读，等 MemoryBudget 回落后统一恢复
+    if (memoryBudget_ && !budgetPaused_ && memoryBudget_->overBudget() &&
+        memoryBudget_->policy() == MemoryBudget::kPauseReading &&
+        state_ == kConnected) {
+      budgetPaused_ = true;
+      throttleReadInLoop(true);
+      memoryBudget_->addPaused(budgetSlot_, shared_from_this());
+    }
   } else if (n == 0) {
     handleClose();
+  } else if (savedErrno == EAGAIN || savedErrno == EWOULDBLOCK) {
+    // transport 读到的只是协议数据（例如 TLS 的会话票据），没有应用数据
   } else {
     errno = savedErrno;
     LOG_ERROR("TcpConnection::handleRead");
@@ -169,11 +526,26 @@ void TcpConnection::handleRead(Timestamp receiveTime) {
 //事件循环（EventLoop）会通过 EPOLLOUT 事件触发 handleWrite。
 // 任务：将 outputBuffer_ 中缓存的数据发送到内核。
 void TcpConnection::handleWrite() {
+  if (state_ == kConnecting && transport_) {
+    continueHandshake();
+    return;
+  }
   if (channel_->isWriting()) {
     int savedErrno = 0;
-    ssize_t n = outputBuffer_.writeFd(channel_->fd(), &savedErrno);
+    ssize_t n = 0;
+    if (transport_) {
+      n = writeSocket(outputBuffer_.peek(), outputBuffer_.readableBytes());
+    } else {
+      n = outputBuffer_.writeFd(channel_->fd(), &savedErrno);
+      countWrite(n, savedErrno);
+    }
     if (n > 0) {
       outputBuffer_.retrieve(n);
+      if (flowPaused_ && outputBuffer_.readableBytes() <= flowLowMark_) {
+        flowPaused_ = false;
+        pauseFlowSource(false);
+      }
+      updateBufferAccounting();
       if (outputBuffer_.readableBytes() == 0) {
         channel_->disableWriting();
         if (writeCompleteCallback_) {
@@ -194,6 +566,11 @@ void TcpConnection::handleWrite() {
 void TcpConnection::handleClose() {
   LOG_INFO("TcpConnection::handleClose fd=%d state=%d \n", channel_->fd(),
            (int)state_);
+  if (state_ == kConnecting) {
+    // 握手没有完成对端就关闭了
+    handshakeFailed();
+    return;
+  }
   setState(kDisconnected);
   channel_->disableAll();
 
@@ -212,5 +589,5 @@ void TcpConnection::handleError() {
     err = optval;
   }
   LOG_ERROR("TcpConnection::handleEooro name:%s - SO_ERROR:%d \n",
-            name_.c_str(), err);
+            name().c_str(), err);
 }
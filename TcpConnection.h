@@ -5,20 +5,27 @@
 #include "Callbacks.h"
 #include "Buffer.h"
 #include "Timestamp.h"
+#include "MemoryBudget.h"
+#include "TimerId.h"
+#include "Transport.h"
 
 #include <atomic>
+#include <mutex>
 #include <string>
 #include <memory>
 
 class Socket;
 class Channel;
 class EventLoop;
+struct ucred;
 
 class TcpConnection : noncopyable,
     // 当一个类继承自std::enable_shared_from_this时，它可以安全地生成指向自身的std::shared_ptr实例。
     public std::enable_shared_from_this<TcpConnection>
 {
 public:
+    using NamePrefixPtr = std::shared_ptr<const std::string>;
+
     TcpConnection(
         EventLoop *loop,
         const std::string &name, 
@@ -26,18 +33,53 @@ public:
         const InetAddress& localAddr,
         const InetAddress& peerAddr
     );
+    // TcpServer 使用：同一个 server 的连接共享 namePrefix，
+    // 名字 "namePrefix#id" 在第一次调用 name() 时才拼出来
+    TcpConnection(
+        EventLoop *loop,
+        uint64_t id,
+        const NamePrefixPtr &namePrefix,
+        int sockfd,
+        const InetAddress& localAddr,
+        const InetAddress& peerAddr
+    );
     ~TcpConnection();
 
     EventLoop* getLoop() const { return loop_; }
-    const std::string &name() const { return name_; }
+    uint64_t id() const { return id_; }
+    const std::string &name() const;
     const InetAddress& localAddress() const { return localAddr_; }
     const InetAddress& peerAddress() const { return peerAddr_; }
+    // Unix 域连接对端进程的身份，见 sockets::getPeerCredentials
+    bool peerCredentials(ucred *cred) const;
 
     bool connected() const { return state_ == kConnected; }
 
     void send(const std::string &buf);
+    // 发送 buf 中的全部可读数据并清空 buf
+    void send(Buffer *buf);
+    // 发送共享的、不可变的数据（例如广播给很多连接的同一条消息），
+    // 跨线程发送时只复制指针，不复制数据
+    void send(const std::shared_ptr<const std::string> &message);
     void shutdown();
 
+    // 只能在 loop 线程中使用：应用把数据直接编码进 outputBuffer()，省掉一次中间拷贝，
+    // 再调用 sendOutputBuffer() 写出（一批数据调用一次即可）
+    Buffer* outputBuffer() { return &outputBuffer_; }
+    void sendOutputBuffer();
+
+    // 暂停/恢复读，可跨线程调用
+    void startRead();
+    void stopRead();
+    bool isReading() const { return reading_; }
+
+    // 流量控制：outputBuffer_ 积压超过 highMark 时暂停读，回落到 lowMark 及以下时恢复
+    // highMark 为 0 表示关闭
+    void setFlowControl(size_t highMark, size_t lowMark);
+    // 代理场景：数据从 source 读入、经本连接写出，本连接积压时暂停的是 source 的读
+    // 不设置时暂停的是本连接自己的读
+    void setFlowControlSource(const TcpConnectionPtr &source);
+
     void setConnectinCallback(const ConnectionCallback &cb) {
         connectionCallback_ = cb;
     }
@@ -55,6 +97,31 @@ public:
         closeCallback_ = cb;
     }
 
+    // 将缓冲区字节数记入 TcpServer 的内存预算，在 connectEstablished 之前设置
+    void setMemoryBudget(const std::shared_ptr<MemoryBudget> &budget, MemoryBudget::Slot *slot) {
+        memoryBudget_ = budget;
+        budgetSlot_ = slot;
+    }
+    // inputBuffer_ 与 outputBuffer_ 中积压的字节数，可跨线程读取
+    int64_t bufferedBytes() const { return bufferedBytes_.load(std::memory_order_relaxed); }
+    // MemoryBudget 在预算回落后调用，只能在 loop 线程中调用
+    void resumeFromBudgetInLoop();
+
+    // 不等待 outputBuffer_ 写完，直接关闭连接
+    void forceClose();
+
+    // 应用层保存在连接上的状态（例如协议解析器），只在 loop 线程中访问
+    void setContext(const std::shared_ptr<void> &context) { context_ = context; }
+    const std::shared_ptr<void>& getContext() const { return context_; }
+
+    // 在 connectEstablished 之前设置。设置后数据经 transport 收发，
+    // connectEstablished 先完成 transport 的握手，成功后才回调 ConnectionCallback，
+    // 握手失败或超时直接关闭连接，不回调 ConnectionCallback
+    void setTransport(std::unique_ptr<Transport> transport) { transport_ = std::move(transport); }
+    Transport* transport() const { return transport_.get(); }
+    // 握手超时，单位秒，0 表示不限制
+    void setHandshakeTimeout(double seconds) { handshakeTimeout_ = seconds; }
+
     void connectEstablished();
     void connectDestroyed();
 
@@ -73,18 +140,48 @@ private:
     void handleClose();
     void handleError();
 
+    // 握手
+    void continueHandshake();
+    void handshakeFailed();
+    void handshakeTimeoutInLoop();
+    // 经 transport_ 读入 inputBuffer_，语义同 Buffer::readFd
+    ssize_t readTransport(int *savedErrno);
+    ssize_t writeSocket(const void *data, size_t len);
+    // 把一次读/写的结果记入所属 loop 的指标
+    void countRead(ssize_t n, int savedErrno);
+    void countWrite(ssize_t n, int savedErrno);
+
+    void sendInLoop(const std::string &message);
     void sendInLoop(const void* message, size_t len);
+    // 直接写 socket，写不完的部分留在 outputBuffer_ 中并注册写事件，见 TcpConnection.cc
+    void writeOrQueue(const void *data, size_t len, size_t oldLen);
     void shutdownInLoop();
 
+    void forceCloseInLoop();
+    // 把缓冲区字节数的变化记到内存预算上
+    void updateBufferAccounting();
+
+    void startReadInLoop();
+    void stopReadInLoop();
+    // 流量控制对读的暂停计数，可能来自自身，也可能来自多个对端
+    void throttleReadInLoop(bool pause);
+    void updateReadingInLoop();
+    // 积压越过高/低水位时暂停/恢复 source 的读
+    void pauseFlowSource(bool pause);
+
 
 
 
     // 私有属性
     // 这里绝不是baseloop，因为TcpConnection都是在subloop中创建的
     EventLoop* loop_;
-    std::string name_;
+    const uint64_t id_; // 为 0 时 namePrefix_ 就是完整的名字
+    const NamePrefixPtr namePrefix_;
+    mutable std::string name_;
+    mutable std::once_flag nameOnce_;
     std::atomic_int state_;
-    bool reading_;
+    bool reading_; // 用户期望的读状态
+    int readThrottles_; // 流量控制导致的读暂停次数，> 0 时不读
 
     // 这里和Acceptor类似，Acceptor -> mainloop, TcpConnection -> subloop
     std::unique_ptr<Socket> socket_;
@@ -101,6 +198,27 @@ private:
     CloseCallback closeCallback_;
     size_t highWaterMark_;
 
+    // 流量控制
+    size_t flowHighMark_;
+    size_t flowLowMark_;
+    bool flowPaused_; // 当前是否因本连接积压而暂停了 source
+    bool hasFlowSource_;
+    std::weak_ptr<TcpConnection> flowSource_;
+
+    // 内存预算
+    std::shared_ptr<MemoryBudget> memoryBudget_;
+    MemoryBudget::Slot *budgetSlot_;
+    int64_t accountedBytes_; // 已记入预算的字节数
+    int64_t reportedBacklog_; // 已记入 loop 指标的 outputBuffer_ 字节数
+    std::atomic<int64_t> bufferedBytes_;
+    bool budgetPaused_;
+
+    std::shared_ptr<void> context_;
+
+    std::unique_ptr<Transport> transport_;
+    double handshakeTimeout_;
+    TimerId handshakeTimer_;
+
     // 缓冲区
     Buffer inputBuffer_;
     Buffer outputBuffer_;
@@ -1,12 +1,21 @@
 #include "TcpServer.h"
 #include "EventLoop.h"
+#include "EventLoopThread.h"
 #include "Logger.h"
+#include "Socket.h"
 #include "TcpConnection.h"
 
+#include <algorithm>
 #include <functional>
 #include <memory>
 #include <string>
 #include <strings.h>
+#include <unistd.h>
+
+// 缩容时 drainTimeoutSeconds 之后对剩余连接 shutdown，再过这么久 forceClose
+static const double kForceCloseDelaySeconds = 5.0;
+// 退出的 loop 等待自己的回调队列清空的最多轮数
+static const int kMaxQuiesceRounds = 16;
 
 static EventLoop *CheckLoopNotNull(EventLoop *loop) {
   if (loop == nullptr) {
@@ -20,20 +29,50 @@ TcpServer::TcpServer(EventLoop *loop, const InetAddress &listenAddr,
                      const std::string &nameArg, Option option)
     : loop_(CheckLoopNotNull(loop)), ipPort_(listenAddr.toIpPort()),
       name_(nameArg),
+      connNamePrefix_(std::make_shared<const std::string>(name_ + "-" + ipPort_)),
       acceptor_(new Acceptor(loop, listenAddr, option == kReusePort)),
       threadPool_(new EventLoopThreadPool(loop, name_)), connectionCallback_(),
-      messageCallback_(), nextConnId_(1), started_(0) {
+      messageCallback_(), started_(0), flowHighMark_(0), flowLowMark_(0),
+      nextConnId_(1), numConnections_(0), draining_(false) {
+  acceptor_->setNewConnectionCallback(std::bind(&TcpServer::newConnection, this,
+                                                std::placeholders::_1,
+                                                std::placeholders::_2));
+}
+
+TcpServer::TcpServer(EventLoop *loop, int listenFd, const std::string &nameArg)
+    : loop_(CheckLoopNotNull(loop)), ipPort_(sockets::getLocalAddr(listenFd).toIpPort()),
+      name_(nameArg),
+      connNamePrefix_(std::make_shared<const std::string>(name_ + "-" + ipPort_)),
+      acceptor_(new Acceptor(loop, listenFd)),
+      threadPool_(new EventLoopThreadPool(loop, name_)), connectionCallback_(),
+      messageCallback_(), started_(0), flowHighMark_(0), flowLowMark_(0),
+      nextConnId_(1), numConnections_(0), draining_(false) {
   acceptor_->setNewConnectionCallback(std::bind(&TcpServer::newConnection, this,
                                                 std::placeholders::_1,
                                                 std::placeholders::_2));
 }
 
 TcpServer::~TcpServer() {
-  for (auto &item : connections_) {
-    TcpConnectionPtr conn(item.second);
-    item.second.reset();
-    conn->getLoop()->runInLoop(
-        std::bind(&TcpConnection::connectDestroyed, conn));
+  if (autoscaler_) {
+    loop_->cancel(autoscaleTimer_);
+  }
+  for (const RetiringLoop &r : retiring_) {
+    loop_->cancel(r.deadline);
+  }
+  // 连接表只能在所属 loop 中访问，交给各个 loop 自己销毁
+  std::lock_guard<std::mutex> lock(shardsMutex_);
+  for (const ShardPtr &shard : shards_) {
+    shard->loop->runInLoop(std::bind(&TcpServer::destroyShardInLoop, shard));
+  }
+}
+
+void TcpServer::destroyShardInLoop(const ShardPtr &shard) {
+  ConnectionMap connections;
+  connections.swap(shard->connections);
+  shard->groups.clear();
+  shard->groupsOf.clear();
+  for (auto &item : connections) {
+    item.second->connectDestroyed();
   }
 }
 
@@ -42,40 +81,126 @@ void TcpServer::setThreadNum(int numThreads) {
   threadPool_->setThreadNum(numThreads);
 }
 
+void TcpServer::setMemoryBudget(int64_t budgetBytes,
+                                MemoryBudget::Policy policy) {
+  memoryBudget_.reset(new MemoryBudget(budgetBytes, policy));
+  if (policy == MemoryBudget::kEvictLargest) {
+    // 每个 loop 只处理自己的连接表；回调就在某个 subloop 中，用 queueInLoop 避免持锁时就地执行
+    memoryBudget_->setOverBudgetCallback([this]() {
+      std::lock_guard<std::mutex> lock(shardsMutex_);
+      for (const ShardPtr &shard : shards_) {
+        shard->loop->queueInLoop(
+            std::bind(&TcpServer::evictLargestInLoop, this, shard.get()));
+      }
+    });
+  }
+}
+
+void TcpServer::setAdmissionControl(
+    const AdmissionController::Options &options) {
+  admission_.reset(new AdmissionController(options));
+}
+
+void TcpServer::setAutoscaler(const LoopAutoscaler::Options &options) {
+  autoscaler_.reset(new LoopAutoscaler(options));
+}
+
+int64_t TcpServer::bufferedBytes() const {
+  return memoryBudget_ ? memoryBudget_->totalBytes() : 0;
+}
+
 // 开启服务器监听 loop.loop()
 void TcpServer::start() {
   if (started_++ == 0) {
+    if (autoscaler_) {
+      // 自动伸缩只在 subloop 之间进行，至少从 minThreads 个开始
+      int minThreads = autoscaler_->options().minThreads;
+      threadPool_->setThreadNum(minThreads > 1 ? minThreads : 1);
+    }
     threadPool_->start(threadInitCallback_);
+    for (EventLoop *ioLoop : threadPool_->getAllLoops()) {
+      addShard(ioLoop);
+    }
     loop_->runInLoop(std::bind(&Acceptor::listen, acceptor_.get()));
+    if (autoscaler_) {
+      autoscaleTimer_ = loop_->runEvery(autoscaler_->options().intervalSeconds,
+                                        std::bind(&TcpServer::autoscaleInLoop, this));
+    }
   }
 }
 
+void TcpServer::addShard(EventLoop *ioLoop) {
+  ShardPtr shard = std::make_shared<Shard>();
+  shard->loop = ioLoop;
+  shard->budgetSlot = memoryBudget_ ? memoryBudget_->addLoop(ioLoop) : nullptr;
+  {
+    std::lock_guard<std::mutex> lock(shardsMutex_);
+    shards_.push_back(shard);
+  }
+  shardOfLoop_[ioLoop] = shard.get();
+}
+
 // 新客户端连接，acceptor执行这个回调
 void TcpServer::newConnection(int sockfd, const InetAddress &peerAddr) {
+  // 0. 超出内存预算时拒绝新连接
+  if (memoryBudget_ && memoryBudget_->overBudget() &&
+      memoryBudget_->policy() == MemoryBudget::kRejectNewConnections) {
+    LOG_ERROR("TcpServer::newConnection [%s] - over memory budget, reject %s\n",
+              name_.c_str(), peerAddr.toIpPort().c_str());
+    ::close(sockfd);
+    return;
+  }
+
   // 1. 选择一个 subLoop 处理新连接
   EventLoop *ioLoop = threadPool_->getNextLoop();
 
-  // 2. 生成连接名称
-  char buf[64] = {0};
-  snprintf(buf, sizeof buf, "-%s#%d", ipPort_.c_str(), nextConnId_);
-  ++nextConnId_;
-  std::string connName = name_ + buf;
+  // 准入控制：连接数、accept 速率超限，或者所有 subloop 都过载时，尽早关闭新连接
+  if (admission_) {
+    AdmissionController::Decision decision =
+        admission_->admit(numConnections_, Timestamp::cachedNow());
+    if (decision == AdmissionController::kAccept &&
+        admission_->overloaded(ioLoop)) {
+      decision = AdmissionController::kLoopOverloaded;
+      for (int i = 1; i < threadPool_->numLoops(); ++i) {
+        ioLoop = threadPool_->getNextLoop();
+        if (!admission_->overloaded(ioLoop)) {
+          decision = AdmissionController::kAccept;
+          break;
+        }
+      }
+    }
+    if (decision != AdmissionController::kAccept) {
+      admission_->reject(sockfd, peerAddr, decision);
+      ::close(sockfd);
+      return;
+    }
+  }
+  Shard *shard = shardOfLoop_[ioLoop];
+
+  std::unique_ptr<Transport> transport;
+  if (transportFactory_) {
+    transport = transportFactory_(sockfd);
+    if (!transport) {
+      LOG_ERROR("TcpServer::newConnection [%s] - create transport failed, close %s\n",
+                name_.c_str(), peerAddr.toIpPort().c_str());
+      ::close(sockfd);
+      return;
+    }
+  }
+
+  // 2. 分配连接 id，名字等到用到时再拼
+  uint64_t connId = nextConnId_++;
 
-  LOG_INFO("TcpServer::newConnection [%s] - new connection [%s] from %s \n",
-           name_.c_str(), connName.c_str(), peerAddr.toIpPort().c_str());
+  LOG_INFO("TcpServer::newConnection [%s] - new connection #%lu from %s \n",
+           name_.c_str(), static_cast<unsigned long>(connId),
+           peerAddr.toIpPort().c_str());
 
   // 3. 通过sockfd获取本地地址信息
-  sockaddr_in local;
-  ::bzero(&local, sizeof local);
-  socklen_t addrlen = sizeof local;
-  if (::getsockname(sockfd, (sockaddr *)&local, &addrlen) < 0) {
-    LOG_ERROR("sockets::getLocalAddr");
-  }
-  InetAddress localaddr(local);
+  InetAddress localaddr(sockets::getLocalAddr(sockfd));
 
   // 4. 创建新连接 - TcpConnection 对象
-  TcpConnectionPtr conn(new TcpConnection(ioLoop, connName, sockfd, localaddr, peerAddr));
-  connections_[connName] = conn;
+  TcpConnectionPtr conn(new TcpConnection(ioLoop, connId, connNamePrefix_,
+                                          sockfd, localaddr, peerAddr));
 
   // 5. 设置连接回调
   // 下面的回调都是用户设置给TcpServer=>TcpConnection=>Channel=>Poller=>notify
@@ -83,21 +208,402 @@ void TcpServer::newConnection(int sockfd, const InetAddress &peerAddr) {
   conn->setConnectinCallback(connectionCallback_);
   conn->setMessageCallback(messageCallback_);
   conn->setWriteCompleteCallback(writeCompleteCallback_);
-  conn->setCloseCallback(
-      std::bind(&TcpServer::removeConnection, this, std::placeholders::_1));
+  conn->setFlowControl(flowHighMark_, flowLowMark_);
+  if (transport) {
+    conn->setTransport(std::move(transport));
+  }
+  if (memoryBudget_) {
+    conn->setMemoryBudget(memoryBudget_, shard->budgetSlot);
+  }
+  conn->setCloseCallback(std::bind(&TcpServer::removeConnection, this, shard,
+                                   std::placeholders::_1));
 
-  ioLoop->runInLoop(std::bind(&TcpConnection::connectEstablished, conn));
+  // 在 baseloop 中计数，gracefulStop 不会漏掉还没登记到 subloop 的连接
+  ++numConnections_;
+
+  // 6. 登记到 subloop 自己的连接表，之后连接的整个生命周期都不再回到 baseloop
+  ioLoop->runInLoop(
+      std::bind(&TcpServer::connectEstablishedInLoop, this, shard, conn));
 }
 
-void TcpServer::removeConnection(const TcpConnectionPtr &conn) {
-  loop_->runInLoop(std::bind(&TcpServer::removeConnectionInLoop, this, conn));
+void TcpServer::connectEstablishedInLoop(Shard *shard,
+                                         const TcpConnectionPtr &conn) {
+  shard->connections[conn->id()] = conn;
+  conn->connectEstablished();
 }
 
-void TcpServer::removeConnectionInLoop(const TcpConnectionPtr &conn) {
-  LOG_INFO("TcpServer::removeConnectionInLoop [%s] - connection %s\n",
-           name_.c_str(), conn->name().c_str());
+// 在连接所属的 subloop 中执行，不经过 baseloop
+void TcpServer::removeConnection(Shard *shard, const TcpConnectionPtr &conn) {
+  LOG_INFO("TcpServer::removeConnection [%s] - connection #%lu\n",
+           name_.c_str(), static_cast<unsigned long>(conn->id()));
+
+  shard->connections.erase(conn->id());
+  leaveAllGroupsInLoop(shard, conn->id());
+  // 当前还在 channel 的回调里，channel 的销毁要等到这轮事件处理完
+  shard->loop->queueInLoop(std::bind(&TcpConnection::connectDestroyed, conn));
+  if (shard->retiring && shard->connections.empty()) {
+    notifyRetiredInLoop(shard);
+  }
 
-  connections_.erase(conn->name());
-  EventLoop *ioLoop = conn->getLoop();
-  ioLoop->queueInLoop(std::bind(&TcpConnection::connectDestroyed, conn));
-}
\ No newline at end of file
+  // 最后一个连接关闭，gracefulStop 在等待时才通知它。draining_ 先于检查连接数设置，
+  // 两边都是 seq_cst，至少有一边能看到对方，不会漏掉通知
+  if (--numConnections_ == 0 && draining_) {
+    loop_->queueInLoop(std::bind(&TcpServer::gracefulStopInLoop, this,
+                                 DrainedCallback()));
+  }
+}
+
+void TcpServer::stopAccepting() {
+  loop_->runInLoop(std::bind(&Acceptor::stopListening, acceptor_.get()));
+}
+
+void TcpServer::handOffListenFd() {
+  loop_->runInLoop(std::bind(&Acceptor::handOff, acceptor_.get()));
+}
+
+void TcpServer::gracefulStop(const DrainedCallback &cb) {
+  loop_->runInLoop(std::bind(&TcpServer::gracefulStopInLoop, this, cb));
+}
+
+// cb 非空时开始排空；之后每次连接数归零都会进来检查一次
+void TcpServer::gracefulStopInLoop(const DrainedCallback &cb) {
+  if (cb) {
+    acceptor_->stopListening();
+    draining_ = true;
+    drainedCallback_ = cb;
+  }
+  if (draining_ && numConnections_ == 0) {
+    LOG_INFO("TcpServer::gracefulStop [%s] - all connections drained\n",
+             name_.c_str());
+    draining_ = false;
+    DrainedCallback drained;
+    drained.swap(drainedCallback_);
+    drained();
+  }
+}
+
+void TcpServer::shutdownAllConnections() {
+  std::lock_guard<std::mutex> lock(shardsMutex_);
+  for (const ShardPtr &shard : shards_) {
+    shard->loop->runInLoop(
+        std::bind(&TcpServer::shutdownShardInLoop, shard.get()));
+  }
+}
+
+void TcpServer::shutdownShardInLoop(Shard *shard) {
+  for (auto &item : shard->connections) {
+    item.second->shutdown();
+  }
+}
+
+// 每个 loop 关掉自己积压最多的连接，直到本 loop 的积压回到预算的平均份额以内
+void TcpServer::evictLargestInLoop(Shard *shard) {
+  if (!memoryBudget_->overBudget()) {
+    return;
+  }
+  size_t numShards;
+  {
+    std::lock_guard<std::mutex> lock(shardsMutex_);
+    numShards = shards_.size();
+  }
+  int64_t target = (memoryBudget_->budget() - memoryBudget_->budget() / 8) /
+                   static_cast<int64_t>(numShards);
+  int64_t local = 0;
+  std::vector<TcpConnectionPtr> conns;
+  conns.reserve(shard->connections.size());
+  for (auto &item : shard->connections) {
+    local += item.second->bufferedBytes();
+    conns.push_back(item.second);
+  }
+  if (local <= target) {
+    return;
+  }
+  std::sort(conns.begin(), conns.end(),
+            [](const TcpConnectionPtr &a, const TcpConnectionPtr &b) {
+              return a->bufferedBytes() > b->bufferedBytes();
+            });
+  for (const TcpConnectionPtr &conn : conns) {
+    if (local <= target || conn->bufferedBytes() == 0) {
+      break;
+    }
+    LOG_ERROR("TcpServer::evictLargestInLoop [%s] - evict %s holding %ld bytes\n",
+              name_.c_str(), conn->name().c_str(), (long)conn->bufferedBytes());
+    local -= conn->bufferedBytes();
+    conn->forceClose();
+  }
+}
+
+void TcpServer::resizeThreadPool(int numThreads, double drainTimeoutSeconds) {
+  loop_->runInLoop(std::bind(&TcpServer::resizeInLoop, this, numThreads,
+                             drainTimeoutSeconds));
+}
+
+void TcpServer::resizeInLoop(int numThreads, double drainTimeoutSeconds) {
+  if (started_ == 0) {
+    threadPool_->setThreadNum(numThreads);
+    return;
+  }
+  // 连接表按 loop 分在各个 shard 中，baseLoop_ 只在 start() 时没有 subloop 才有 shard，
+  // 启动后至少保留一个 subloop，getNextLoop 不会退回到 baseLoop_
+  if (numThreads < 1) {
+    numThreads = 1;
+  }
+  while (threadPool_->numLoops() < numThreads) {
+    EventLoop *ioLoop = threadPool_->addLoop();
+    addShard(ioLoop);
+    LOG_INFO("TcpServer::resizeThreadPool [%s] - add loop %d, %d loops\n",
+             name_.c_str(), static_cast<int>(ioLoop->threadId()),
+             threadPool_->numLoops());
+  }
+  while (threadPool_->numLoops() > numThreads) {
+    // 挑连接最少的 loop，排空最快；连接数取 loop 的指标，不需要到 subloop 里去数
+    EventLoop *victim = nullptr;
+    int64_t fewest = 0;
+    for (EventLoop *ioLoop : threadPool_->getAllLoops()) {
+      int64_t n = ioLoop->metrics().connections.value();
+      if (victim == nullptr || n < fewest) {
+        victim = ioLoop;
+        fewest = n;
+      }
+    }
+    // shards_ 只在 baseloop 中修改，这里读不用加锁
+    auto it = std::find_if(
+        shards_.begin(), shards_.end(),
+        [victim](const ShardPtr &shard) { return shard->loop == victim; });
+    if (it == shards_.end()) {
+      break;
+    }
+    retireLoopInLoop(*it, drainTimeoutSeconds);
+  }
+}
+
+void TcpServer::retireLoopInLoop(const ShardPtr &shard,
+                                 double drainTimeoutSeconds) {
+  RetiringLoop r;
+  r.thread = threadPool_->removeLoop(shard->loop);
+  LOG_INFO("TcpServer::resizeThreadPool [%s] - retire loop %d, %d loops\n",
+           name_.c_str(), static_cast<int>(shard->loop->threadId()),
+           threadPool_->numLoops());
+  shard->retiring = true;
+  r.shard = shard;
+  r.deadline = loop_->runAfter(
+      drainTimeoutSeconds,
+      std::bind(&TcpServer::drainTimeoutInLoop, this, shard.get()));
+  retiring_.push_back(std::move(r));
+  // 排在已经分给它的新连接的 connectEstablishedInLoop 之后执行，这时连接表已经完整
+  shard->loop->runInLoop(
+      std::bind(&TcpServer::checkRetiringInLoop, this, shard.get()));
+}
+
+void TcpServer::checkRetiringInLoop(Shard *shard) {
+  if (shard->connections.empty()) {
+    notifyRetiredInLoop(shard);
+  }
+}
+
+void TcpServer::notifyRetiredInLoop(Shard *shard) {
+  if (shard->retireNotified) {
+    return;
+  }
+  shard->retireNotified = true;
+  // 关闭可能发生在 pendingFunctor 里（例如 drain 超时后的 forceClose），这时 connectDestroyed
+  // 排到了下一轮迭代。先在本 loop 排队，排在已经入队的 connectDestroyed 之后
+  shard->loop->queueInLoop(
+      std::bind(&TcpServer::quiesceRetiringInLoop, this, shard, 0));
+}
+
+// 先让应用释放它在这个 loop 上的资源，再等本 loop 的队列清空（回调里关闭的连接还要经过
+// forceCloseInLoop、connectDestroyed 几轮排队），最后通知 baseloop 让这个 loop 退出。
+// 其他线程持续投递（例如 broadcast）时队列可能一直不空，最多等 kMaxQuiesceRounds 轮
+void TcpServer::quiesceRetiringInLoop(Shard *shard, int round) {
+  if (round == 0 && loopRetireCallback_) {
+    loopRetireCallback_(shard->loop);
+  }
+  if (shard->loop->queueSize() > 0 && round < kMaxQuiesceRounds) {
+    shard->loop->queueInLoop(std::bind(&TcpServer::quiesceRetiringInLoop,
+                                       this, shard, round + 1));
+    return;
+  }
+  loop_->queueInLoop(std::bind(&TcpServer::finishRetiringInLoop, this, shard));
+}
+
+TcpServer::RetiringLoop *TcpServer::findRetiring(Shard *shard) {
+  for (RetiringLoop &r : retiring_) {
+    if (r.shard.get() == shard) {
+      return &r;
+    }
+  }
+  return nullptr;
+}
+
+void TcpServer::drainTimeoutInLoop(Shard *shard) {
+  RetiringLoop *r = findRetiring(shard);
+  if (r == nullptr) {
+    return;
+  }
+  LOG_INFO("TcpServer::resizeThreadPool [%s] - drain timeout, shutdown "
+           "connections on loop %d\n",
+           name_.c_str(), static_cast<int>(shard->loop->threadId()));
+  shard->loop->runInLoop(std::bind(&TcpServer::shutdownShardInLoop, shard));
+  r->deadline = loop_->runAfter(
+      kForceCloseDelaySeconds,
+      std::bind(&TcpServer::forceCloseRetiringInLoop, this, shard));
+}
+
+void TcpServer::forceCloseRetiringInLoop(Shard *shard) {
+  if (findRetiring(shard) != nullptr) {
+    shard->loop->runInLoop(std::bind(&TcpServer::forceCloseShardInLoop, shard));
+  }
+}
+
+void TcpServer::forceCloseShardInLoop(Shard *shard) {
+  // forceClose 会经 removeConnection 修改连接表，先拷贝一份
+  std::vector<TcpConnectionPtr> conns;
+  for (auto &item : shard->connections) {
+    conns.push_back(item.second);
+  }
+  for (const TcpConnectionPtr &conn : conns) {
+    conn->forceClose();
+  }
+}
+
+// 连接已经全部关闭，可能被调用多次
+void TcpServer::finishRetiringInLoop(Shard *shard) {
+  for (auto it = retiring_.begin(); it != retiring_.end(); ++it) {
+    if (it->shard.get() != shard) {
+      continue;
+    }
+    EventLoop *ioLoop = shard->loop;
+    LOG_INFO("TcpServer::resizeThreadPool [%s] - loop %d drained\n",
+             name_.c_str(), static_cast<int>(ioLoop->threadId()));
+    loop_->cancel(it->deadline);
+    shardOfLoop_.erase(ioLoop);
+    if (memoryBudget_) {
+      memoryBudget_->removeLoop(ioLoop);
+    }
+    {
+      std::lock_guard<std::mutex> lock(shardsMutex_);
+      shards_.erase(std::remove(shards_.begin(), shards_.end(), it->shard),
+                    shards_.end());
+    }
+    // 析构 EventLoopThread：让 loop 退出并 join
+    retiring_.erase(it);
+    return;
+  }
+}
+
+void TcpServer::autoscaleInLoop() {
+  int current = threadPool_->numLoops();
+  int desired = autoscaler_->desiredThreads(threadPool_->getAllLoops(),
+                                            Timestamp::now());
+  if (desired != current) {
+    LOG_INFO("TcpServer::autoscale [%s] - utilization %.2f, %d -> %d loops\n",
+             name_.c_str(), autoscaler_->utilization(), current, desired);
+    resizeInLoop(desired, autoscaler_->options().drainTimeoutSeconds);
+  }
+}
+
+void TcpServer::broadcast(const std::shared_ptr<const std::string> &message) {
+  // 每个 loop 一个回调；持锁期间 loop 不会退出，queueInLoop 只是入队
+  std::lock_guard<std::mutex> lock(shardsMutex_);
+  for (const ShardPtr &shard : shards_) {
+    ShardPtr s(shard);
+    shard->loop->queueInLoop([s, message]() { sendToAll(s->connections, message); });
+  }
+}
+
+void TcpServer::publish(const std::string &group,
+                        const std::shared_ptr<const std::string> &message) {
+  std::lock_guard<std::mutex> lock(shardsMutex_);
+  for (const ShardPtr &shard : shards_) {
+    ShardPtr s(shard);
+    shard->loop->queueInLoop(
+        [s, group, message]() { publishInLoop(s.get(), group, message); });
+  }
+}
+
+void TcpServer::joinGroup(const TcpConnectionPtr &conn,
+                          const std::string &group) {
+  queueInShardOf(conn, std::bind(&TcpServer::joinGroupInLoop,
+                                 std::placeholders::_1, conn, group));
+}
+
+void TcpServer::leaveGroup(const TcpConnectionPtr &conn,
+                           const std::string &group) {
+  queueInShardOf(conn, std::bind(&TcpServer::leaveGroupInLoop,
+                                 std::placeholders::_1, conn, group));
+}
+
+void TcpServer::queueInShardOf(const TcpConnectionPtr &conn,
+                               const std::function<void(Shard *)> &f) {
+  std::lock_guard<std::mutex> lock(shardsMutex_);
+  for (const ShardPtr &shard : shards_) {
+    if (shard->loop == conn->getLoop()) {
+      ShardPtr s(shard);
+      // 分组只在排队的回调里修改，publishInLoop 遍历分组时不会被打断
+      shard->loop->queueInLoop([s, f]() { f(s.get()); });
+      return;
+    }
+  }
+}
+
+void TcpServer::joinGroupInLoop(Shard *shard, const TcpConnectionPtr &conn,
+                                const std::string &group) {
+  // 连接可能已经关闭，或者属于别的 TcpServer
+  auto it = shard->connections.find(conn->id());
+  if (it == shard->connections.end() || it->second != conn) {
+    return;
+  }
+  if (shard->groups[group].insert(std::make_pair(conn->id(), conn)).second) {
+    shard->groupsOf[conn->id()].push_back(group);
+  }
+}
+
+void TcpServer::leaveGroupInLoop(Shard *shard, const TcpConnectionPtr &conn,
+                                 const std::string &group) {
+  auto g = shard->groups.find(group);
+  if (g == shard->groups.end() || g->second.erase(conn->id()) == 0) {
+    return;
+  }
+  if (g->second.empty()) {
+    shard->groups.erase(g);
+  }
+  std::vector<std::string> &names = shard->groupsOf[conn->id()];
+  names.erase(std::remove(names.begin(), names.end(), group), names.end());
+  if (names.empty()) {
+    shard->groupsOf.erase(conn->id());
+  }
+}
+
+void TcpServer::leaveAllGroupsInLoop(Shard *shard, uint64_t connId) {
+  auto it = shard->groupsOf.find(connId);
+  if (it == shard->groupsOf.end()) {
+    return;
+  }
+  for (const std::string &group : it->second) {
+    auto g = shard->groups.find(group);
+    if (g != shard->groups.end()) {
+      g->second.erase(connId);
+      if (g->second.empty()) {
+        shard->groups.erase(g);
+      }
+    }
+  }
+  shard->groupsOf.erase(it);
+}
+
+void TcpServer::sendToAll(const ConnectionMap &connections,
+                          const std::shared_ptr<const std::string> &message) {
+  // 已在 loop 线程中，send 直接从共享的 message 写 socket，不再逐个连接投递
+  for (const auto &item : connections) {
+    item.second->send(message);
+  }
+}
+
+void TcpServer::publishInLoop(Shard *shard, const std::string &group,
+                              const std::shared_ptr<const std::string> &message) {
+  auto g = shard->groups.find(group);
+  if (g != shard->groups.end()) {
+    sendToAll(g->second, message);
+  }
+}
@@ -8,13 +8,19 @@
 #include "Callbacks.h"
 #include "Buffer.h"
 #include "TcpConnection.h"
+#include "MemoryBudget.h"
+#include "AdmissionController.h"
+#include "LoopAutoscaler.h"
+#include "Transport.h"
 
 
 #include <functional>
 #include <string>
 #include <memory>
 #include <atomic>
+#include <mutex>
 #include <unordered_map>
+#include <vector>
 
 
 // 对外的服务器编程使用的类
@@ -27,10 +33,14 @@ public:
         kReusePort,
     };
 
+    using DrainedCallback = std::function<void()>;
+
     TcpServer(EventLoop *loop, 
                 const InetAddress &listenAddr, 
                 const std::string &nameArg,
                 Option option = kNoReusePort);
+    // 在一个已经 bind 好的监听 fd 上提供服务，热重启时使用，见 HotRestart
+    TcpServer(EventLoop *loop, int listenFd, const std::string &nameArg);
     ~TcpServer();
 
     void setThreadinitCallback(const ThreadInitCallback &cb){
@@ -39,6 +49,10 @@ public:
 
 
     void setThreadInitCallback(const ThreadInitCallback &cb) { threadInitCallback_ = cb; }
+    // 缩容时 subloop 的连接全部关闭后、loop 退出之前，在该 loop 线程中调用，
+    // 用来释放 ThreadInitCallback 里为这个 loop 建立的资源（例如 UpstreamPool::removeLoop）。
+    // 回调里关闭的连接等排队的清理都执行完后 loop 才退出
+    void setLoopRetireCallback(const ThreadInitCallback &cb) { loopRetireCallback_ = cb; }
     void setConnectionCallback(const ConnectionCallback &cb) { connectionCallback_ = cb; }
     void setMessageCallback(const MessageCallback &cb) { messageCallback_ = cb; }
     void setWriteCompleteCallback(const WriteCompleteCallback &cb) { writeCompleteCallback_ = cb; }
@@ -47,22 +61,129 @@ public:
     // 设置底层subloop的个数
     void setThreadNum(int numThreads);
 
+    // 运行中调整 subloop 的个数，可跨线程调用，在 baseloop 中执行；start() 之前等同于 setThreadNum，
+    // start() 之后至少保留一个 subloop。
+    // 增加的 loop 立即参与新连接的分配。减少时挑连接最少的 loop 移出轮转，不再分给它新连接，
+    // 等它的连接自然关闭后退出线程；drainTimeoutSeconds 后还没关闭的连接先 shutdown，
+    // 再过 5 秒 forceClose，客户端重连后会分到其他 loop
+    void resizeThreadPool(int numThreads, double drainTimeoutSeconds = 30.0);
+
+    // 按 loop 忙碌比例自动伸缩 subloop 个数，需在 start() 之前设置，见 LoopAutoscaler
+    void setAutoscaler(const LoopAutoscaler::Options &options);
+    // 没有开启自动伸缩时返回 nullptr
+    LoopAutoscaler* autoscaler() const { return autoscaler_.get(); }
+
+    // 对所有新连接开启流量控制，见 TcpConnection::setFlowControl
+    void setFlowControl(size_t highMark, size_t lowMark) {
+        flowHighMark_ = highMark;
+        flowLowMark_ = lowMark;
+    }
+
+    // 所有连接缓冲区的全局预算，超出后按 policy 处理，需在 start() 之前设置
+    void setMemoryBudget(int64_t budgetBytes, MemoryBudget::Policy policy);
+    // 所有连接 inputBuffer_/outputBuffer_ 中积压的总字节数
+    int64_t bufferedBytes() const;
+
+    // 开启准入控制，需在 start() 之前设置
+    void setAdmissionControl(const AdmissionController::Options &options);
+    // 没有开启准入控制时返回 nullptr；应用可用 overloaded() 做请求级别的削峰
+    AdmissionController* admissionController() const { return admission_.get(); }
+
+    // 为每个新连接创建 Transport（例如 TlsContext::serverTransportFactory），需在 start() 之前设置
+    void setTransportFactory(const TransportFactory &factory) { transportFactory_ = factory; }
+
     // 开启服务器监听
     void start();
+
+    int listenFd() const { return acceptor_->listenFd(); }
+    size_t numConnections() const { return numConnections_.load(); }
+
+    // 停止 accept 新连接，已有连接不受影响
+    void stopAccepting();
+    // 监听 fd 已交给热重启的新进程：停止 accept，析构时不删除 Unix 域 socket 文件
+    void handOffListenFd();
+    // 停止 accept，等已有连接全部关闭后在 baseloop 中调用 cb
+    void gracefulStop(const DrainedCallback &cb);
+    // 对所有连接调用 shutdown，让对端在读完数据后关闭连接
+    void shutdownAllConnections();
+
+    // 广播和分组发送，用于聊天室、订阅推送之类一条消息发给大量连接的场景。
+    // 消息对每个 subloop 只投递一次（每个 loop 最多一次唤醒），由各 loop 直接写给自己的连接，
+    // 所有连接共享同一份 message，只有没能立即写完的部分才拷进各自的 outputBuffer_。
+    // 以下都可跨线程调用，在 loop 线程中调用也是排队执行，在连接的回调里调用是安全的
+    // 发给所有连接
+    void broadcast(const std::shared_ptr<const std::string> &message);
+    // 连接加入/退出分组，连接关闭时自动退出所有分组
+    void joinGroup(const TcpConnectionPtr &conn, const std::string &group);
+    void leaveGroup(const TcpConnectionPtr &conn, const std::string &group);
+    // 发给分组中的所有连接
+    void publish(const std::string &group, const std::shared_ptr<const std::string> &message);
 private:
+    using ConnectionMap = std::unordered_map<uint64_t, TcpConnectionPtr>;
+
+    // 每个 subloop 一个连接表，只在该 loop 线程中访问，
+    // 连接的建立和销毁都在所属 loop 内完成，不经过 baseloop
+    struct Shard {
+        Shard() : loop(nullptr), budgetSlot(nullptr), retiring(false), retireNotified(false) {}
+        EventLoop *loop;
+        ConnectionMap connections;
+        MemoryBudget::Slot *budgetSlot;
+        std::atomic_bool retiring; // 已移出轮转，连接全部关闭后退出
+        bool retireNotified;       // 已开始退出流程，只在本 loop 中访问
+        // 本 loop 中各分组的连接，以及每个连接加入的分组，连接关闭时据此退出
+        std::unordered_map<std::string, ConnectionMap> groups;
+        std::unordered_map<uint64_t, std::vector<std::string>> groupsOf;
+    };
+    using ShardPtr = std::shared_ptr<Shard>;
+
+    // 正在退出的 loop，只在 baseloop 中访问
+    struct RetiringLoop {
+        ShardPtr shard;
+        std::unique_ptr<EventLoopThread> thread;
+        TimerId deadline;
+    };
+
     // 新连接到来时的回调
     void newConnection(int sockfd, const InetAddress &peerAddr);
+    void connectEstablishedInLoop(Shard *shard, const TcpConnectionPtr &conn);
     // 连接断开时的回调
-    void removeConnection(const TcpConnectionPtr &conn);
-    void removeConnectionInLoop(const TcpConnectionPtr &conn);
-
-    using ConnectionMap = std::unordered_map<std::string, TcpConnectionPtr>;
+    void removeConnection(Shard *shard, const TcpConnectionPtr &conn);
+    static void destroyShardInLoop(const ShardPtr &shard);
+    static void shutdownShardInLoop(Shard *shard);
+    void gracefulStopInLoop(const DrainedCallback &cb);
+    // kEvictLargest：关闭本 loop 中积压最多的连接
+    void evictLargestInLoop(Shard *shard);
+
+    void addShard(EventLoop *ioLoop);
+    void resizeInLoop(int numThreads, double drainTimeoutSeconds);
+    void retireLoopInLoop(const ShardPtr &shard, double drainTimeoutSeconds);
+    // 在 subloop 中检查正在退出的 loop 是否已经没有连接
+    void checkRetiringInLoop(Shard *shard);
+    void notifyRetiredInLoop(Shard *shard);
+    void quiesceRetiringInLoop(Shard *shard, int round);
+    RetiringLoop* findRetiring(Shard *shard);
+    void drainTimeoutInLoop(Shard *shard);
+    void forceCloseRetiringInLoop(Shard *shard);
+    static void forceCloseShardInLoop(Shard *shard);
+    void finishRetiringInLoop(Shard *shard);
+    void autoscaleInLoop();
+
+    // 在连接所属 loop 的 shard 中排队执行 f
+    void queueInShardOf(const TcpConnectionPtr &conn, const std::function<void(Shard*)> &f);
+    static void joinGroupInLoop(Shard *shard, const TcpConnectionPtr &conn, const std::string &group);
+    static void leaveGroupInLoop(Shard *shard, const TcpConnectionPtr &conn, const std::string &group);
+    static void leaveAllGroupsInLoop(Shard *shard, uint64_t connId);
+    static void sendToAll(const ConnectionMap &connections, const std::shared_ptr<const std::string> &message);
+    static void publishInLoop(Shard *shard, const std::string &group,
+                              const std::shared_ptr<const std::string> &message);
 
     // baseloop,用户定义的loop
     EventLoop* loop_;
 
     const std::string ipPort_;
     const std::string name_;
+    // 所有连接共享的名字前缀 "name-ip:port"
+    const TcpConnection::NamePrefixPtr connNamePrefix_;
 
     // 运行在mainLoop，监听连接事件
     std::unique_ptr<Acceptor> acceptor_;
@@ -78,9 +199,30 @@ private:
 
     //loop 线程初始化的回调
     ThreadInitCallback threadInitCallback_;
+    ThreadInitCallback loopRetireCallback_;
 
     std::atomic_int started_;
 
-    int nextConnId_;
-    ConnectionMap connections_;
+    size_t flowHighMark_;
+    size_t flowLowMark_;
+
+    std::shared_ptr<MemoryBudget> memoryBudget_;
+    std::unique_ptr<AdmissionController> admission_;
+    std::unique_ptr<LoopAutoscaler> autoscaler_;
+    TimerId autoscaleTimer_;
+    TransportFactory transportFactory_;
+
+    // 只在 baseloop 中访问
+    uint64_t nextConnId_;
+    // 只在 baseloop 中修改，修改时和其他线程遍历时持 shardsMutex_
+    std::vector<ShardPtr> shards_;
+    mutable std::mutex shardsMutex_;
+    // 只在 baseloop 中访问
+    std::unordered_map<EventLoop*, Shard*> shardOfLoop_;
+    std::vector<RetiringLoop> retiring_;
+
+    std::atomic<size_t> numConnections_;
+    // gracefulStop 在 baseloop 中设置和清除，subloop 在连接数归零时读它，决定是否通知 baseloop
+    std::atomic_bool draining_;
+    DrainedCallback drainedCallback_;
 };
@@ -0,0 +1,81 @@
+#include "ThreadPool.h"
+
+#include <stdio.h>
+
+ThreadPool::ThreadPool(const std::string &name)
+    : name_(name)
+    , maxQueueSize_(0)
+    , running_(false)
+{
+}
+
+ThreadPool::~ThreadPool() {
+    stop();
+}
+
+void ThreadPool::start(int numThreads) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = true;
+    }
+    threads_.reserve(numThreads);
+    for (int i = 0; i < numThreads; ++i) {
+        char buf[32];
+        snprintf(buf, sizeof buf, "%d", i);
+        threads_.emplace_back(new Thread(std::bind(&ThreadPool::runInThread, this), name_ + buf));
+        threads_[i]->start();
+    }
+}
+
+void ThreadPool::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) {
+            return;
+        }
+        running_ = false;
+    }
+    notEmpty_.notify_all();
+    for (auto &thread : threads_) {
+        thread->join();
+    }
+    threads_.clear();
+}
+
+bool ThreadPool::run(Task task) {
+    if (threads_.empty()) {
+        task();
+        return true;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_ || (maxQueueSize_ > 0 && queue_.size() >= maxQueueSize_)) {
+            return false;
+        }
+        queue_.push_back(std::move(task));
+    }
+    notEmpty_.notify_one();
+    return true;
+}
+
+size_t ThreadPool::queueSize() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return queue_.size();
+}
+
+void ThreadPool::runInThread() {
+    while (true) {
+        Task task;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            notEmpty_.wait(lock, [this]() { return !queue_.empty() || !running_; });
+            // 停止后把剩下的任务执行完再退出
+            if (queue_.empty()) {
+                return;
+            }
+            task = std::move(queue_.front());
+            queue_.pop_front();
+        }
+        task();
+    }
+}
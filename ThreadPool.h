@@ -0,0 +1,47 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "Thread.h"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// 固定线程数的计算线程池，用来把耗时的业务逻辑移出 EventLoop 线程。
+// 队列有上限时，run() 在队列满时返回 false 而不是阻塞，避免反过来卡住调用它的 loop。
+class ThreadPool : noncopyable {
+public:
+    using Task = std::function<void()>;
+
+    explicit ThreadPool(const std::string &name = std::string("ThreadPool"));
+    ~ThreadPool();
+
+    // 0 表示不限制，需在 start() 之前设置
+    void setMaxQueueSize(size_t maxSize) { maxQueueSize_ = maxSize; }
+
+    void start(int numThreads);
+    // 等已经入队的任务执行完再退出
+    void stop();
+
+    // 可跨线程调用；线程池没有线程时在调用线程中直接执行
+    bool run(Task task);
+
+    size_t queueSize() const;
+    const std::string& name() const { return name_; }
+
+private:
+    void runInThread();
+
+    const std::string name_;
+    size_t maxQueueSize_;
+    std::vector<std::unique_ptr<Thread>> threads_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable notEmpty_;
+    std::deque<Task> queue_; // 由 mutex_ 保护
+    bool running_;           // 由 mutex_ 保护
+};
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "Timestamp.h"
+#include "Callbacks.h"
+
+#include <atomic>
+
+// 一个定时任务，由 TimerQueue 管理，只在所属 loop 线程中访问
+class Timer : noncopyable {
+public:
+    Timer(TimerCallback cb, Timestamp when, double interval)
+        : callback_(std::move(cb))
+        , expiration_(when)
+        , interval_(interval)
+        , repeat_(interval > 0.0)
+        , sequence_(++s_numCreated_)
+    {}
+
+    void run() const { callback_(); }
+
+    Timestamp expiration() const { return expiration_; }
+    bool repeat() const { return repeat_; }
+    int64_t sequence() const { return sequence_; }
+
+    // 重复的定时器从 now 开始计算下一次到期时间
+    void restart(Timestamp now);
+
+    static int64_t numCreated() { return s_numCreated_.load(); }
+
+private:
+    const TimerCallback callback_;
+    Timestamp expiration_;
+    const double interval_; // 单位秒，0 表示只执行一次
+    const bool repeat_;
+    // Timer 的地址可能被复用，用序号区分新旧定时器
+    const int64_t sequence_;
+
+    static std::atomic<int64_t> s_numCreated_;
+};
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stdint.h>
+
+class Timer;
+
+// EventLoop::runAt/runAfter/runEvery 的返回值，用于 EventLoop::cancel
+class TimerId {
+public:
+    TimerId()
+        : timer_(nullptr)
+        , sequence_(0)
+    {}
+    TimerId(Timer *timer, int64_t seq)
+        : timer_(timer)
+        , sequence_(seq)
+    {}
+
+    bool valid() const { return timer_ != nullptr; }
+
+    friend class TimerQueue;
+
+private:
+    Timer *timer_;
+    int64_t sequence_;
+};
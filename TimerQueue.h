@@ -0,0 +1,54 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "Timestamp.h"
+#include "Channel.h"
+#include "Callbacks.h"
+
+#include <set>
+#include <vector>
+
+class EventLoop;
+class Timer;
+class TimerId;
+
+// 定时器队列：所有定时器共用一个 timerfd，到期事件和普通 IO 事件一样由 Poller 通知，
+// 定时器按到期时间放在 std::set 中，timerfd 始终设为最早的到期时间
+class TimerQueue : noncopyable {
+public:
+    explicit TimerQueue(EventLoop *loop);
+    ~TimerQueue();
+
+    // 可跨线程调用；interval > 0 时重复执行
+    TimerId addTimer(TimerCallback cb, Timestamp when, double interval);
+    // 可跨线程调用
+    void cancel(TimerId timerId);
+
+private:
+    using Entry = std::pair<Timestamp, Timer*>;
+    using TimerList = std::set<Entry>;
+    using ActiveTimer = std::pair<Timer*, int64_t>;
+    using ActiveTimerSet = std::set<ActiveTimer>;
+
+    void addTimerInLoop(Timer *timer);
+    void cancelInLoop(TimerId timerId);
+    // timerfd 可读
+    void handleRead();
+    // 取出所有到期的定时器
+    std::vector<Entry> getExpired(Timestamp now);
+    void reset(const std::vector<Entry> &expired, Timestamp now);
+    // 返回插入的定时器是否成为最早到期的一个
+    bool insert(Timer *timer);
+
+    EventLoop *loop_;
+    const int timerfd_;
+    Channel timerfdChannel_;
+    // 按到期时间排序
+    TimerList timers_;
+
+    // 与 timers_ 中的定时器相同，按地址排序，供 cancel 查找
+    ActiveTimerSet activeTimers_;
+    bool callingExpiredTimers_;
+    // 到期回调执行期间被取消的重复定时器，不再重新加入
+    ActiveTimerSet cancelingTimers_;
+};
@@ -1,5 +1,9 @@
 #include "Timestamp.h"
-#include <time.h>
+
+#include <stdio.h>
+
+// 每个线程缓存的当前时间，由所在线程的 EventLoop 刷新
+static thread_local int64_t t_cachedMicroSeconds = 0;
 
 Timestamp::Timestamp():microSecondsSinceEpoch_(0){}
 
@@ -8,22 +12,54 @@ Timestamp::Timestamp(int64_t microSecondsSinceEpoch)
     {}
 
 Timestamp Timestamp::now(){
-    return Timestamp(time(NULL));
+    // CLOCK_REALTIME 由 vDSO 提供，不需要系统调用
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return Timestamp(static_cast<int64_t>(ts.tv_sec) * kMicroSecondsPerSecond + ts.tv_nsec / 1000);
+}
+
+Timestamp Timestamp::cachedNow(){
+    if(t_cachedMicroSeconds == 0){
+        return now();
+    }
+    return Timestamp(t_cachedMicroSeconds);
+}
+
+void Timestamp::setCachedNow(Timestamp now){
+    t_cachedMicroSeconds = now.microSecondsSinceEpoch();
+}
+
+std::string Timestamp::toString() const{
+    return toFormattedString(false);
 }
 
-std::string Timestamp::toString(){
+std::string Timestamp::toFormattedString(bool showMicroseconds) const{
     char timeStr[128] = {0};
-    // localtime 接收一个指向 time_t 类型变量的指针
-    // time_t 用来存储时间，通常表示自 Epoch 以来经过的秒数。
-    tm *tm_time = localtime(&microSecondsSinceEpoch_);
-    snprintf(timeStr, 128, "%4d/%02d/%02d %02d:%02d:%02d",
-        tm_time->tm_year + 1900,
-        tm_time->tm_mon + 1,
-        tm_time->tm_mday,
-        tm_time->tm_hour,
-        tm_time->tm_min,
-        tm_time->tm_sec
-    );
+    // localtime 返回静态缓冲区，多个线程同时写日志时要用 localtime_r
+    time_t seconds = secondsSinceEpoch();
+    tm tm_result;
+    tm *tm_time = localtime_r(&seconds, &tm_result);
+    if(showMicroseconds){
+        int microseconds = static_cast<int>(microSecondsSinceEpoch_ % kMicroSecondsPerSecond);
+        snprintf(timeStr, 128, "%4d/%02d/%02d %02d:%02d:%02d.%06d",
+            tm_time->tm_year + 1900,
+            tm_time->tm_mon + 1,
+            tm_time->tm_mday,
+            tm_time->tm_hour,
+            tm_time->tm_min,
+            tm_time->tm_sec,
+            microseconds
+        );
+    }else{
+        snprintf(timeStr, 128, "%4d/%02d/%02d %02d:%02d:%02d",
+            tm_time->tm_year + 1900,
+            tm_time->tm_mon + 1,
+            tm_time->tm_mday,
+            tm_time->tm_hour,
+            tm_time->tm_min,
+            tm_time->tm_sec
+        );
+    }
     return timeStr;
 }
 
@@ -31,4 +67,4 @@ std::string Timestamp::toString(){
 // int main(){
 //     std::cout << Timestamp::now().toString() << std::endl;
 //     return 0;
-// }
\ No newline at end of file
+// }
@@ -1,15 +1,61 @@
 #pragma once
 
-#include <iostream>
+#include <stdint.h>
+#include <time.h>
 
 #include <string>
 
+// 微秒精度的时间戳，基于 clock_gettime(CLOCK_REALTIME)，走 vDSO，不陷入内核
 class Timestamp{
 public:
     Timestamp();
     explicit Timestamp(int64_t microSecondsSinceEpoch);
+
     static Timestamp now();
-    std::string toString();
+    // 当前线程缓存的时间，EventLoop 每次 epoll_wait 返回时刷新一次；
+    // 线程没有运行 EventLoop 时退化为 now()
+    static Timestamp cachedNow();
+    static void setCachedNow(Timestamp now);
+    static Timestamp invalid() { return Timestamp(); }
+
+    // yyyy/mm/dd HH:MM:SS
+    std::string toString() const;
+    // yyyy/mm/dd HH:MM:SS.uuuuuu
+    std::string toFormattedString(bool showMicroseconds = true) const;
+
+    bool valid() const { return microSecondsSinceEpoch_ > 0; }
+    int64_t microSecondsSinceEpoch() const { return microSecondsSinceEpoch_; }
+    time_t secondsSinceEpoch() const {
+        return static_cast<time_t>(microSecondsSinceEpoch_ / kMicroSecondsPerSecond);
+    }
+
+    static const int kMicroSecondsPerSecond = 1000 * 1000;
 private:
     int64_t microSecondsSinceEpoch_;
-};
\ No newline at end of file
+};
+
+inline bool operator<(Timestamp lhs, Timestamp rhs){
+    return lhs.microSecondsSinceEpoch() < rhs.microSecondsSinceEpoch();
+}
+inline bool operator>(Timestamp lhs, Timestamp rhs){ return rhs < lhs; }
+inline bool operator<=(Timestamp lhs, Timestamp rhs){ return !(rhs < lhs); }
+inline bool operator>=(Timestamp lhs, Timestamp rhs){ return !(lhs < rhs); }
+inline bool operator==(Timestamp lhs, Timestamp rhs){
+    return lhs.microSecondsSinceEpoch() == rhs.microSecondsSinceEpoch();
+}
+inline bool operator!=(Timestamp lhs, Timestamp rhs){ return !(lhs == rhs); }
+
+// high - low，单位微秒
+inline int64_t operator-(Timestamp high, Timestamp low){
+    return high.microSecondsSinceEpoch() - low.microSecondsSinceEpoch();
+}
+
+// high - low，单位秒
+inline double timeDifference(Timestamp high, Timestamp low){
+    return static_cast<double>(high - low) / Timestamp::kMicroSecondsPerSecond;
+}
+
+inline Timestamp addTime(Timestamp timestamp, double seconds){
+    int64_t delta = static_cast<int64_t>(seconds * Timestamp::kMicroSecondsPerSecond);
+    return Timestamp(timestamp.microSecondsSinceEpoch() + delta);
+}
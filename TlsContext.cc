@@ -0,0 +1,139 @@
+#include "TlsContext.h"
+#include "Logger.h"
+#include "TlsTransport.h"
+
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+
+// 把 OpenSSL 错误队列里的错误都打出来
+static void logSslErrors(const char *what) {
+    unsigned long err;
+    while ((err = ERR_get_error()) != 0) {
+        char buf[256];
+        ERR_error_string_n(err, buf, sizeof buf);
+        LOG_ERROR("%s: %s\n", what, buf);
+    }
+}
+
+static SSL_CTX *newSslContext(const SSL_METHOD *method) {
+    SSL_CTX *ctx = SSL_CTX_new(method);
+    if (ctx == nullptr) {
+        logSslErrors("SSL_CTX_new");
+        return nullptr;
+    }
+    SSL_CTX_set_min_proto_version(ctx, TLS1_2_VERSION);
+    // 发送失败后，剩余数据会追加到 outputBuffer_ 再重试，地址和长度都可能变化
+    SSL_CTX_set_mode(ctx, SSL_MODE_ENABLE_PARTIAL_WRITE |
+                          SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER |
+                          SSL_MODE_RELEASE_BUFFERS);
+#ifdef SSL_OP_ENABLE_KTLS
+    SSL_CTX_set_options(ctx, SSL_OP_ENABLE_KTLS);
+#endif
+#ifdef SSL_OP_IGNORE_UNEXPECTED_EOF
+    // 对端不发 close_notify 直接断开时按正常关闭处理
+    SSL_CTX_set_options(ctx, SSL_OP_IGNORE_UNEXPECTED_EOF);
+#endif
+    return ctx;
+}
+
+std::shared_ptr<TlsContext> TlsContext::newServerContext(const std::string &certFile,
+                                                         const std::string &keyFile) {
+    SSL_CTX *ctx = newSslContext(TLS_server_method());
+    if (ctx == nullptr) {
+        return nullptr;
+    }
+    if (SSL_CTX_use_certificate_chain_file(ctx, certFile.c_str()) != 1 ||
+        SSL_CTX_use_PrivateKey_file(ctx, keyFile.c_str(), SSL_FILETYPE_PEM) != 1 ||
+        SSL_CTX_check_private_key(ctx) != 1) {
+        logSslErrors("TlsContext::newServerContext");
+        SSL_CTX_free(ctx);
+        return nullptr;
+    }
+    return std::shared_ptr<TlsContext>(new TlsContext(ctx, true));
+}
+
+std::shared_ptr<TlsContext> TlsContext::newClientContext(const std::string &caFile) {
+    SSL_CTX *ctx = newSslContext(TLS_client_method());
+    if (ctx == nullptr) {
+        return nullptr;
+    }
+    if (caFile.empty()) {
+        SSL_CTX_set_verify(ctx, SSL_VERIFY_NONE, nullptr);
+    } else {
+        if (SSL_CTX_load_verify_locations(ctx, caFile.c_str(), nullptr) != 1) {
+            logSslErrors("TlsContext::newClientContext");
+            SSL_CTX_free(ctx);
+            return nullptr;
+        }
+        SSL_CTX_set_verify(ctx, SSL_VERIFY_PEER, nullptr);
+    }
+    return std::shared_ptr<TlsContext>(new TlsContext(ctx, false));
+}
+
+TlsContext::TlsContext(SSL_CTX *ctx, bool isServer)
+    : ctx_(ctx)
+    , isServer_(isServer)
+#ifdef SSL_OP_ENABLE_KTLS
+    , ktlsEnabled_(true)
+#else
+    , ktlsEnabled_(false)
+#endif
+{
+}
+
+TlsContext::~TlsContext() {
+    SSL_CTX_free(ctx_);
+}
+
+void TlsContext::setKtlsEnabled(bool on) {
+#ifdef SSL_OP_ENABLE_KTLS
+    if (on) {
+        SSL_CTX_set_options(ctx_, SSL_OP_ENABLE_KTLS);
+    } else {
+        SSL_CTX_clear_options(ctx_, SSL_OP_ENABLE_KTLS);
+    }
+    ktlsEnabled_ = on;
+#else
+    if (on) {
+        LOG_ERROR("TlsContext::setKtlsEnabled - OpenSSL built without kTLS support\n");
+    }
+#endif
+}
+
+TransportFactory TlsContext::serverTransportFactory() {
+    if (!isServer_) {
+        LOG_ERROR("TlsContext::serverTransportFactory on a client context\n");
+    }
+    std::shared_ptr<TlsContext> self(shared_from_this());
+    return [self](int sockfd) -> std::unique_ptr<Transport> {
+        SSL *ssl = SSL_new(self->ctx_);
+        if (ssl == nullptr || SSL_set_fd(ssl, sockfd) != 1) {
+            logSslErrors("TlsContext::serverTransportFactory");
+            SSL_free(ssl);
+            return std::unique_ptr<Transport>();
+        }
+        SSL_set_accept_state(ssl);
+        return std::unique_ptr<Transport>(new TlsTransport(self, ssl, sockfd));
+    };
+}
+
+TransportFactory TlsContext::clientTransportFactory(const std::string &serverName) {
+    if (isServer_) {
+        LOG_ERROR("TlsContext::clientTransportFactory on a server context\n");
+    }
+    std::shared_ptr<TlsContext> self(shared_from_this());
+    return [self, serverName](int sockfd) -> std::unique_ptr<Transport> {
+        SSL *ssl = SSL_new(self->ctx_);
+        if (ssl == nullptr || SSL_set_fd(ssl, sockfd) != 1) {
+            logSslErrors("TlsContext::clientTransportFactory");
+            SSL_free(ssl);
+            return std::unique_ptr<Transport>();
+        }
+        if (!serverName.empty()) {
+            SSL_set_tlsext_host_name(ssl, serverName.c_str());
+            SSL_set1_host(ssl, serverName.c_str());
+        }
+        SSL_set_connect_state(ssl);
+        return std::unique_ptr<Transport>(new TlsTransport(self, ssl, sockfd));
+    };
+}
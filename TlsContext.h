@@ -0,0 +1,44 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "Transport.h"
+
+#include <memory>
+#include <string>
+
+typedef struct ssl_ctx_st SSL_CTX;
+
+// OpenSSL 的 SSL_CTX，多个连接共享。为每个连接创建 TlsTransport：
+//   std::shared_ptr<TlsContext> tls = TlsContext::newServerContext("cert.pem", "key.pem");
+//   server.setTransportFactory(tls->serverTransportFactory());
+// 默认开启 kTLS（SSL_OP_ENABLE_KTLS），握手完成后由内核加解密，内核或算法不支持时退回用户态 TLS。
+// 只在找到 OpenSSL 时编译。
+class TlsContext : noncopyable,
+    public std::enable_shared_from_this<TlsContext>
+{
+public:
+    // 证书或私钥加载失败时返回 nullptr
+    static std::shared_ptr<TlsContext> newServerContext(const std::string &certFile,
+                                                        const std::string &keyFile);
+    // caFile 为空时不校验服务端证书（只用于测试）
+    static std::shared_ptr<TlsContext> newClientContext(const std::string &caFile = std::string());
+
+    ~TlsContext();
+
+    // 是否尝试 kTLS，只影响之后创建的连接
+    void setKtlsEnabled(bool on);
+    bool ktlsEnabled() const { return ktlsEnabled_; }
+
+    TransportFactory serverTransportFactory();
+    // serverName 用于 SNI 和证书主机名校验
+    TransportFactory clientTransportFactory(const std::string &serverName = std::string());
+
+    SSL_CTX* nativeHandle() const { return ctx_; }
+
+private:
+    TlsContext(SSL_CTX *ctx, bool isServer);
+
+    SSL_CTX *ctx_;
+    const bool isServer_;
+    bool ktlsEnabled_;
+};
@@ -0,0 +1,136 @@
+#include "TlsTransport.h"
+#include "Logger.h"
+#include "TlsContext.h"
+
+#include <errno.h>
+#include <unistd.h>
+
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+
+TlsTransport::TlsTransport(const std::shared_ptr<TlsContext> &context, SSL *ssl, int sockfd)
+    : context_(context)
+    , ssl_(ssl)
+    , sockfd_(sockfd)
+    , ktlsSend_(false)
+    , ktlsRecv_(false)
+    , shutdownSent_(false)
+{
+}
+
+// sockfd 由 TcpConnection 的 Socket 关闭，SSL_free 只释放 BIO 不关闭 fd
+TlsTransport::~TlsTransport() {
+    SSL_free(ssl_);
+}
+
+Transport::HandshakeState TlsTransport::handshake() {
+    ERR_clear_error();
+    int ret = SSL_do_handshake(ssl_);
+    if (ret == 1) {
+#ifndef OPENSSL_NO_KTLS
+        ktlsSend_ = BIO_get_ktls_send(SSL_get_wbio(ssl_));
+        ktlsRecv_ = BIO_get_ktls_recv(SSL_get_rbio(ssl_));
+#endif
+        LOG_DEBUG("TlsTransport handshake done fd=%d %s %s ktls send=%d recv=%d\n", sockfd_,
+                  protocol().c_str(), cipher().c_str(), ktlsSend_, ktlsRecv_);
+        return kHandshakeDone;
+    }
+    switch (SSL_get_error(ssl_, ret))
+    {
+    case SSL_ERROR_WANT_READ:
+        return kHandshakeWantRead;
+    case SSL_ERROR_WANT_WRITE:
+        return kHandshakeWantWrite;
+    default:
+    {
+        unsigned long err = ERR_get_error();
+        char buf[256] = "connection closed";
+        if (err != 0) {
+            ERR_error_string_n(err, buf, sizeof buf);
+        }
+        LOG_ERROR("TlsTransport handshake failed fd=%d: %s\n", sockfd_, buf);
+        ERR_clear_error();
+        return kHandshakeFailed;
+    }
+    }
+}
+
+ssize_t TlsTransport::read(void *buf, size_t len) {
+    ERR_clear_error();
+    errno = 0;
+    int n = SSL_read(ssl_, buf, static_cast<int>(len));
+    if (n > 0) {
+        return n;
+    }
+    return translateError(n, "SSL_read");
+}
+
+ssize_t TlsTransport::write(const void *buf, size_t len) {
+    if (ktlsSend_) {
+        // 内核负责分帧和加密，明文直接写进 socket
+        return ::write(sockfd_, buf, len);
+    }
+    ERR_clear_error();
+    errno = 0;
+    int n = SSL_write(ssl_, buf, static_cast<int>(len));
+    if (n > 0) {
+        return n;
+    }
+    return translateError(n, "SSL_write");
+}
+
+size_t TlsTransport::pending() const {
+    return static_cast<size_t>(SSL_pending(ssl_));
+}
+
+void TlsTransport::shutdown() {
+    if (!shutdownSent_) {
+        shutdownSent_ = true;
+        // 只发送 close_notify，不等对端的回应
+        ERR_clear_error();
+        SSL_shutdown(ssl_);
+        ERR_clear_error();
+    }
+}
+
+ssize_t TlsTransport::translateError(int ret, const char *op) {
+    int savedErrno = errno;
+    int err = SSL_get_error(ssl_, ret);
+    switch (err)
+    {
+    case SSL_ERROR_ZERO_RETURN:
+        // 收到 close_notify
+        return 0;
+    case SSL_ERROR_WANT_READ:
+    case SSL_ERROR_WANT_WRITE:
+        errno = EAGAIN;
+        return -1;
+    case SSL_ERROR_SYSCALL:
+        // 没有 close_notify 就断开了，当作对端关闭
+        if (savedErrno == 0) {
+            return 0;
+        }
+        errno = savedErrno;
+        return -1;
+    default:
+    {
+        unsigned long code = ERR_get_error();
+        char buf[256] = "unknown error";
+        if (code != 0) {
+            ERR_error_string_n(code, buf, sizeof buf);
+        }
+        LOG_ERROR("TlsTransport %s fd=%d: %s\n", op, sockfd_, buf);
+        ERR_clear_error();
+        errno = EPROTO;
+        return -1;
+    }
+    }
+}
+
+std::string TlsTransport::protocol() const {
+    return SSL_get_version(ssl_);
+}
+
+std::string TlsTransport::cipher() const {
+    return SSL_get_cipher_name(ssl_);
+}
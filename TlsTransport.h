@@ -0,0 +1,45 @@
+#pragma once
+
+#include "Transport.h"
+
+#include <memory>
+#include <string>
+
+typedef struct ssl_st SSL;
+class TlsContext;
+
+// 一个 TLS 连接，由 TlsContext 创建，交给 TcpConnection::setTransport。
+// 握手由 TcpConnection 根据 Channel 的读写事件驱动，不阻塞 loop。
+// 握手完成后如果内核接管了发送方向的加密（kTLS），write 直接写 fd，
+// 明文进入内核、在内核里加密，和普通 TCP 一样可以用 write/sendfile；
+// 接收方向始终经过 SSL_read，内核解密时 OpenSSL 只负责处理控制消息。
+class TlsTransport : public Transport {
+public:
+    TlsTransport(const std::shared_ptr<TlsContext> &context, SSL *ssl, int sockfd);
+    ~TlsTransport() override;
+
+    HandshakeState handshake() override;
+    ssize_t read(void *buf, size_t len) override;
+    ssize_t write(const void *buf, size_t len) override;
+    size_t pending() const override;
+    void shutdown() override;
+
+    // 握手完成后有效
+    bool ktlsSend() const { return ktlsSend_; }
+    bool ktlsRecv() const { return ktlsRecv_; }
+    std::string protocol() const;
+    std::string cipher() const;
+
+    SSL* nativeHandle() const { return ssl_; }
+
+private:
+    // 把 SSL_get_error 的结果翻译成 errno，返回值同 read/write
+    ssize_t translateError(int ret, const char *op);
+
+    std::shared_ptr<TlsContext> context_; // 保证 SSL_CTX 比连接活得久
+    SSL *ssl_;
+    const int sockfd_;
+    bool ktlsSend_;
+    bool ktlsRecv_;
+    bool shutdownSent_;
+};
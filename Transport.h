@@ -0,0 +1,37 @@
+#pragma once
+
+#include "noncopyable.h"
+
+#include <functional>
+#include <memory>
+#include <sys/types.h>
+
+// TcpConnection 在 socket 上收发数据的方式。没有设置 Transport 时直接读写 fd；
+// 需要在用户态处理数据（例如 TLS 加解密）时，由 Transport 接管读写。
+// 所有方法都在连接所属的 loop 线程中调用。
+class Transport : noncopyable {
+public:
+    enum HandshakeState {
+        kHandshakeDone,
+        kHandshakeWantRead,  // 等待 fd 可读后再次调用 handshake()
+        kHandshakeWantWrite, // 等待 fd 可写后再次调用 handshake()
+        kHandshakeFailed,
+    };
+
+    virtual ~Transport() {}
+
+    // 连接可用之前的握手，TcpConnection 根据返回值关注读写事件
+    virtual HandshakeState handshake() { return kHandshakeDone; }
+
+    // 语义同 read/write：返回字节数，0 表示对端关闭，-1 表示出错，
+    // 此时 errno 有效，EAGAIN 表示要等下一次可读/可写事件
+    virtual ssize_t read(void *buf, size_t len) = 0;
+    virtual ssize_t write(const void *buf, size_t len) = 0;
+    // 已经从 socket 读出、还留在 Transport 内部没有交给 read() 的字节数
+    virtual size_t pending() const { return 0; }
+    // TcpConnection 关闭写端之前调用（TLS 在这里发送 close_notify）
+    virtual void shutdown() {}
+};
+
+// TcpServer/TcpClient 为每个新连接创建 Transport，返回 nullptr 表示创建失败，连接会被关闭
+using TransportFactory = std::function<std::unique_ptr<Transport>(int sockfd)>;
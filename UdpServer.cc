@@ -0,0 +1,110 @@
+#include "UdpServer.h"
+#include "EventLoop.h"
+#include "Logger.h"
+#include "Socket.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static EventLoop *CheckLoopNotNull(EventLoop *loop) {
+    if (loop == nullptr) {
+        LOG_FATAL("%s:%s:%d mainLoop is null! \n", __FILE__, __FUNCTION__, __LINE__);
+    }
+    return loop;
+}
+
+UdpServer::UdpServer(EventLoop *loop, const InetAddress &listenAddr,
+                     const std::string &nameArg, const UdpSocket::Options &options)
+    : loop_(CheckLoopNotNull(loop))
+    , listenAddr_(listenAddr)
+    , name_(nameArg)
+    , options_(options)
+    , threadPool_(new EventLoopThreadPool(loop, name_))
+    , started_(0)
+{
+}
+
+UdpServer::~UdpServer() {
+    // socket 在各自的 loop 中关闭
+    for (const UdpSocketPtr &socket : sockets_) {
+        UdpSocketPtr s(socket);
+        socket->getLoop()->runInLoop([s]() { s->closeInLoop(); });
+    }
+}
+
+int UdpServer::createBoundSocket(const InetAddress &addr, const UdpSocket::Options &options) {
+    int sockfd = ::socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (sockfd < 0) {
+        LOG_FATAL("%s:%s:%d udp socket create err:%d \n", __FILE__, __FUNCTION__, __LINE__, errno);
+    }
+    int on = 1;
+    ::setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof on);
+    ::setsockopt(sockfd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof on);
+    if (options.recvBufferBytes > 0) {
+        ::setsockopt(sockfd, SOL_SOCKET, SO_RCVBUF, &options.recvBufferBytes,
+                     sizeof options.recvBufferBytes);
+    }
+    if (options.sendBufferBytes > 0) {
+        ::setsockopt(sockfd, SOL_SOCKET, SO_SNDBUF, &options.sendBufferBytes,
+                     sizeof options.sendBufferBytes);
+    }
+    if (::bind(sockfd, addr.getSockAddr(), addr.getSockAddrLen()) < 0) {
+        LOG_FATAL("bind udp sockfd: %d to %s fail, errno: %d, error: %s\n", sockfd,
+                  addr.toIpPort().c_str(), errno, strerror(errno));
+    }
+    return sockfd;
+}
+
+void UdpServer::start() {
+    if (started_++ == 0) {
+        threadPool_->start(threadInitCallback_);
+        for (EventLoop *ioLoop : threadPool_->getAllLoops()) {
+            int sockfd = createBoundSocket(listenAddr_, options_);
+            if (listenAddr_.toPort() == 0) {
+                // 端口由内核分配时，其余 socket 都 bind 到第一个 socket 拿到的端口上
+                listenAddr_ = sockets::getLocalAddr(sockfd);
+            }
+            UdpSocketPtr socket(new UdpSocket(ioLoop, sockfd, options_));
+            socket->setMessageCallback(messageCallback_);
+            sockets_.push_back(socket);
+            ioLoop->runInLoop(std::bind(&UdpSocket::startInLoop, socket));
+        }
+        LOG_INFO("UdpServer[%s] listening on %s with %lu sockets\n", name_.c_str(),
+                 listenAddr_.toIpPort().c_str(), static_cast<unsigned long>(sockets_.size()));
+    }
+}
+
+UdpSocket* UdpServer::socketOf(EventLoop *loop) const {
+    for (const UdpSocketPtr &socket : sockets_) {
+        if (socket->getLoop() == loop) {
+            return socket.get();
+        }
+    }
+    return nullptr;
+}
+
+uint64_t UdpServer::packetsReceived() const {
+    uint64_t total = 0;
+    for (const UdpSocketPtr &socket : sockets_) {
+        total += socket->packetsReceived();
+    }
+    return total;
+}
+
+uint64_t UdpServer::packetsSent() const {
+    uint64_t total = 0;
+    for (const UdpSocketPtr &socket : sockets_) {
+        total += socket->packetsSent();
+    }
+    return total;
+}
+
+uint64_t UdpServer::packetsDropped() const {
+    uint64_t total = 0;
+    for (const UdpSocketPtr &socket : sockets_) {
+        total += socket->packetsDropped();
+    }
+    return total;
+}
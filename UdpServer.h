@@ -0,0 +1,60 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "EventLoopThreadPool.h"
+#include "InetAddress.h"
+#include "UdpSocket.h"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+class EventLoop;
+
+// UDP 服务器：每个 subloop 一个 bind 在同一地址上的 SO_REUSEPORT socket，
+// 内核按四元组把数据报分散到各个 socket，loop 之间不共享任何状态。
+// 每个 socket 用 recvmmsg/sendmmsg 成批收发，见 UdpSocket。
+// 回调在收到数据报的 loop 中执行，回复用回调参数里的 UdpSocket 发送。
+class UdpServer : noncopyable {
+public:
+    using ThreadInitCallback = std::function<void(EventLoop*)>;
+
+    UdpServer(EventLoop *loop,
+              const InetAddress &listenAddr,
+              const std::string &nameArg,
+              const UdpSocket::Options &options = UdpSocket::Options());
+    ~UdpServer();
+
+    // 设置底层subloop的个数，为 0 时只在 baseloop 上建一个 socket
+    void setThreadNum(int numThreads) { threadPool_->setThreadNum(numThreads); }
+    void setThreadInitCallback(const ThreadInitCallback &cb) { threadInitCallback_ = cb; }
+    void setMessageCallback(const UdpMessageCallback &cb) { messageCallback_ = cb; }
+
+    void start();
+
+    const std::string& name() const { return name_; }
+    // start() 之后不再变化
+    const std::vector<UdpSocketPtr>& sockets() const { return sockets_; }
+    // loop 上的 socket，用于在回调之外（例如定时器里）主动发送
+    UdpSocket* socketOf(EventLoop *loop) const;
+
+    // 所有 socket 的统计之和，可跨线程读取
+    uint64_t packetsReceived() const;
+    uint64_t packetsSent() const;
+    uint64_t packetsDropped() const;
+
+private:
+    static int createBoundSocket(const InetAddress &addr, const UdpSocket::Options &options);
+
+    EventLoop *loop_;
+    InetAddress listenAddr_;
+    const std::string name_;
+    const UdpSocket::Options options_;
+    std::shared_ptr<EventLoopThreadPool> threadPool_;
+    ThreadInitCallback threadInitCallback_;
+    UdpMessageCallback messageCallback_;
+    std::atomic_int started_;
+    std::vector<UdpSocketPtr> sockets_;
+};
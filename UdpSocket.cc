@@ -0,0 +1,280 @@
+#include "UdpSocket.h"
+#include "Channel.h"
+#include "EventLoop.h"
+#include "Logger.h"
+#include "Socket.h"
+
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifndef SOL_UDP
+#define SOL_UDP 17
+#endif
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+
+// 内核一次 GSO 发送最多切出的数据报个数，以及单次发送的总长度上限
+static const size_t kMaxGsoSegments = 64;
+static const size_t kMaxGsoBytes = 65000;
+
+UdpSocket::UdpSocket(EventLoop *loop, int sockfd, const Options &options)
+    : loop_(loop)
+    , sockfd_(sockfd)
+    , options_(options)
+    , channel_(new Channel(loop, sockfd))
+    , recvBuffer_(options.batchSize * options.maxDatagramSize)
+    , recvMsgs_(options.batchSize)
+    , recvIovecs_(options.batchSize)
+    , recvAddrs_(options.batchSize)
+    , packets_(options.batchSize)
+    , sendBuffer_(options.batchSize * options.maxDatagramSize)
+    , sendBufferUsed_(0)
+    , sendMsgs_(options.batchSize)
+    , sendIovecs_(options.batchSize)
+    , sendAddrs_(options.batchSize)
+    , numPending_(0)
+    , inCallback_(false)
+    , flushQueued_(false)
+    , gsoSupported_(true)
+    , closed_(false)
+    , packetsReceived_(0)
+    , packetsSent_(0)
+    , packetsDropped_(0)
+    , syscalls_(0)
+{
+    // mmsghdr 和接收槽一一对应，之后每次 recvmmsg 只需重置地址长度
+    for (int i = 0; i < options_.batchSize; ++i) {
+        recvIovecs_[i].iov_base = &recvBuffer_[i * options_.maxDatagramSize];
+        recvIovecs_[i].iov_len = options_.maxDatagramSize;
+        memset(&recvMsgs_[i], 0, sizeof recvMsgs_[i]);
+        recvMsgs_[i].msg_hdr.msg_iov = &recvIovecs_[i];
+        recvMsgs_[i].msg_hdr.msg_iovlen = 1;
+        recvMsgs_[i].msg_hdr.msg_name = &recvAddrs_[i];
+
+        memset(&sendMsgs_[i], 0, sizeof sendMsgs_[i]);
+        sendMsgs_[i].msg_hdr.msg_iov = &sendIovecs_[i];
+        sendMsgs_[i].msg_hdr.msg_iovlen = 1;
+        sendMsgs_[i].msg_hdr.msg_name = &sendAddrs_[i];
+        sendMsgs_[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+    }
+    channel_->setReadCallback(std::bind(&UdpSocket::handleRead, this, std::placeholders::_1));
+}
+
+UdpSocket::~UdpSocket() {
+    if (!closed_) {
+        ::close(sockfd_);
+    }
+}
+
+void UdpSocket::startInLoop() {
+    channel_->enableReading();
+}
+
+void UdpSocket::closeInLoop() {
+    if (closed_) {
+        return;
+    }
+    flush();
+    channel_->disableAll();
+    channel_->remove();
+    ::close(sockfd_);
+    closed_ = true;
+}
+
+InetAddress UdpSocket::localAddress() const {
+    return sockets::getLocalAddr(sockfd_);
+}
+
+void UdpSocket::handleRead(Timestamp receiveTime) {
+    inCallback_ = true;
+    for (int batch = 0; batch < options_.maxBatchesPerRead && !closed_; ++batch) {
+        for (int i = 0; i < options_.batchSize; ++i) {
+            recvMsgs_[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+            recvMsgs_[i].msg_hdr.msg_flags = 0;
+        }
+        int n = ::recvmmsg(sockfd_, recvMsgs_.data(), options_.batchSize, MSG_DONTWAIT, nullptr);
+        add(syscalls_, 1);
+        if (n < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                LOG_ERROR("UdpSocket::handleRead recvmmsg err:%d\n", errno);
+            }
+            break;
+        }
+
+        size_t count = 0;
+        for (int i = 0; i < n; ++i) {
+            if (recvMsgs_[i].msg_hdr.msg_flags & MSG_TRUNC) {
+                // 数据报比接收槽大，只收到了一部分，整个丢弃
+                add(packetsDropped_, 1);
+                continue;
+            }
+            UdpPacket &packet = packets_[count++];
+            packet.data = static_cast<const char*>(recvIovecs_[i].iov_base);
+            packet.len = recvMsgs_[i].msg_len;
+            packet.peer.setSockAddr(recvAddrs_[i]);
+        }
+        add(packetsReceived_, count);
+        if (count > 0 && messageCallback_) {
+            messageCallback_(this, packets_.data(), count, receiveTime);
+        }
+        if (n < options_.batchSize) {
+            // 已经读空
+            break;
+        }
+    }
+    inCallback_ = false;
+    flush();
+}
+
+void UdpSocket::send(const InetAddress &peer, const void *data, size_t len) {
+    if (loop_->isInLoopThread()) {
+        enqueue(peer, data, len);
+        scheduleFlush();
+    } else {
+        void (UdpSocket::*fp)(const InetAddress&, const std::string&) = &UdpSocket::sendInLoop;
+        loop_->runInLoop(std::bind(fp, shared_from_this(), peer,
+                                   std::string(static_cast<const char*>(data), len)));
+    }
+}
+
+void UdpSocket::sendInLoop(const InetAddress &peer, const std::string &data) {
+    enqueue(peer, data.data(), data.size());
+    scheduleFlush();
+}
+
+void UdpSocket::enqueue(const InetAddress &peer, const void *data, size_t len) {
+    if (closed_) {
+        add(packetsDropped_, 1);
+        return;
+    }
+    if (len > sendBuffer_.size()) {
+        // 放不进发送队列的大数据报单独发送
+        flush();
+        ssize_t n = ::sendto(sockfd_, data, len, 0, peer.getSockAddr(),
+                             peer.getSockAddrLen());
+        add(syscalls_, 1);
+        add(n < 0 ? packetsDropped_ : packetsSent_, 1);
+        return;
+    }
+    if (numPending_ == options_.batchSize || sendBufferUsed_ + len > sendBuffer_.size()) {
+        flush();
+    }
+    char *slot = &sendBuffer_[sendBufferUsed_];
+    memcpy(slot, data, len);
+    sendBufferUsed_ += len;
+    sendIovecs_[numPending_].iov_base = slot;
+    sendIovecs_[numPending_].iov_len = len;
+    sendAddrs_[numPending_] = *peer.getSockAddrInet();
+    ++numPending_;
+}
+
+void UdpSocket::scheduleFlush() {
+    // 回调中的发送由 handleRead 结束时统一发出；
+    // 其他时候投递一次 flush，同一轮里的多次发送合并成一次 sendmmsg
+    if (inCallback_ || flushQueued_) {
+        return;
+    }
+    flushQueued_ = true;
+    UdpSocketPtr self(shared_from_this());
+    loop_->queueInLoop([self]() {
+        self->flushQueued_ = false;
+        self->flush();
+    });
+}
+
+void UdpSocket::flush() {
+    int sent = 0;
+    while (sent < numPending_) {
+        int n = ::sendmmsg(sockfd_, &sendMsgs_[sent], numPending_ - sent, 0);
+        add(syscalls_, 1);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            // EAGAIN 说明 socket 发送缓冲区已满，UDP 不重发，剩下的数据报记为丢弃
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                LOG_ERROR("UdpSocket::flush sendmmsg err:%d\n", errno);
+            }
+            add(packetsDropped_, numPending_ - sent);
+            break;
+        }
+        sent += n;
+        add(packetsSent_, n);
+    }
+    numPending_ = 0;
+    sendBufferUsed_ = 0;
+}
+
+void UdpSocket::sendSegments(const InetAddress &peer, const void *data, size_t len,
+                             uint16_t segmentSize) {
+    if (segmentSize == 0) {
+        return;
+    }
+    const char *p = static_cast<const char*>(data);
+    if (!gsoSupported_ || len <= segmentSize || closed_) {
+        for (size_t offset = 0; offset < len; offset += segmentSize) {
+            size_t n = len - offset < segmentSize ? len - offset : segmentSize;
+            enqueue(peer, p + offset, n);
+        }
+        scheduleFlush();
+        return;
+    }
+
+    // 保证和发送队列里已有的数据报的先后顺序
+    flush();
+    size_t segmentsPerCall = kMaxGsoBytes / segmentSize;
+    if (segmentsPerCall > kMaxGsoSegments) {
+        segmentsPerCall = kMaxGsoSegments;
+    }
+    if (segmentsPerCall == 0) {
+        segmentsPerCall = 1;
+    }
+    const size_t bytesPerCall = segmentsPerCall * segmentSize;
+
+    size_t offset = 0;
+    while (offset < len) {
+        size_t n = len - offset < bytesPerCall ? len - offset : bytesPerCall;
+        iovec iov;
+        iov.iov_base = const_cast<char*>(p + offset);
+        iov.iov_len = n;
+        char control[CMSG_SPACE(sizeof(uint16_t))];
+        memset(control, 0, sizeof control);
+        msghdr msg;
+        memset(&msg, 0, sizeof msg);
+        msg.msg_name = const_cast<sockaddr*>(peer.getSockAddr());
+        msg.msg_namelen = peer.getSockAddrLen();
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof control;
+        cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_UDP;
+        cmsg->cmsg_type = UDP_SEGMENT;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+        memcpy(CMSG_DATA(cmsg), &segmentSize, sizeof segmentSize);
+
+        size_t segments = (n + segmentSize - 1) / segmentSize;
+        ssize_t ret = ::sendmsg(sockfd_, &msg, 0);
+        add(syscalls_, 1);
+        if (ret < 0) {
+            if (errno == EINVAL || errno == EIO || errno == ENOPROTOOPT || errno == EOPNOTSUPP) {
+                // 内核或网卡不支持 UDP_SEGMENT，之后都走 sendmmsg
+                LOG_INFO("UdpSocket::sendSegments UDP_SEGMENT unsupported, err:%d\n", errno);
+                gsoSupported_ = false;
+                sendSegments(peer, p + offset, len - offset, segmentSize);
+                return;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                LOG_ERROR("UdpSocket::sendSegments sendmsg err:%d\n", errno);
+            }
+            add(packetsDropped_, segments);
+        } else {
+            add(packetsSent_, segments);
+        }
+        offset += n;
+    }
+}
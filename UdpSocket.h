@@ -0,0 +1,122 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "InetAddress.h"
+#include "Timestamp.h"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <sys/socket.h>
+
+class Channel;
+class EventLoop;
+class UdpSocket;
+
+// 一个收到的数据报，data 指向 UdpSocket 预分配的接收槽，只在回调期间有效
+struct UdpPacket {
+    const char *data;
+    size_t len;
+    InetAddress peer;
+};
+
+// 一批数据报，一次 recvmmsg 收到的全部交给回调
+using UdpMessageCallback = std::function<void(UdpSocket *socket, const UdpPacket *packets,
+                                              size_t count, Timestamp receiveTime)>;
+
+// 一个 loop 上的 UDP socket。接收用 recvmmsg 一次收一批，数据写进预分配的槽，不做拷贝；
+// 发送先攒在发送队列里，在本轮回调结束后用 sendmmsg 一次发出。
+// 除了 send 和统计计数，其余方法只能在 loop 线程中调用；对象由 shared_ptr 管理。
+class UdpSocket : noncopyable,
+    public std::enable_shared_from_this<UdpSocket>
+{
+public:
+    struct Options {
+        Options()
+            : batchSize(64)
+            , maxDatagramSize(2048)
+            , maxBatchesPerRead(8)
+            , recvBufferBytes(0)
+            , sendBufferBytes(0)
+        {}
+        int batchSize;         // 每次 recvmmsg/sendmmsg 最多处理的数据报个数
+        size_t maxDatagramSize; // 接收槽大小，超过的数据报被截断并丢弃
+        int maxBatchesPerRead; // 一次可读事件最多收几批，避免一个 socket 饿死 loop 上的其他事件
+        int recvBufferBytes;   // SO_RCVBUF，0 表示使用系统默认值
+        int sendBufferBytes;   // SO_SNDBUF，0 表示使用系统默认值
+    };
+
+    // sockfd 已经 bind 好，UdpSocket 负责关闭
+    UdpSocket(EventLoop *loop, int sockfd, const Options &options);
+    ~UdpSocket();
+
+    void setMessageCallback(const UdpMessageCallback &cb) { messageCallback_ = cb; }
+
+    // 在 loop 线程中注册可读事件
+    void startInLoop();
+    // 在 loop 线程中注销并关闭
+    void closeInLoop();
+
+    // 数据报拷贝进发送队列，本轮事件处理完后批量发出；可跨线程调用
+    void send(const InetAddress &peer, const void *data, size_t len);
+    // 把 data 按 segmentSize 切成多个数据报发给同一个 peer，
+    // 内核支持 UDP_SEGMENT 时只需一次系统调用，由内核或网卡完成切分；只能在 loop 线程中调用
+    void sendSegments(const InetAddress &peer, const void *data, size_t len, uint16_t segmentSize);
+    // 立即发出发送队列中的数据报
+    void flush();
+
+    EventLoop* getLoop() const { return loop_; }
+    int fd() const { return sockfd_; }
+    InetAddress localAddress() const;
+
+    // 统计，可跨线程读取
+    uint64_t packetsReceived() const { return packetsReceived_.load(std::memory_order_relaxed); }
+    uint64_t packetsSent() const { return packetsSent_.load(std::memory_order_relaxed); }
+    uint64_t packetsDropped() const { return packetsDropped_.load(std::memory_order_relaxed); }
+    uint64_t syscalls() const { return syscalls_.load(std::memory_order_relaxed); }
+
+private:
+    void handleRead(Timestamp receiveTime);
+    void sendInLoop(const InetAddress &peer, const std::string &data);
+    void enqueue(const InetAddress &peer, const void *data, size_t len);
+    void scheduleFlush();
+    // 单线程写的计数器，load + store 即可
+    static void add(std::atomic<uint64_t> &counter, uint64_t n) {
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    EventLoop *loop_;
+    const int sockfd_;
+    const Options options_;
+    std::unique_ptr<Channel> channel_;
+    UdpMessageCallback messageCallback_;
+
+    // 接收槽，batchSize 个 maxDatagramSize 大小的缓冲区，构造时一次分配好
+    std::vector<char> recvBuffer_;
+    std::vector<mmsghdr> recvMsgs_;
+    std::vector<iovec> recvIovecs_;
+    std::vector<sockaddr_in> recvAddrs_;
+    std::vector<UdpPacket> packets_;
+
+    // 发送队列，数据报依次拷进 sendBuffer_
+    std::vector<char> sendBuffer_;
+    size_t sendBufferUsed_;
+    std::vector<mmsghdr> sendMsgs_;
+    std::vector<iovec> sendIovecs_;
+    std::vector<sockaddr_in> sendAddrs_;
+    int numPending_;
+    bool inCallback_;     // handleRead 结束时会 flush
+    bool flushQueued_;    // 已经投递了一个 flush
+    bool gsoSupported_;
+    bool closed_;
+
+    std::atomic<uint64_t> packetsReceived_;
+    std::atomic<uint64_t> packetsSent_;
+    std::atomic<uint64_t> packetsDropped_;
+    std::atomic<uint64_t> syscalls_;
+};
+
+using UdpSocketPtr = std::shared_ptr<UdpSocket>;
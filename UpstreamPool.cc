@@ -0,0 +1,518 @@
+#include "UpstreamPool.h"
+#include "Connector.h"
+#include "EventLoop.h"
+#include "Logger.h"
+#include "Socket.h"
+#include "TcpConnection.h"
+
+#include <algorithm>
+#include <deque>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+
+// 一个 loop 的子池，除计数外只在所属 loop 线程中访问。
+// 连接和定时器的回调只持有 weak_ptr，UpstreamPool 析构后子池随最后一个回调释放
+class UpstreamPool::LoopPool : noncopyable,
+    public std::enable_shared_from_this<LoopPool>
+{
+public:
+    LoopPool(EventLoop *loop, const UpstreamPool &owner, int index)
+        : loop_(loop)
+        , serverAddr_(owner.serverAddr_)
+        , options_(owner.options_)
+        , namePrefix_(std::make_shared<const std::string>(
+              owner.name_ + "-" + owner.serverAddr_.toIpPort() + "-" + std::to_string(index)))
+        , messageCallback_(owner.messageCallback_)
+        , connectionCallback_(owner.connectionCallback_)
+        , healthCheckCallback_(owner.healthCheckCallback_)
+        , nextConnId_(1)
+        , nextWaiterId_(1)
+        , down_(false)
+        , closed_(false)
+        , numIdle_(0)
+        , numConnections_(0)
+    {}
+
+    EventLoop* loop() const { return loop_; }
+    size_t numIdle() const { return numIdle_.load(std::memory_order_relaxed); }
+    size_t numConnections() const { return numConnections_.load(std::memory_order_relaxed); }
+
+    void startInLoop();
+    void closeInLoop();
+    void checkout(const CheckoutCallback &cb);
+    void checkin(const TcpConnectionPtr &conn, bool reusable);
+
+private:
+    struct Entry {
+        TcpConnectionPtr conn;
+        bool idle;
+        Timestamp idleSince;
+    };
+    struct Waiter {
+        uint64_t id;
+        CheckoutCallback cb;
+        TimerId timer;
+    };
+
+    // 补足空闲连接和等待者需要的连接
+    void fill();
+    void newConnector();
+    void newConnection(Connector *connector, int sockfd);
+    void connectFailed(int savedErrno);
+    void removeConnector(Connector *connector);
+    void removeConnection(const TcpConnectionPtr &conn);
+    void onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp receiveTime);
+    void onConnection(const TcpConnectionPtr &conn);
+    // 连接交给最早的等待者，没有等待者时放回空闲栈
+    void release(Entry &entry);
+    void closeConnection(const TcpConnectionPtr &conn);
+    void waiterTimeout(uint64_t id);
+    void failWaiters();
+    void healthCheck();
+    void updateStats();
+
+    EventLoop *loop_;
+    const InetAddress serverAddr_;
+    const UpstreamPool::Options options_;
+    const TcpConnection::NamePrefixPtr namePrefix_;
+    const MessageCallback messageCallback_;
+    const ConnectionCallback connectionCallback_;
+    const HealthCheckCallback healthCheckCallback_;
+
+    uint64_t nextConnId_;
+    // 所有已建立的连接，按 TcpConnection::id 索引
+    std::unordered_map<uint64_t, Entry> connections_;
+    // 空闲连接的 id，后进先出，最近归还的连接最先借出
+    std::vector<uint64_t> idle_;
+    std::vector<ConnectorPtr> connectors_;
+    std::deque<Waiter> waiters_;
+    uint64_t nextWaiterId_;
+    TimerId healthTimer_;
+    bool down_;   // 后端连不上，且没有可用连接
+    bool closed_;
+
+    std::atomic<size_t> numIdle_;
+    std::atomic<size_t> numConnections_;
+};
+
+void UpstreamPool::LoopPool::startInLoop() {
+    if (options_.healthCheckInterval > 0.0) {
+        std::weak_ptr<LoopPool> weakSelf(shared_from_this());
+        healthTimer_ = loop_->runEvery(options_.healthCheckInterval, [weakSelf]() {
+            LoopPoolPtr pool = weakSelf.lock();
+            if (pool) {
+                pool->healthCheck();
+            }
+        });
+    }
+    fill();
+}
+
+void UpstreamPool::LoopPool::closeInLoop() {
+    closed_ = true;
+    loop_->cancel(healthTimer_);
+    for (const ConnectorPtr &connector : connectors_) {
+        connector->stop();
+    }
+    connectors_.clear();
+    failWaiters();
+    std::vector<TcpConnectionPtr> conns;
+    for (auto &item : connections_) {
+        conns.push_back(item.second.conn);
+    }
+    for (const TcpConnectionPtr &conn : conns) {
+        closeConnection(conn);
+    }
+}
+
+void UpstreamPool::LoopPool::checkout(const CheckoutCallback &cb) {
+    if (!idle_.empty()) {
+        uint64_t id = idle_.back();
+        idle_.pop_back();
+        Entry &entry = connections_[id];
+        entry.idle = false;
+        updateStats();
+        cb(entry.conn);
+        return;
+    }
+    if (closed_ || down_) {
+        // 后端不可用时不排队，让调用方尽快失败或换一个后端
+        cb(TcpConnectionPtr());
+        return;
+    }
+
+    Waiter waiter;
+    waiter.id = nextWaiterId_++;
+    waiter.cb = cb;
+    std::weak_ptr<LoopPool> weakSelf(shared_from_this());
+    uint64_t id = waiter.id;
+    waiter.timer = loop_->runAfter(options_.checkoutTimeout, [weakSelf, id]() {
+        LoopPoolPtr pool = weakSelf.lock();
+        if (pool) {
+            pool->waiterTimeout(id);
+        }
+    });
+    waiters_.push_back(waiter);
+    fill();
+}
+
+void UpstreamPool::LoopPool::checkin(const TcpConnectionPtr &conn, bool reusable) {
+    auto it = connections_.find(conn->id());
+    if (it == connections_.end() || it->second.conn != conn || it->second.idle) {
+        // 已经断开并移出连接池
+        return;
+    }
+    if (!reusable || !conn->connected() || closed_) {
+        closeConnection(conn);
+        fill();
+        return;
+    }
+    release(it->second);
+}
+
+void UpstreamPool::LoopPool::release(Entry &entry) {
+    if (!waiters_.empty()) {
+        Waiter waiter = waiters_.front();
+        waiters_.pop_front();
+        loop_->cancel(waiter.timer);
+        entry.idle = false;
+        waiter.cb(entry.conn);
+        return;
+    }
+    entry.idle = true;
+    entry.idleSince = Timestamp::cachedNow();
+    idle_.push_back(entry.conn->id());
+    updateStats();
+}
+
+void UpstreamPool::LoopPool::fill() {
+    if (closed_) {
+        return;
+    }
+    size_t wanted = waiters_.size();
+    if (idle_.size() < options_.minIdle) {
+        wanted += options_.minIdle - idle_.size();
+    }
+    if (down_ && wanted > 1) {
+        // 后端不可用期间只用一个 Connector 探测
+        wanted = 1;
+    }
+    while (connectors_.size() < wanted &&
+           connections_.size() + connectors_.size() < options_.maxConnections) {
+        newConnector();
+    }
+}
+
+void UpstreamPool::LoopPool::newConnector() {
+    ConnectorPtr connector(new Connector(loop_, serverAddr_));
+    std::weak_ptr<LoopPool> weakSelf(shared_from_this());
+    Connector *raw = connector.get();
+    connector->setConnectTimeout(options_.connectTimeout);
+    connector->setNewConnectionCallback([weakSelf, raw](int sockfd) {
+        LoopPoolPtr pool = weakSelf.lock();
+        if (pool) {
+            pool->newConnection(raw, sockfd);
+        } else {
+            ::close(sockfd);
+        }
+    });
+    connector->setConnectFailedCallback([weakSelf](int savedErrno) {
+        LoopPoolPtr pool = weakSelf.lock();
+        if (pool) {
+            pool->connectFailed(savedErrno);
+        }
+    });
+    connectors_.push_back(connector);
+    connector->start();
+}
+
+void UpstreamPool::LoopPool::removeConnector(Connector *connector) {
+    auto it = std::find_if(connectors_.begin(), connectors_.end(),
+                           [connector](const ConnectorPtr &c) { return c.get() == connector; });
+    if (it != connectors_.end()) {
+        // 正处在 Connector 自己的回调里，延后释放
+        ConnectorPtr guard(*it);
+        connectors_.erase(it);
+        loop_->queueInLoop([guard]() {});
+    }
+}
+
+void UpstreamPool::LoopPool::newConnection(Connector *connector, int sockfd) {
+    removeConnector(connector);
+    if (closed_) {
+        ::close(sockfd);
+        return;
+    }
+    if (down_) {
+        LOG_INFO("UpstreamPool[%s] backend is up again\n", namePrefix_->c_str());
+        down_ = false;
+    }
+
+    TcpConnectionPtr conn(new TcpConnection(loop_, nextConnId_++, namePrefix_, sockfd,
+                                            sockets::getLocalAddr(sockfd),
+                                            sockets::getPeerAddr(sockfd)));
+    std::weak_ptr<LoopPool> weakSelf(shared_from_this());
+    conn->setConnectinCallback([weakSelf](const TcpConnectionPtr &c) {
+        LoopPoolPtr pool = weakSelf.lock();
+        if (pool) {
+            pool->onConnection(c);
+        }
+    });
+    conn->setMessageCallback([weakSelf](const TcpConnectionPtr &c, Buffer *buf, Timestamp t) {
+        LoopPoolPtr pool = weakSelf.lock();
+        if (pool) {
+            pool->onMessage(c, buf, t);
+        } else {
+            buf->retrieveAll();
+        }
+    });
+    EventLoop *loop = loop_;
+    conn->setCloseCallback([weakSelf, loop](const TcpConnectionPtr &c) {
+        LoopPoolPtr pool = weakSelf.lock();
+        if (pool) {
+            pool->removeConnection(c);
+        } else {
+            loop->queueInLoop(std::bind(&TcpConnection::connectDestroyed, c));
+        }
+    });
+
+    Entry &entry = connections_[conn->id()];
+    entry.conn = conn;
+    entry.idle = false;
+    conn->connectEstablished();
+    release(entry);
+    updateStats();
+}
+
+void UpstreamPool::LoopPool::connectFailed(int savedErrno) {
+    if (connections_.empty() && !down_) {
+        // 一个可用连接都没有，继续排队只会等到超时
+        LOG_ERROR("UpstreamPool[%s] backend is down, errno:%d\n", namePrefix_->c_str(), savedErrno);
+        down_ = true;
+    }
+    if (down_) {
+        failWaiters();
+    }
+    // 退避重连由 Connector 负责，多余的 Connector 停掉，只留一个探测后端
+    while (connectors_.size() > 1 && down_) {
+        ConnectorPtr connector = connectors_.back();
+        connectors_.pop_back();
+        connector->stop();
+    }
+}
+
+void UpstreamPool::LoopPool::removeConnection(const TcpConnectionPtr &conn) {
+    auto it = connections_.find(conn->id());
+    if (it != connections_.end() && it->second.conn == conn) {
+        if (it->second.idle) {
+            idle_.erase(std::find(idle_.begin(), idle_.end(), conn->id()));
+        }
+        connections_.erase(it);
+        updateStats();
+    }
+    loop_->queueInLoop(std::bind(&TcpConnection::connectDestroyed, conn));
+    fill();
+}
+
+void UpstreamPool::LoopPool::closeConnection(const TcpConnectionPtr &conn) {
+    auto it = connections_.find(conn->id());
+    if (it != connections_.end() && it->second.conn == conn) {
+        if (it->second.idle) {
+            idle_.erase(std::find(idle_.begin(), idle_.end(), conn->id()));
+        }
+        connections_.erase(it);
+        updateStats();
+    }
+    conn->forceClose();
+}
+
+void UpstreamPool::LoopPool::onConnection(const TcpConnectionPtr &conn) {
+    if (connectionCallback_) {
+        connectionCallback_(conn);
+    }
+}
+
+void UpstreamPool::LoopPool::onMessage(const TcpConnectionPtr &conn, Buffer *buf,
+                                       Timestamp receiveTime) {
+    auto it = connections_.find(conn->id());
+    if (it == connections_.end() || it->second.idle || !messageCallback_) {
+        // 空闲连接上不该有数据，说明协议已经错位，连接不能再用
+        LOG_ERROR("UpstreamPool[%s] unexpected %lu bytes on idle connection %s\n",
+                  namePrefix_->c_str(), static_cast<unsigned long>(buf->readableBytes()),
+                  conn->name().c_str());
+        buf->retrieveAll();
+        closeConnection(conn);
+        return;
+    }
+    messageCallback_(conn, buf, receiveTime);
+}
+
+void UpstreamPool::LoopPool::waiterTimeout(uint64_t id) {
+    for (auto it = waiters_.begin(); it != waiters_.end(); ++it) {
+        if (it->id == id) {
+            CheckoutCallback cb = it->cb;
+            waiters_.erase(it);
+            LOG_ERROR("UpstreamPool[%s] checkout timeout\n", namePrefix_->c_str());
+            cb(TcpConnectionPtr());
+            return;
+        }
+    }
+}
+
+void UpstreamPool::LoopPool::failWaiters() {
+    std::deque<Waiter> waiters;
+    waiters.swap(waiters_);
+    for (const Waiter &waiter : waiters) {
+        loop_->cancel(waiter.timer);
+        waiter.cb(TcpConnectionPtr());
+    }
+}
+
+void UpstreamPool::LoopPool::healthCheck() {
+    Timestamp now = Timestamp::cachedNow();
+    std::vector<TcpConnectionPtr> bad;
+    // idle_ 前面的连接闲置最久
+    size_t extra = idle_.size() > options_.minIdle ? idle_.size() - options_.minIdle : 0;
+    for (size_t i = 0; i < idle_.size(); ++i) {
+        Entry &entry = connections_[idle_[i]];
+        if (i < extra && options_.idleTimeout > 0.0 &&
+            timeDifference(now, entry.idleSince) > options_.idleTimeout) {
+            bad.push_back(entry.conn);
+        } else if (!entry.conn->connected() ||
+                   (healthCheckCallback_ && !healthCheckCallback_(entry.conn))) {
+            bad.push_back(entry.conn);
+        }
+    }
+    for (const TcpConnectionPtr &conn : bad) {
+        closeConnection(conn);
+    }
+    fill();
+}
+
+void UpstreamPool::LoopPool::updateStats() {
+    numIdle_.store(idle_.size(), std::memory_order_relaxed);
+    numConnections_.store(connections_.size(), std::memory_order_relaxed);
+}
+
+UpstreamPool::UpstreamPool(const InetAddress &serverAddr, const std::string &name,
+                           const Options &options)
+    : serverAddr_(serverAddr)
+    , name_(name)
+    , options_(options)
+    , slots_(new Slot[kMaxLoops])
+    , numSlots_(0)
+    , nextPoolId_(0)
+{
+}
+
+UpstreamPool::~UpstreamPool() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    int n = numSlots_.load(std::memory_order_relaxed);
+    for (int i = 0; i < n; ++i) {
+        LoopPoolPtr pool = slots_[i].owner;
+        if (pool) {
+            pool->loop()->runInLoop([pool]() { pool->closeInLoop(); });
+        }
+    }
+}
+
+void UpstreamPool::addLoop(EventLoop *loop) {
+    LoopPoolPtr pool;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (poolOf(loop)) {
+            return;
+        }
+        int n = numSlots_.load(std::memory_order_relaxed);
+        int index = 0;
+        while (index < n && slots_[index].loop.load(std::memory_order_relaxed) != nullptr) {
+            ++index;
+        }
+        if (index >= kMaxLoops) {
+            LOG_FATAL("%s:%s:%d too many loops for UpstreamPool\n", __FILE__, __FUNCTION__, __LINE__);
+        }
+        pool = std::make_shared<LoopPool>(loop, *this, nextPoolId_++);
+        Slot &slot = slots_[index];
+        slot.pool = pool.get();
+        slot.owner = pool;
+        // 先填好再发布 loop 和槽位数，poolOf 看到的子池都是完整的
+        slot.loop.store(loop, std::memory_order_release);
+        if (index == n) {
+            numSlots_.store(n + 1, std::memory_order_release);
+        }
+    }
+    loop->runInLoop([pool]() { pool->startInLoop(); });
+}
+
+void UpstreamPool::removeLoop(EventLoop *loop) {
+    LoopPoolPtr pool;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        int n = numSlots_.load(std::memory_order_relaxed);
+        for (int i = 0; i < n; ++i) {
+            Slot &slot = slots_[i];
+            if (slot.loop.load(std::memory_order_relaxed) == loop) {
+                slot.loop.store(nullptr, std::memory_order_release);
+                slot.pool = nullptr;
+                pool.swap(slot.owner);
+                break;
+            }
+        }
+    }
+    if (pool) {
+        // 连接的回调只持有子池的 weak_ptr，关闭后随最后一个引用释放
+        loop->runInLoop([pool]() { pool->closeInLoop(); });
+    }
+}
+
+UpstreamPool::LoopPool* UpstreamPool::poolOf(EventLoop *loop) const {
+    int n = numSlots_.load(std::memory_order_acquire);
+    for (int i = 0; i < n; ++i) {
+        if (slots_[i].loop.load(std::memory_order_acquire) == loop) {
+            return slots_[i].pool;
+        }
+    }
+    return nullptr;
+}
+
+void UpstreamPool::checkout(EventLoop *loop, const CheckoutCallback &cb) {
+    LoopPool *pool = poolOf(loop);
+    if (pool == nullptr) {
+        LOG_ERROR("UpstreamPool[%s] checkout on unknown loop %p\n", name_.c_str(), loop);
+        cb(TcpConnectionPtr());
+        return;
+    }
+    pool->checkout(cb);
+}
+
+void UpstreamPool::checkin(const TcpConnectionPtr &conn, bool reusable) {
+    LoopPool *pool = poolOf(conn->getLoop());
+    if (pool) {
+        pool->checkin(conn, reusable);
+    }
+}
+
+size_t UpstreamPool::numIdle() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    int n = numSlots_.load(std::memory_order_relaxed);
+    size_t total = 0;
+    for (int i = 0; i < n; ++i) {
+        if (slots_[i].owner) {
+            total += slots_[i].owner->numIdle();
+        }
+    }
+    return total;
+}
+
+size_t UpstreamPool::numConnections() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    int n = numSlots_.load(std::memory_order_relaxed);
+    size_t total = 0;
+    for (int i = 0; i < n; ++i) {
+        if (slots_[i].owner) {
+            total += slots_[i].owner->numConnections();
+        }
+    }
+    return total;
+}
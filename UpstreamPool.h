@@ -0,0 +1,112 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "Callbacks.h"
+#include "InetAddress.h"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+
+class EventLoop;
+
+// 到同一个后端的连接池。每个 loop 一个子池，连接只在所属 loop 中借出和归还：
+// 请求和它使用的后端连接总在同一个线程里处理，不加锁，也没有跨线程唤醒。
+// 子池预热 minIdle 个连接并保持长连接；空闲连接收到数据或被对端关闭时直接丢弃，
+// 定期关闭闲置过久的连接、调用 HealthCheckCallback 检查空闲连接并补足 minIdle。
+// 后端连不上时子池标记为不可用，checkout 立即失败，Connector 继续退避重连。
+//
+//   UpstreamPool pool(backendAddr, "backend", options);
+//   pool.setMessageCallback(onBackendMessage);
+//   server.setThreadInitCallback([&](EventLoop *loop) { pool.addLoop(loop); });
+//   server.setLoopRetireCallback([&](EventLoop *loop) { pool.removeLoop(loop); });
+//   // 在某个 subloop 的回调里
+//   pool.checkout(conn->getLoop(), [](const TcpConnectionPtr &upstream) { ... });
+//   // 响应处理完后
+//   pool.checkin(upstream);
+class UpstreamPool : noncopyable {
+public:
+    struct Options {
+        Options()
+            : minIdle(2)
+            , maxConnections(64)
+            , idleTimeout(60.0)
+            , healthCheckInterval(5.0)
+            , connectTimeout(3.0)
+            , checkoutTimeout(1.0)
+        {}
+        size_t minIdle;             // 每个 loop 预热并保持的空闲连接数
+        size_t maxConnections;      // 每个 loop 的连接数上限，含借出的和正在建立的
+        double idleTimeout;         // 超出 minIdle 的空闲连接闲置多久后关闭，单位秒，0 表示不关闭
+        double healthCheckInterval; // 健康检查周期，单位秒，0 表示不检查
+        double connectTimeout;      // 单次 connect 的超时，单位秒
+        double checkoutTimeout;     // 没有空闲连接时等待的最长时间，单位秒
+    };
+
+    // 借到的连接，失败（超时、后端不可用）时为 nullptr；在 loop 线程中调用
+    using CheckoutCallback = std::function<void(const TcpConnectionPtr&)>;
+    // 检查一个空闲连接，返回 false 时连接池关闭它
+    using HealthCheckCallback = std::function<bool(const TcpConnectionPtr&)>;
+
+    // 同时存在的 loop 数上限，removeLoop 释放的槽位可以重用
+    static const int kMaxLoops = 256;
+
+    UpstreamPool(const InetAddress &serverAddr, const std::string &name,
+                 const Options &options = Options());
+    ~UpstreamPool();
+
+    // 回调需在 addLoop 之前设置
+    // 借出的连接收到的数据
+    void setMessageCallback(const MessageCallback &cb) { messageCallback_ = cb; }
+    // 连接池中的连接建立和断开，借出的连接断开时应用据此让进行中的请求失败
+    void setConnectionCallback(const ConnectionCallback &cb) { connectionCallback_ = cb; }
+    void setHealthCheckCallback(const HealthCheckCallback &cb) { healthCheckCallback_ = cb; }
+
+    // 为 loop 建立子池并开始预热，可跨线程调用，通常放在 TcpServer 的 ThreadInitCallback 里
+    void addLoop(EventLoop *loop);
+    // loop 退出前关闭它的子池并释放槽位，在 loop 线程中调用，
+    // 通常放在 TcpServer 的 LoopRetireCallback 里。之后在这个 loop 上 checkout 会失败
+    void removeLoop(EventLoop *loop);
+
+    // 借出一个属于 loop 的连接，应在 loop 线程中调用
+    void checkout(EventLoop *loop, const CheckoutCallback &cb);
+    // 在连接所属 loop 线程中归还，reusable 为 false 时关闭连接（例如响应没有读完）
+    void checkin(const TcpConnectionPtr &conn, bool reusable = true);
+
+    // 所有子池的连接数，可跨线程读取，会加锁
+    size_t numIdle() const;
+    size_t numConnections() const;
+
+    const InetAddress& serverAddress() const { return serverAddr_; }
+    const std::string& name() const { return name_; }
+
+private:
+    class LoopPool;
+    using LoopPoolPtr = std::shared_ptr<LoopPool>;
+
+    // 每个 loop 一个槽位。loop 为 nullptr 表示空闲，槽位只在持 mutex_ 时分配和释放；
+    // checkout/checkin 只在自己的 loop 线程中找自己的槽，不加锁：
+    // 先写 pool 再发布 loop，其他线程的槽被重新分配时不会读到它的 pool
+    struct Slot {
+        Slot() : loop(nullptr), pool(nullptr) {}
+        std::atomic<EventLoop*> loop;
+        LoopPool *pool;
+        LoopPoolPtr owner; // 只在持 mutex_ 时访问
+    };
+
+    LoopPool* poolOf(EventLoop *loop) const;
+
+    const InetAddress serverAddr_;
+    const std::string name_;
+    const Options options_;
+    MessageCallback messageCallback_;
+    ConnectionCallback connectionCallback_;
+    HealthCheckCallback healthCheckCallback_;
+
+    mutable std::mutex mutex_; // 串行化 addLoop/removeLoop
+    std::unique_ptr<Slot[]> slots_;
+    std::atomic_int numSlots_; // 用过的槽位数，只增不减
+    int nextPoolId_;           // 子池编号，用在连接名里，只在持 mutex_ 时访问
+};
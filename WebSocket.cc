@@ -0,0 +1,232 @@
+#include "WebSocket.h"
+#include "Buffer.h"
+#include "EventLoop.h"
+#include "TcpConnection.h"
+
+#include <string.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+const char kWebSocketGuid[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+uint32_t rotl(uint32_t x, int n) {
+    return (x << n) | (x >> (32 - n));
+}
+
+// 只用于握手，一个连接算一次，不追求速度
+void sha1(const char *data, size_t len, unsigned char digest[20]) {
+    uint32_t h[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+    std::string msg(data, len);
+    msg += static_cast<char>(0x80);
+    while (msg.size() % 64 != 56) {
+        msg += '\0';
+    }
+    uint64_t bits = static_cast<uint64_t>(len) * 8;
+    for (int i = 7; i >= 0; --i) {
+        msg += static_cast<char>((bits >> (i * 8)) & 0xFF);
+    }
+
+    for (size_t chunk = 0; chunk < msg.size(); chunk += 64) {
+        uint32_t w[80];
+        const unsigned char *p = reinterpret_cast<const unsigned char*>(msg.data() + chunk);
+        for (int i = 0; i < 16; ++i) {
+            w[i] = (uint32_t(p[i * 4]) << 24) | (uint32_t(p[i * 4 + 1]) << 16) |
+                   (uint32_t(p[i * 4 + 2]) << 8) | uint32_t(p[i * 4 + 3]);
+        }
+        for (int i = 16; i < 80; ++i) {
+            w[i] = rotl(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+        }
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (int i = 0; i < 80; ++i) {
+            uint32_t f, k;
+            if (i < 20) {
+                f = (b & c) | (~b & d);
+                k = 0x5A827999;
+            } else if (i < 40) {
+                f = b ^ c ^ d;
+                k = 0x6ED9EBA1;
+            } else if (i < 60) {
+                f = (b & c) | (b & d) | (c & d);
+                k = 0x8F1BBCDC;
+            } else {
+                f = b ^ c ^ d;
+                k = 0xCA62C1D6;
+            }
+            uint32_t temp = rotl(a, 5) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = rotl(b, 30);
+            b = a;
+            a = temp;
+        }
+        h[0] += a;
+        h[1] += b;
+        h[2] += c;
+        h[3] += d;
+        h[4] += e;
+    }
+    for (int i = 0; i < 5; ++i) {
+        digest[i * 4] = static_cast<unsigned char>(h[i] >> 24);
+        digest[i * 4 + 1] = static_cast<unsigned char>(h[i] >> 16);
+        digest[i * 4 + 2] = static_cast<unsigned char>(h[i] >> 8);
+        digest[i * 4 + 3] = static_cast<unsigned char>(h[i]);
+    }
+}
+
+std::string base64(const unsigned char *data, size_t len) {
+    static const char kTable[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    out.reserve((len + 2) / 3 * 4);
+    for (size_t i = 0; i < len; i += 3) {
+        uint32_t n = uint32_t(data[i]) << 16;
+        if (i + 1 < len) {
+            n |= uint32_t(data[i + 1]) << 8;
+        }
+        if (i + 2 < len) {
+            n |= data[i + 2];
+        }
+        out += kTable[(n >> 18) & 63];
+        out += kTable[(n >> 12) & 63];
+        out += i + 1 < len ? kTable[(n >> 6) & 63] : '=';
+        out += i + 2 < len ? kTable[n & 63] : '=';
+    }
+    return out;
+}
+
+// 8 字节一组异或，剩下的逐字节；from 必须是 4 的倍数，掩码才能对齐
+void unmaskScalar(char *data, size_t from, size_t len, const char mask[4]) {
+    uint32_t m32;
+    memcpy(&m32, mask, 4);
+    uint64_t m64 = (static_cast<uint64_t>(m32) << 32) | m32;
+    size_t i = from;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t v;
+        memcpy(&v, data + i, 8);
+        v ^= m64;
+        memcpy(data + i, &v, 8);
+    }
+    for (; i < len; ++i) {
+        data[i] ^= mask[i & 3];
+    }
+}
+
+#if defined(__x86_64__)
+// SSE2 是 x86-64 的基线，总是可用
+void unmaskSse2(char *data, size_t len, const char mask[4]) {
+    int32_t m32;
+    memcpy(&m32, mask, 4);
+    const __m128i m = _mm_set1_epi32(m32);
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(data + i), _mm_xor_si128(v, m));
+    }
+    unmaskScalar(data, i, len, mask);
+}
+
+// 编译时不要求 -mavx2，运行时检测到 CPU 支持才使用
+__attribute__((target("avx2")))
+void unmaskAvx2(char *data, size_t len, const char mask[4]) {
+    int32_t m32;
+    memcpy(&m32, mask, 4);
+    const __m256i m = _mm256_set1_epi32(m32);
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(data + i), _mm256_xor_si256(v, m));
+    }
+    unmaskScalar(data, i, len, mask);
+}
+#endif
+
+using UnmaskFunc = void (*)(char*, size_t, const char*);
+
+UnmaskFunc selectUnmask() {
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return unmaskAvx2;
+    }
+    return unmaskSse2;
+#else
+    return [](char *data, size_t len, const char *mask) { unmaskScalar(data, 0, len, mask); };
+#endif
+}
+
+const UnmaskFunc kUnmask = selectUnmask();
+
+} // namespace
+
+std::string WebSocket::acceptKey(const StringPiece &key) {
+    std::string input(key.data(), key.size());
+    input += kWebSocketGuid;
+    unsigned char digest[20];
+    sha1(input.data(), input.size(), digest);
+    return base64(digest, sizeof digest);
+}
+
+size_t WebSocket::encodeHeader(char *out, Opcode opcode, size_t payloadLength, bool fin) {
+    out[0] = static_cast<char>((fin ? 0x80 : 0) | opcode);
+    if (payloadLength < 126) {
+        out[1] = static_cast<char>(payloadLength);
+        return 2;
+    } else if (payloadLength <= 0xFFFF) {
+        out[1] = 126;
+        out[2] = static_cast<char>(payloadLength >> 8);
+        out[3] = static_cast<char>(payloadLength);
+        return 4;
+    }
+    out[1] = 127;
+    for (int i = 0; i < 8; ++i) {
+        out[2 + i] = static_cast<char>(static_cast<uint64_t>(payloadLength) >> ((7 - i) * 8));
+    }
+    return 10;
+}
+
+void WebSocket::unmask(char *data, size_t len, const char mask[4]) {
+    kUnmask(data, len, mask);
+}
+
+void WebSocket::send(const TcpConnectionPtr &conn, Opcode opcode, const StringPiece &payload) {
+    if (conn->getLoop()->isInLoopThread()) {
+        Buffer *out = conn->outputBuffer();
+        out->ensureWriteableBytes(kMaxHeaderSize + payload.size());
+        size_t n = encodeHeader(out->beginWrite(), opcode, payload.size());
+        memcpy(out->beginWrite() + n, payload.data(), payload.size());
+        out->hasWritten(n + payload.size());
+        conn->sendOutputBuffer();
+    } else {
+        conn->send(*makeFrame(opcode, payload));
+    }
+}
+
+void WebSocket::send(const TcpConnectionPtr &conn, Opcode opcode, Buffer *payload) {
+    char header[kMaxHeaderSize];
+    size_t n = encodeHeader(header, opcode, payload->readableBytes());
+    if (payload->prependableBytes() < n) {
+        send(conn, opcode, StringPiece(payload->peek(), payload->readableBytes()));
+        payload->retrieveAll();
+        return;
+    }
+    payload->prepend(header, n);
+    conn->send(payload);
+    // 连接已经不在 kConnected 状态时 send 什么也不做，同样丢弃帧头和负载
+    payload->retrieveAll();
+}
+
+WebSocket::FramePtr WebSocket::makeFrame(Opcode opcode, const StringPiece &payload) {
+    std::shared_ptr<std::string> frame = std::make_shared<std::string>();
+    frame->resize(kMaxHeaderSize + payload.size());
+    size_t n = encodeHeader(&(*frame)[0], opcode, payload.size());
+    memcpy(&(*frame)[n], payload.data(), payload.size());
+    frame->resize(n + payload.size());
+    return frame;
+}
+
+void WebSocket::sendFrame(const TcpConnectionPtr &conn, const FramePtr &frame) {
+    conn->send(frame);
+}
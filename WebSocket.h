@@ -0,0 +1,73 @@
+#pragma once
+
+#include "Callbacks.h"
+#include "StringPiece.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <string>
+
+class Buffer;
+
+// WebSocket（RFC 6455）协议相关的工具：握手、帧头编码、去掩码和服务端发送。
+// 服务端发出的帧不加掩码；握手、收帧和关闭见 WebSocketServer。
+class WebSocket {
+public:
+    enum Opcode {
+        kContinuation = 0x0,
+        kText = 0x1,
+        kBinary = 0x2,
+        kClose = 0x8,
+        kPing = 0x9,
+        kPong = 0xA,
+    };
+
+    enum CloseCode {
+        kNormalClosure = 1000,
+        kGoingAway = 1001,
+        kProtocolError = 1002,
+        kUnsupportedData = 1003,
+        kMessageTooBig = 1009,
+        kInternalError = 1011,
+    };
+
+    // 预先编码好的完整帧（帧头 + 负载），广播时编码一次，发给所有连接
+    using FramePtr = std::shared_ptr<const std::string>;
+
+    // 最长的服务端帧头：2 字节 + 8 字节扩展长度
+    static const size_t kMaxHeaderSize = 10;
+
+    // 握手响应中的 Sec-WebSocket-Accept：base64(SHA1(key + GUID))
+    static std::string acceptKey(const StringPiece &key);
+
+    // 对端可以在 Close 帧中发送的状态码（RFC 6455 7.4）：1004/1005/1006/1015 保留，
+    // 1000 以下和 1016-2999 未定义，3000-4999 留给库和应用
+    static bool isValidCloseCode(uint16_t code) {
+        return (code >= 1000 && code <= 1003) || (code >= 1007 && code <= 1014) ||
+               (code >= 3000 && code <= 4999);
+    }
+
+    // 把不带掩码的帧头写到 out，返回帧头长度
+    static size_t encodeHeader(char *out, Opcode opcode, size_t payloadLength, bool fin = true);
+
+    // 原地去掩码，mask 是帧中的 4 字节掩码键。
+    // 按 CPU 支持的指令集一次处理 32/16/8 字节，剩下的逐字节处理
+    static void unmask(char *data, size_t len, const char mask[4]);
+
+    // 发送一个完整的帧。在连接所属的 loop 线程中调用时，帧头和负载直接编码进 outputBuffer，
+    // 否则先编码成字符串再跨线程发送
+    static void send(const TcpConnectionPtr &conn, Opcode opcode, const StringPiece &payload);
+    static void sendText(const TcpConnectionPtr &conn, const StringPiece &text) {
+        send(conn, kText, text);
+    }
+    static void sendBinary(const TcpConnectionPtr &conn, const StringPiece &data) {
+        send(conn, kBinary, data);
+    }
+    // payload 已经在 Buffer 中：帧头写进它的前置区域，负载不搬动，发送后 payload 被清空
+    static void send(const TcpConnectionPtr &conn, Opcode opcode, Buffer *payload);
+
+    static FramePtr makeFrame(Opcode opcode, const StringPiece &payload);
+    // 可跨线程调用，不复制帧数据
+    static void sendFrame(const TcpConnectionPtr &conn, const FramePtr &frame);
+};
@@ -0,0 +1,272 @@
+#include "WebSocketServer.h"
+#include "HttpContext.h"
+#include "HttpRequest.h"
+#include "HttpResponse.h"
+#include "Logger.h"
+
+#include <string.h>
+
+namespace {
+
+// 挂在 TcpConnection 上的连接状态，只在 loop 线程中访问
+struct WebSocketSession {
+    WebSocketSession()
+        : handshake(new HttpContext(8 * 1024, 0))
+        , closing(false)
+        , inMessage(false)
+        , opcode(WebSocket::kText)
+        , messageBegin(0)
+        , messageEnd(0)
+        , parsePos(0)
+    {}
+
+    // 握手完成后释放，长连接不再为它占用内存
+    std::unique_ptr<HttpContext> handshake;
+    bool closing; // 已经发出关闭帧
+    // 正在拼接的分片消息，位置都相对 Buffer::peek()
+    bool inMessage;
+    WebSocket::Opcode opcode;
+    size_t messageBegin;
+    size_t messageEnd;
+    size_t parsePos; // 下一个帧头的位置
+};
+
+WebSocketSession* sessionOf(const TcpConnectionPtr &conn) {
+    return static_cast<WebSocketSession*>(conn->getContext().get());
+}
+
+void rejectHandshake(const TcpConnectionPtr &conn, HttpResponse::StatusCode code) {
+    HttpResponse response(true);
+    response.setStatusCode(code);
+    if (code == HttpResponse::k400BadRequest) {
+        response.addHeader("Sec-WebSocket-Version", "13");
+    }
+    std::string output;
+    response.appendToString(&output, StringPiece(), false);
+    conn->send(output);
+    conn->shutdown();
+}
+
+} // namespace
+
+WebSocketServer::WebSocketServer(EventLoop *loop, const InetAddress &listenAddr, const std::string &name)
+    : server_(loop, listenAddr, name)
+    , connectionCallback_([](const TcpConnectionPtr&) {})
+    , messageCallback_([](const TcpConnectionPtr&, WebSocket::Opcode, const StringPiece&, Timestamp) {})
+    , maxMessageSize_(1024 * 1024)
+{
+    server_.setConnectionCallback(std::bind(&WebSocketServer::onConnection, this, std::placeholders::_1));
+    server_.setMessageCallback(std::bind(&WebSocketServer::onMessage, this, std::placeholders::_1,
+                                         std::placeholders::_2, std::placeholders::_3));
+}
+
+void WebSocketServer::onConnection(const TcpConnectionPtr &conn) {
+    if (conn->connected()) {
+        conn->setContext(std::make_shared<WebSocketSession>());
+    } else {
+        WebSocketSession *session = sessionOf(conn);
+        if (session && !session->handshake) {
+            connectionCallback_(conn);
+        }
+    }
+}
+
+void WebSocketServer::onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp receiveTime) {
+    WebSocketSession *session = sessionOf(conn);
+    if (session->handshake && !handleHandshake(conn, buf, receiveTime)) {
+        return;
+    }
+    if (!session->handshake) {
+        handleFrames(conn, buf, receiveTime);
+    }
+}
+
+bool WebSocketServer::handleHandshake(const TcpConnectionPtr &conn, Buffer *buf, Timestamp receiveTime) {
+    WebSocketSession *session = sessionOf(conn);
+    HttpContext *context = session->handshake.get();
+    if (context->closing()) {
+        buf->retrieveAll();
+        return false;
+    }
+    HttpContext::ParseResult result = context->parse(buf, receiveTime);
+    if (result == HttpContext::kNeedMore) {
+        return true;
+    }
+    if (result == HttpContext::kError) {
+        context->setClosing();
+        buf->retrieveAll();
+        rejectHandshake(conn, context->errorCode());
+        return false;
+    }
+
+    const HttpRequest &request = context->request();
+    StringPiece key = request.header("Sec-WebSocket-Key");
+    if (request.method() != HttpRequest::kGet || request.version() != HttpRequest::kHttp11 ||
+        !request.headerHasToken("Upgrade", "websocket") ||
+        !request.headerHasToken("Connection", "Upgrade") ||
+        request.header("Sec-WebSocket-Version") != "13" || key.size() != 24) {
+        context->setClosing();
+        buf->retrieveAll();
+        rejectHandshake(conn, HttpResponse::k400BadRequest);
+        return false;
+    }
+    if (upgradeCallback_ && !upgradeCallback_(conn, request)) {
+        context->setClosing();
+        buf->retrieveAll();
+        rejectHandshake(conn, HttpResponse::k403Forbidden);
+        return false;
+    }
+
+    std::string response("HTTP/1.1 101 Switching Protocols\r\n"
+                         "Upgrade: websocket\r\n"
+                         "Connection: Upgrade\r\n"
+                         "Sec-WebSocket-Accept: ");
+    response += WebSocket::acceptKey(key);
+    response += "\r\n\r\n";
+    conn->outputBuffer()->append(response.data(), response.size());
+    conn->sendOutputBuffer();
+
+    // 握手请求之后的数据已经是帧了
+    buf->retrieve(context->requestBytes());
+    session->handshake.reset();
+    connectionCallback_(conn);
+    return true;
+}
+
+void WebSocketServer::handleFrames(const TcpConnectionPtr &conn, Buffer *buf, Timestamp receiveTime) {
+    WebSocketSession *session = sessionOf(conn);
+    while (!session->closing) {
+        char *base = buf->mutablePeek();
+        const size_t readable = buf->readableBytes();
+        const size_t pos = session->parsePos;
+        if (readable - pos < 2) {
+            break;
+        }
+        const unsigned char *header = reinterpret_cast<const unsigned char*>(base + pos);
+        const bool fin = header[0] & 0x80;
+        const WebSocket::Opcode opcode = static_cast<WebSocket::Opcode>(header[0] & 0x0F);
+        const bool control = opcode & 0x8;
+        uint64_t length = header[1] & 0x7F;
+        size_t headerLength = 2;
+        if (length == 126) {
+            if (readable - pos < 4) {
+                break;
+            }
+            length = (uint64_t(header[2]) << 8) | header[3];
+            headerLength = 4;
+        } else if (length == 127) {
+            if (readable - pos < 10) {
+                break;
+            }
+            length = 0;
+            for (int i = 0; i < 8; ++i) {
+                length = (length << 8) | header[2 + i];
+            }
+            headerLength = 10;
+        }
+
+        // 客户端帧必须带掩码；没有协商扩展，RSV 位必须为 0；控制帧不能分片，负载不超过 125
+        bool valid = (header[0] & 0x70) == 0 && (header[1] & 0x80);
+        if (control) {
+            valid = valid && fin && length <= 125 &&
+                    (opcode == WebSocket::kClose || opcode == WebSocket::kPing || opcode == WebSocket::kPong);
+        } else {
+            valid = valid && opcode <= WebSocket::kBinary &&
+                    (opcode == WebSocket::kContinuation) == session->inMessage;
+        }
+        if (!valid) {
+            closeInLoop(conn, WebSocket::kProtocolError, "protocol error");
+            break;
+        }
+        size_t messageSize = session->inMessage ? session->messageEnd - session->messageBegin : 0;
+        if (!control && length > maxMessageSize_ - messageSize) {
+            closeInLoop(conn, WebSocket::kMessageTooBig, "message too big");
+            break;
+        }
+        headerLength += 4;
+        if (readable - pos < headerLength + length) {
+            break;
+        }
+
+        char *payload = base + pos + headerLength;
+        WebSocket::unmask(payload, length, base + pos + headerLength - 4);
+        session->parsePos = pos + headerLength + length;
+
+        if (control) {
+            if (opcode == WebSocket::kPing) {
+                WebSocket::send(conn, WebSocket::kPong, StringPiece(payload, length));
+            } else if (opcode == WebSocket::kClose) {
+                if (length == 1) {
+                    closeInLoop(conn, WebSocket::kProtocolError, "protocol error");
+                } else {
+                    // 原样回复对端的状态码；保留的和未定义的状态码是协议错误
+                    uint16_t code = WebSocket::kNormalClosure;
+                    if (length >= 2) {
+                        code = static_cast<uint16_t>((uint8_t(payload[0]) << 8) | uint8_t(payload[1]));
+                    }
+                    if (WebSocket::isValidCloseCode(code)) {
+                        closeInLoop(conn, static_cast<WebSocket::CloseCode>(code), std::string());
+                    } else {
+                        closeInLoop(conn, WebSocket::kProtocolError, "invalid close code");
+                    }
+                }
+            }
+            continue;
+        }
+
+        if (!session->inMessage) {
+            session->opcode = opcode;
+            session->messageBegin = payload - base;
+            session->messageEnd = session->messageBegin + length;
+        } else {
+            // 后续分片挪到前一片的末尾，覆盖掉中间的帧头，整条消息在 Buffer 中连续
+            memmove(base + session->messageEnd, payload, length);
+            session->messageEnd += length;
+        }
+        if (!fin) {
+            session->inMessage = true;
+            continue;
+        }
+        session->inMessage = false;
+        messageCallback_(conn, session->opcode,
+                         StringPiece(base + session->messageBegin, session->messageEnd - session->messageBegin),
+                         receiveTime);
+        buf->retrieve(session->parsePos);
+        session->parsePos = 0;
+    }
+
+    if (session->closing) {
+        buf->retrieveAll();
+        session->parsePos = 0;
+        session->inMessage = false;
+    } else if (session->inMessage) {
+        // 分片消息之前的帧都已经处理完
+        buf->retrieve(session->messageBegin);
+        session->parsePos -= session->messageBegin;
+        session->messageEnd -= session->messageBegin;
+        session->messageBegin = 0;
+    } else {
+        buf->retrieve(session->parsePos);
+        session->parsePos = 0;
+    }
+}
+
+void WebSocketServer::close(const TcpConnectionPtr &conn, WebSocket::CloseCode code, const std::string &reason) {
+    conn->getLoop()->runInLoop(std::bind(&WebSocketServer::closeInLoop, conn, code, reason));
+}
+
+void WebSocketServer::closeInLoop(const TcpConnectionPtr &conn, WebSocket::CloseCode code,
+                                  const std::string &reason) {
+    WebSocketSession *session = sessionOf(conn);
+    if (session == nullptr || session->closing || !conn->connected()) {
+        return;
+    }
+    session->closing = true;
+    char payload[125];
+    payload[0] = static_cast<char>(code >> 8);
+    payload[1] = static_cast<char>(code);
+    size_t reasonLength = reason.size() < sizeof payload - 2 ? reason.size() : sizeof payload - 2;
+    memcpy(payload + 2, reason.data(), reasonLength);
+    WebSocket::send(conn, WebSocket::kClose, StringPiece(payload, 2 + reasonLength));
+    conn->shutdown();
+}
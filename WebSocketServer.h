@@ -0,0 +1,57 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "TcpServer.h"
+#include "WebSocket.h"
+
+#include <functional>
+#include <string>
+
+class HttpRequest;
+
+// 基于 TcpServer 的 WebSocket 服务端。连接先按 HTTP/1.1 完成升级握手，之后按 RFC 6455 收发帧：
+// 客户端帧在 inputBuffer_ 中原地去掩码，分片消息的后续分片原地拼到前一片后面，
+// 整条消息以指向 Buffer 的 StringPiece 交给 MessageCallback，不为每条消息分配内存。
+// Ping 自动回复 Pong，收到 Close 回复 Close 后关闭写端。不支持扩展（permessage-deflate 等）。
+class WebSocketServer : noncopyable {
+public:
+    // 握手请求到达时调用，返回 false 拒绝升级（回复 403），可以在这里检查路径和鉴权
+    using UpgradeCallback = std::function<bool(const TcpConnectionPtr&, const HttpRequest&)>;
+    // payload 指向连接的 inputBuffer_，只在回调执行期间有效
+    using MessageCallback = std::function<void(const TcpConnectionPtr&, WebSocket::Opcode opcode,
+                                               const StringPiece &payload, Timestamp receiveTime)>;
+
+    WebSocketServer(EventLoop *loop, const InetAddress &listenAddr, const std::string &name);
+
+    // 默认接受所有升级请求
+    void setUpgradeCallback(const UpgradeCallback &cb) { upgradeCallback_ = cb; }
+    // 握手完成（connected() 为 true）和已升级的连接断开时调用
+    void setConnectionCallback(const ConnectionCallback &cb) { connectionCallback_ = cb; }
+    void setMessageCallback(const MessageCallback &cb) { messageCallback_ = cb; }
+
+    void setThreadNum(int numThreads) { server_.setThreadNum(numThreads); }
+    // 一条消息（所有分片之和）的上限，超出后以 1009 关闭连接；默认 1MB
+    void setMaxMessageSize(size_t bytes) { maxMessageSize_ = bytes; }
+    TcpServer* server() { return &server_; }
+
+    void start() { server_.start(); }
+
+    // 发送关闭帧并关闭写端，之后收到的数据帧被丢弃；可跨线程调用，conn 必须来自 WebSocketServer
+    static void close(const TcpConnectionPtr &conn, WebSocket::CloseCode code,
+                      const std::string &reason = std::string());
+
+private:
+    void onConnection(const TcpConnectionPtr &conn);
+    void onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp receiveTime);
+    // 返回 false 表示握手失败，连接已经在关闭
+    bool handleHandshake(const TcpConnectionPtr &conn, Buffer *buf, Timestamp receiveTime);
+    void handleFrames(const TcpConnectionPtr &conn, Buffer *buf, Timestamp receiveTime);
+    static void closeInLoop(const TcpConnectionPtr &conn, WebSocket::CloseCode code,
+                            const std::string &reason);
+
+    TcpServer server_;
+    UpgradeCallback upgradeCallback_;
+    ConnectionCallback connectionCallback_;
+    MessageCallback messageCallback_;
+    size_t maxMessageSize_;
+};
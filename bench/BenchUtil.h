@@ -0,0 +1,79 @@
+#pragma once
+
+#include "Buffer.h"
+#include "EventLoop.h"
+#include "EventLoopThread.h"
+#include "TcpServer.h"
+
+#include <stdint.h>
+#include <sys/resource.h>
+#include <time.h>
+
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+
+// 各基准测试共用的小工具：计时、在 loop 线程中同步执行，以及进程内的 echo 服务端。
+
+// 单调时钟，纳秒
+inline int64_t nowNs() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+// 整个进程（所有线程）已用的用户态加内核态 CPU 时间，秒
+inline double cpuSeconds() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+           (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+// 在 loop 线程中执行 f 并等它完成，TcpServer/TcpClient 都在自己的 loop 线程中创建和销毁
+template <typename F>
+void runInLoopAndWait(EventLoop *loop, F f) {
+    std::promise<void> done;
+    loop->runInLoop([&]() {
+        f();
+        done.set_value();
+    });
+    done.get_future().wait();
+}
+
+// 服务端跑在单独的线程里，TcpServer 在它自己的 loop 线程中创建和销毁。
+// 默认把收到的 Buffer 整个发回去；setup 在 start() 之前于 loop 线程中调用，可以替换回调
+class EchoServer {
+public:
+    using Setup = std::function<void(TcpServer*)>;
+
+    EchoServer(const InetAddress &addr, const std::string &name, int threads,
+               TcpServer::Option option = TcpServer::kNoReusePort, const Setup &setup = Setup())
+        : loop_(thread_.startLoop())
+    {
+        runInLoopAndWait(loop_, [&]() {
+            server_.reset(new TcpServer(loop_, addr, name, option));
+            server_->setThreadNum(threads);
+            server_->setConnectionCallback([](const TcpConnectionPtr&) {});
+            server_->setMessageCallback([](const TcpConnectionPtr &conn, Buffer *buf, Timestamp) {
+                conn->send(buf);
+            });
+            if (setup) {
+                setup(server_.get());
+            }
+            server_->start();
+        });
+    }
+
+    ~EchoServer() {
+        runInLoopAndWait(loop_, [&]() { server_.reset(); });
+    }
+
+    TcpServer* server() { return server_.get(); }
+
+private:
+    EventLoopThread thread_;
+    EventLoop *loop_;
+    std::unique_ptr<TcpServer> server_;
+};
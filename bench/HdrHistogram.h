@@ -0,0 +1,171 @@
+#pragma once
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <vector>
+
+// 精简的 HDR 直方图（High Dynamic Range，与 HdrHistogram 的分桶方式相同）：
+// 在 [1, highest] 范围内按 significantDigits 位有效数字记录整数值，相对误差不超过 10^-significantDigits，
+// 每次记录只是一次下标计算和计数加一，适合在 loop 线程中对每个响应记录延迟。
+// 不是线程安全的，每个线程一个，最后用 add() 合并。
+class HdrHistogram {
+public:
+    HdrHistogram(int64_t highest, int significantDigits)
+        : highest_(highest)
+        , totalCount_(0)
+        , min_(INT64_MAX)
+        , max_(0)
+        , sum_(0)
+    {
+        int64_t largestSingleUnit = 2;
+        for (int i = 0; i < significantDigits; ++i) {
+            largestSingleUnit *= 10;
+        }
+        subBucketCountMagnitude_ = static_cast<int>(ceil(log2(static_cast<double>(largestSingleUnit))));
+        subBucketHalfCountMagnitude_ = subBucketCountMagnitude_ - 1;
+        subBucketCount_ = int64_t(1) << subBucketCountMagnitude_;
+        subBucketHalfCount_ = subBucketCount_ / 2;
+        subBucketMask_ = subBucketCount_ - 1;
+
+        int buckets = 1;
+        for (int64_t smallestUntrackable = subBucketCount_; smallestUntrackable <= highest;
+             smallestUntrackable <<= 1) {
+            ++buckets;
+        }
+        counts_.assign((buckets + 1) * subBucketHalfCount_, 0);
+    }
+
+    // 小于 1 的值按 1 记，超过 highest 的按 highest 记
+    void record(int64_t value) {
+        recordCount(value, 1);
+    }
+
+    void recordCount(int64_t value, int64_t count) {
+        if (value < 1) {
+            value = 1;
+        } else if (value > highest_) {
+            value = highest_;
+        }
+        counts_[countsIndex(value)] += count;
+        totalCount_ += count;
+        sum_ += static_cast<double>(value) * count;
+        if (value < min_) {
+            min_ = value;
+        }
+        if (value > max_) {
+            max_ = value;
+        }
+    }
+
+    // 参数相同的直方图才能合并
+    void add(const HdrHistogram &other) {
+        for (size_t i = 0; i < counts_.size() && i < other.counts_.size(); ++i) {
+            counts_[i] += other.counts_[i];
+        }
+        totalCount_ += other.totalCount_;
+        sum_ += other.sum_;
+        if (other.totalCount_ > 0) {
+            min_ = other.min_ < min_ ? other.min_ : min_;
+            max_ = other.max_ > max_ ? other.max_ : max_;
+        }
+    }
+
+    int64_t totalCount() const { return totalCount_; }
+    int64_t min() const { return totalCount_ > 0 ? min_ : 0; }
+    int64_t max() const { return max_; }
+    double mean() const { return totalCount_ > 0 ? sum_ / totalCount_ : 0; }
+
+    // percentile 取 [0, 100]，返回该分位所在桶的最大等价值，与 HdrHistogram 一致
+    int64_t valueAtPercentile(double percentile) const {
+        if (totalCount_ == 0) {
+            return 0;
+        }
+        int64_t countAtPercentile = static_cast<int64_t>(ceil(percentile / 100 * totalCount_));
+        if (countAtPercentile < 1) {
+            countAtPercentile = 1;
+        }
+        int64_t cumulative = 0;
+        for (size_t i = 0; i < counts_.size(); ++i) {
+            cumulative += counts_[i];
+            if (cumulative >= countAtPercentile) {
+                int64_t value = highestEquivalentValue(valueFromIndex(i));
+                return value < max_ ? value : max_;
+            }
+        }
+        return max_;
+    }
+
+    // 输出与 HdrHistogram outputPercentileDistribution 相同格式的分位谱，
+    // 越接近 100% 分位点越密，可以直接交给 HdrHistogram 的绘图工具。value 除以 scale 后输出
+    void printPercentiles(FILE *out, double scale, int ticksPerHalfDistance = 5) const {
+        fprintf(out, "%12s %14s %10s %14s\n\n", "Value", "Percentile", "TotalCount", "1/(1-Percentile)");
+        if (totalCount_ == 0) {
+            return;
+        }
+        double percentile = 0;
+        while (true) {
+            int64_t value = valueAtPercentile(percentile);
+            int64_t count = countAtOrBelow(value);
+            double reached = 100.0 * count / totalCount_;
+            if (count >= totalCount_) {
+                fprintf(out, "%12.3f %14.12f %10ld\n", value / scale, 1.0, static_cast<long>(count));
+                break;
+            }
+            fprintf(out, "%12.3f %14.12f %10ld %14.2f\n", value / scale, percentile / 100,
+                    static_cast<long>(count), 1 / (1 - percentile / 100));
+            double halfDistance = pow(2, floor(log2(100 / (100 - percentile))) + 1);
+            double next = percentile + 100 / (halfDistance * ticksPerHalfDistance);
+            percentile = next > reached ? next : reached;
+        }
+        fprintf(out, "#[Mean    = %12.3f, Max     = %12.3f]\n", mean() / scale, max_ / scale);
+        fprintf(out, "#[Total count    = %12ld]\n", static_cast<long>(totalCount_));
+    }
+
+private:
+    size_t countsIndex(int64_t value) const {
+        int bucket = 63 - __builtin_clzll(static_cast<uint64_t>(value | subBucketMask_)) -
+                     subBucketHalfCountMagnitude_;
+        int64_t subBucket = value >> bucket;
+        return static_cast<size_t>(((bucket + 1) << subBucketHalfCountMagnitude_) + (subBucket - subBucketHalfCount_));
+    }
+
+    int64_t valueFromIndex(size_t index) const {
+        int bucket = static_cast<int>(index >> subBucketHalfCountMagnitude_) - 1;
+        int64_t subBucket = static_cast<int64_t>(index & (subBucketHalfCount_ - 1)) + subBucketHalfCount_;
+        if (bucket < 0) {
+            subBucket -= subBucketHalfCount_;
+            bucket = 0;
+        }
+        return subBucket << bucket;
+    }
+
+    int64_t highestEquivalentValue(int64_t value) const {
+        int bucket = 63 - __builtin_clzll(static_cast<uint64_t>(value | subBucketMask_)) -
+                     subBucketHalfCountMagnitude_;
+        return value + (int64_t(1) << bucket) - 1;
+    }
+
+    int64_t countAtOrBelow(int64_t value) const {
+        size_t last = countsIndex(value < highest_ ? value : highest_);
+        int64_t count = 0;
+        for (size_t i = 0; i <= last; ++i) {
+            count += counts_[i];
+        }
+        return count;
+    }
+
+    const int64_t highest_;
+    int subBucketCountMagnitude_;
+    int subBucketHalfCountMagnitude_;
+    int64_t subBucketCount_;
+    int64_t subBucketHalfCount_;
+    int64_t subBucketMask_;
+    std::vector<int64_t> counts_;
+
+    int64_t totalCount_;
+    int64_t min_;
+    int64_t max_;
+    double sum_;
+};
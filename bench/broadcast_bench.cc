@@ -0,0 +1,240 @@
+// 广播扇出：同一条消息发给所有连接，比较逐个连接 TcpConnection::send 和 TcpServer::broadcast
+//
+// 用法：broadcast_bench [--connections=1000] [--threads=4] [--messages=200] [--size=128]
+//                       [--modes=send,broadcast]
+//   send      ：在非 loop 线程里对每个连接调用 send(shared_ptr)，每个连接一次跨线程投递
+//   broadcast ：每条消息调用一次 TcpServer::broadcast，每个 subloop 一次跨线程投递
+// 客户端是一个 epoll 线程上的 --connections 个非阻塞 socket，只统计收到的字节数。
+// 每种方式输出一行 JSON：全部送达的耗时、每秒送达的消息数，以及服务端所有 loop 执行的
+// pendingFunctors 个数和 eventfd 唤醒次数（即跨线程操作的开销）。
+
+#include "BenchUtil.h"
+#include "Buffer.h"
+#include "EventLoop.h"
+#include "EventLoopThread.h"
+#include "Logger.h"
+#include "Metrics.h"
+#include "TcpServer.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const uint16_t kPort = 17431;
+
+// 记下所有连接，供主线程逐个 send
+class FanoutServer {
+public:
+    explicit FanoutServer(int threads)
+        : server_(InetAddress(kPort), "FanoutServer", threads, TcpServer::kNoReusePort, [this](TcpServer *server) {
+              server->setConnectionCallback([this](const TcpConnectionPtr &conn) {
+                  if (conn->connected()) {
+                      std::lock_guard<std::mutex> lock(mutex_);
+                      connections_.push_back(conn);
+                  }
+              });
+          })
+    {}
+
+    ~FanoutServer() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        connections_.clear();
+    }
+
+    TcpServer* server() { return server_.server(); }
+
+    std::vector<TcpConnectionPtr> connections() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return connections_;
+    }
+
+private:
+    std::mutex mutex_;
+    std::vector<TcpConnectionPtr> connections_;
+    EchoServer server_; // 最后构造、最先析构，回调里用到的 mutex_ 一直有效
+};
+
+// 一个 epoll 线程读所有客户端 socket，只计数
+class Receivers {
+public:
+    explicit Receivers(int connections)
+        : epollFd_(::epoll_create1(EPOLL_CLOEXEC))
+        , received_(0)
+        , running_(true)
+    {
+        sockaddr_in addr;
+        memset(&addr, 0, sizeof addr);
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(kPort);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        for (int i = 0; i < connections; ++i) {
+            int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            if (::connect(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof addr) < 0) {
+                perror("connect");
+                exit(1);
+            }
+            ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+            epoll_event ev;
+            memset(&ev, 0, sizeof ev);
+            ev.events = EPOLLIN;
+            ev.data.fd = fd;
+            ::epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &ev);
+            fds_.push_back(fd);
+        }
+        thread_ = std::thread([this]() { run(); });
+    }
+
+    ~Receivers() {
+        running_ = false;
+        thread_.join();
+        for (int fd : fds_) {
+            ::close(fd);
+        }
+        ::close(epollFd_);
+    }
+
+    int64_t received() const { return received_.load(std::memory_order_relaxed); }
+
+private:
+    void run() {
+        std::vector<epoll_event> events(256);
+        char buf[65536];
+        while (running_.load(std::memory_order_relaxed)) {
+            int n = ::epoll_wait(epollFd_, events.data(), static_cast<int>(events.size()), 10);
+            int64_t got = 0;
+            for (int i = 0; i < n; ++i) {
+                ssize_t r;
+                while ((r = ::read(events[i].data.fd, buf, sizeof buf)) > 0) {
+                    got += r;
+                }
+            }
+            if (got > 0) {
+                received_.fetch_add(got, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    int epollFd_;
+    std::vector<int> fds_;
+    std::atomic<int64_t> received_;
+    std::atomic_bool running_;
+    std::thread thread_;
+};
+
+struct LoopCounters {
+    int64_t functors;
+    int64_t wakeups;
+};
+
+LoopCounters sampleLoops() {
+    LoopCounters c = { 0, 0 };
+    MetricsRegistry::instance().forEachLoop([&](EventLoop *loop) {
+        c.functors += loop->metrics().functors.value();
+        c.wakeups += loop->metrics().wakeups.value();
+    });
+    return c;
+}
+
+std::vector<std::string> split(const char *s) {
+    std::vector<std::string> parts;
+    while (*s) {
+        const char *comma = strchr(s, ',');
+        parts.push_back(comma ? std::string(s, comma) : std::string(s));
+        if (comma == nullptr) {
+            break;
+        }
+        s = comma + 1;
+    }
+    return parts;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    int connections = 1000;
+    int threads = 4;
+    int messages = 200;
+    size_t size = 128;
+    std::vector<std::string> modes = { "send", "broadcast" };
+    for (int i = 1; i < argc; ++i) {
+        const char *arg = argv[i];
+        const char *value = strchr(arg, '=');
+        value = value ? value + 1 : "";
+        if (strncmp(arg, "--connections=", 14) == 0) {
+            connections = atoi(value);
+        } else if (strncmp(arg, "--threads=", 10) == 0) {
+            threads = atoi(value);
+        } else if (strncmp(arg, "--messages=", 11) == 0) {
+            messages = atoi(value);
+        } else if (strncmp(arg, "--size=", 7) == 0) {
+            size = static_cast<size_t>(atoi(value));
+        } else if (strncmp(arg, "--modes=", 8) == 0) {
+            modes = split(value);
+        } else {
+            fprintf(stderr, "usage: %s [--connections=1000] [--threads=4] [--messages=200] [--size=128]\n"
+                            "       [--modes=send,broadcast]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (size < 1) {
+        size = 1;
+    }
+    Logger::setLogThreshold(ERROR);
+
+    FanoutServer server(threads);
+    Receivers receivers(connections);
+    while (static_cast<int>(server.connections().size()) < connections) {
+        ::usleep(1000);
+    }
+    const std::vector<TcpConnectionPtr> conns = server.connections();
+    const std::shared_ptr<const std::string> message = std::make_shared<const std::string>(size, 'x');
+
+    for (const std::string &mode : modes) {
+        const bool broadcast = mode == "broadcast";
+        const int64_t expected = receivers.received() + static_cast<int64_t>(connections) * messages * size;
+        const LoopCounters before = sampleLoops();
+        const int64_t start = nowNs();
+        for (int m = 0; m < messages; ++m) {
+            if (broadcast) {
+                server.server()->broadcast(message);
+            } else {
+                for (const TcpConnectionPtr &conn : conns) {
+                    conn->send(message);
+                }
+            }
+        }
+        const int64_t posted = nowNs();
+        const int64_t deadline = posted + 30LL * 1000 * 1000 * 1000;
+        while (receivers.received() < expected && nowNs() < deadline) {
+            ::usleep(100);
+        }
+        const int64_t end = nowNs();
+        const LoopCounters after = sampleLoops();
+        const double seconds = (end - start) / 1e9;
+        printf("{\"bench\":\"broadcast\",\"mode\":\"%s\",\"connections\":%d,\"server_threads\":%d,"
+               "\"messages\":%d,\"size\":%zu,\"complete\":%s,\"post_ms\":%.2f,\"total_ms\":%.2f,"
+               "\"deliveries_per_sec\":%.0f,\"functors\":%ld,\"wakeups\":%ld}\n",
+               mode.c_str(), connections, threads, messages, size,
+               receivers.received() >= expected ? "true" : "false", (posted - start) / 1e6, seconds * 1e3,
+               static_cast<double>(connections) * messages / seconds,
+               static_cast<long>(after.functors - before.functors),
+               static_cast<long>(after.wakeups - before.wakeups));
+        fflush(stdout);
+    }
+    return 0;
+}
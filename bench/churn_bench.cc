@@ -0,0 +1,241 @@
+// 短连接压测：每个连接建立、交换一条消息、关闭，统计每秒完成的连接数和各阶段延迟
+//
+// 用法：churn_bench [--seconds=2] [--clients=4] [--threads=0,1,2,4] [--options=noreuseport,reuseport]
+//                   [--size=64] [--log-info]
+// 客户端是 --clients 个阻塞 socket 线程，各自不停地循环：
+//   connect  ：connect() 返回（三次握手完成，连接进入服务端的 accept 队列）
+//   exchange ：发出消息到收到 echo，包括服务端 accept、newConnection 分配 subloop、
+//              建立 TcpConnection 和第一次读写
+//   teardown ：shutdown(SHUT_WR) 到读到 EOF，即服务端 handleClose、在 subloop 中从本 loop 的连接表
+//              removeConnection、排队执行 connectDestroyed 到连接析构关闭 fd 的整个过程，不跨线程
+// --log-info 打开 INFO 日志并输出到空函数，计入每个连接建立和断开时的日志格式化开销。
+// 每个 TcpServer 选项和 subloop 数的组合输出一行 JSON，延迟单位是微秒。
+
+#include "BenchUtil.h"
+#include "Buffer.h"
+#include "EventLoop.h"
+#include "EventLoopThread.h"
+#include "HdrHistogram.h"
+#include "Logger.h"
+#include "TcpServer.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const int64_t kHighestLatencyUs = 10 * 1000 * 1000;
+const int kSignificantDigits = 3;
+const uint16_t kPort = 17411;
+
+// 一个客户端线程的统计，线程结束后在主线程合并
+struct ClientStats {
+    ClientStats()
+        : connect(kHighestLatencyUs, kSignificantDigits)
+        , exchange(kHighestLatencyUs, kSignificantDigits)
+        , teardown(kHighestLatencyUs, kSignificantDigits)
+        , total(kHighestLatencyUs, kSignificantDigits)
+        , completed(0)
+        , errors(0)
+    {}
+
+    void add(const ClientStats &other) {
+        connect.add(other.connect);
+        exchange.add(other.exchange);
+        teardown.add(other.teardown);
+        total.add(other.total);
+        completed += other.completed;
+        errors += other.errors;
+    }
+
+    HdrHistogram connect;
+    HdrHistogram exchange;
+    HdrHistogram teardown;
+    HdrHistogram total;
+    int64_t completed;
+    int64_t errors;
+};
+
+bool readFully(int fd, char *buf, size_t len) {
+    size_t got = 0;
+    while (got < len) {
+        ssize_t n = ::read(fd, buf + got, len - got);
+        if (n <= 0) {
+            return false;
+        }
+        got += n;
+    }
+    return true;
+}
+
+// 完成一个短连接，成功时把各阶段耗时记入 stats
+bool oneConnection(const sockaddr_in &addr, const std::string &message, ClientStats *stats) {
+    std::vector<char> reply(message.size());
+    int64_t begin = nowNs();
+    int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return false;
+    }
+    int on = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof on);
+    bool ok = false;
+    if (::connect(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof addr) == 0) {
+        int64_t connected = nowNs();
+        if (::write(fd, message.data(), message.size()) == static_cast<ssize_t>(message.size()) &&
+            readFully(fd, reply.data(), reply.size())) {
+            int64_t exchanged = nowNs();
+            ::shutdown(fd, SHUT_WR);
+            char c;
+            if (::read(fd, &c, 1) == 0) {
+                int64_t closed = nowNs();
+                stats->connect.record((connected - begin) / 1000);
+                stats->exchange.record((exchanged - connected) / 1000);
+                stats->teardown.record((closed - exchanged) / 1000);
+                stats->total.record((closed - begin) / 1000);
+                ok = true;
+            }
+        }
+    }
+    ::close(fd);
+    return ok;
+}
+
+struct Result {
+    ClientStats stats;
+    double seconds;
+};
+
+Result runOnce(int clients, double seconds, size_t size) {
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(kPort);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    const std::string message(size, 'x');
+
+    std::atomic<bool> running(true);
+    std::vector<ClientStats> stats(clients);
+    std::vector<std::thread> threads;
+    int64_t start = nowNs();
+    for (int i = 0; i < clients; ++i) {
+        threads.emplace_back([&, i]() {
+            while (running.load(std::memory_order_relaxed)) {
+                if (oneConnection(addr, message, &stats[i])) {
+                    ++stats[i].completed;
+                } else {
+                    ++stats[i].errors;
+                    // 多半是 accept 队列满或端口耗尽，稍等再试，避免空转
+                    ::usleep(1000);
+                }
+            }
+        });
+    }
+    ::usleep(static_cast<useconds_t>(seconds * 1e6));
+    running = false;
+    for (std::thread &t : threads) {
+        t.join();
+    }
+
+    Result result;
+    result.seconds = (nowNs() - start) / 1e9;
+    for (const ClientStats &s : stats) {
+        result.stats.add(s);
+    }
+    return result;
+}
+
+void printPhase(const char *name, const HdrHistogram &h) {
+    printf(",\"%s_p50_us\":%ld,\"%s_p99_us\":%ld,\"%s_p999_us\":%ld,\"%s_max_us\":%ld",
+           name, static_cast<long>(h.valueAtPercentile(50)), name, static_cast<long>(h.valueAtPercentile(99)),
+           name, static_cast<long>(h.valueAtPercentile(99.9)), name, static_cast<long>(h.max()));
+}
+
+std::vector<std::string> split(const char *s) {
+    std::vector<std::string> parts;
+    while (*s) {
+        const char *comma = strchr(s, ',');
+        parts.push_back(comma ? std::string(s, comma) : std::string(s));
+        if (comma == nullptr) {
+            break;
+        }
+        s = comma + 1;
+    }
+    return parts;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    double seconds = 2;
+    int clients = 4;
+    size_t size = 64;
+    bool logInfo = false;
+    std::vector<std::string> threads = { "0", "1", "2", "4" };
+    std::vector<std::string> options = { "noreuseport", "reuseport" };
+    for (int i = 1; i < argc; ++i) {
+        const char *arg = argv[i];
+        const char *value = strchr(arg, '=');
+        value = value ? value + 1 : "";
+        if (strncmp(arg, "--seconds=", 10) == 0) {
+            seconds = atof(value);
+        } else if (strncmp(arg, "--clients=", 10) == 0) {
+            clients = atoi(value);
+        } else if (strncmp(arg, "--threads=", 10) == 0) {
+            threads = split(value);
+        } else if (strncmp(arg, "--options=", 10) == 0) {
+            options = split(value);
+        } else if (strncmp(arg, "--size=", 7) == 0) {
+            size = static_cast<size_t>(atoi(value));
+        } else if (strcmp(arg, "--log-info") == 0) {
+            logInfo = true;
+        } else {
+            fprintf(stderr, "usage: %s [--seconds=2] [--clients=4] [--threads=0,1,2,4]\n"
+                            "       [--options=noreuseport,reuseport] [--size=64] [--log-info]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (size < 1) {
+        size = 1;
+    }
+
+    if (logInfo) {
+        Logger::setLogThreshold(INFO);
+        Logger::instance().setOutput([](const char*, size_t) {});
+    } else {
+        Logger::setLogThreshold(ERROR);
+    }
+
+    for (const std::string &optionName : options) {
+        TcpServer::Option option = optionName == "reuseport" ? TcpServer::kReusePort : TcpServer::kNoReusePort;
+        for (const std::string &threadCount : threads) {
+            int n = atoi(threadCount.c_str());
+            std::unique_ptr<EchoServer> server(new EchoServer(InetAddress(kPort), "ChurnServer", n, option));
+            Result result = runOnce(clients, seconds, size);
+            server.reset();
+            const ClientStats &s = result.stats;
+            printf("{\"bench\":\"churn\",\"option\":\"%s\",\"server_threads\":%d,\"clients\":%d,"
+                   "\"log_info\":%s,\"seconds\":%.3f,\"connections\":%ld,\"errors\":%ld,\"conns_per_sec\":%.0f",
+                   optionName.c_str(), n, clients, logInfo ? "true" : "false", result.seconds,
+                   static_cast<long>(s.completed), static_cast<long>(s.errors), s.completed / result.seconds);
+            printPhase("connect", s.connect);
+            printPhase("exchange", s.exchange);
+            printPhase("teardown", s.teardown);
+            printPhase("total", s.total);
+            printf("}\n");
+            fflush(stdout);
+        }
+    }
+    return 0;
+}
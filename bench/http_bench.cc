@@ -0,0 +1,219 @@
+// 类似 wrk 的本地 HTTP 压测：HttpServer 回复固定的小响应，客户端用 keep-alive 连接反复请求
+//
+// 用法：http_bench [--seconds=5] [--connections=32] [--depth=1] [--threads=1]
+// --threads 是服务端 subloop 数。每个连接同时有 --depth 个请求在途，收到一个响应就补发一个请求。
+// 结果是每秒请求数，以及从发出请求到收到完整响应的延迟分布。
+
+#include "Buffer.h"
+#include "EventLoop.h"
+#include "EventLoopThread.h"
+#include "HttpRequest.h"
+#include "HttpResponse.h"
+#include "HttpServer.h"
+#include "Logger.h"
+#include "TcpClient.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <deque>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+const char kRequest[] = "GET /plaintext HTTP/1.1\r\nHost: localhost\r\nUser-Agent: http_bench\r\n\r\n";
+
+// 服务端跑在单独的线程里，HttpServer 在它自己的 loop 线程中创建和销毁
+class BenchServer {
+public:
+    BenchServer(const InetAddress &addr, int threads)
+        : loop_(thread_.startLoop())
+    {
+        std::promise<void> started;
+        loop_->runInLoop([&]() {
+            server_.reset(new HttpServer(loop_, addr, "HttpBench"));
+            server_->setThreadNum(threads);
+            server_->setHttpCallback([](const HttpRequest &req, HttpResponse *resp) {
+                if (req.path() == "/plaintext") {
+                    resp->setContentType("text/plain");
+                    resp->setBody("Hello, World!");
+                } else {
+                    resp->setStatusCode(HttpResponse::k404NotFound);
+                }
+            });
+            server_->start();
+            started.set_value();
+        });
+        started.get_future().wait();
+    }
+
+    ~BenchServer() {
+        std::promise<void> stopped;
+        loop_->runInLoop([&]() {
+            server_.reset();
+            stopped.set_value();
+        });
+        stopped.get_future().wait();
+    }
+
+private:
+    EventLoopThread thread_;
+    EventLoop *loop_;
+    std::unique_ptr<HttpServer> server_;
+};
+
+// 从 buf 中取出一个完整的响应，不完整时返回 false
+bool takeResponse(Buffer *buf, int *status) {
+    const char *begin = buf->peek();
+    const char *headerEnd = static_cast<const char*>(
+        memmem(begin, buf->readableBytes(), "\r\n\r\n", 4));
+    if (headerEnd == nullptr) {
+        return false;
+    }
+    size_t contentLength = 0;
+    const char *cl = static_cast<const char*>(
+        memmem(begin, headerEnd - begin, "Content-Length: ", 16));
+    if (cl) {
+        contentLength = static_cast<size_t>(atol(cl + 16));
+    }
+    size_t total = headerEnd + 4 - begin + contentLength;
+    if (buf->readableBytes() < total) {
+        return false;
+    }
+    *status = atoi(begin + 9); // "HTTP/1.1 200"
+    buf->retrieve(total);
+    return true;
+}
+
+struct Stats {
+    Stats() : requests(0), errors(0) {}
+    int64_t requests;
+    int64_t errors;
+    std::vector<int64_t> latencies; // 微秒
+};
+
+void run(const InetAddress &addr, double seconds, int connections, int depth) {
+    EventLoop loop;
+    bool running = true;
+    bool measuring = false;
+    Stats stats;
+    std::vector<std::deque<Timestamp>> inflight(connections);
+
+    std::vector<std::unique_ptr<TcpClient>> clients;
+    for (int i = 0; i < connections; ++i) {
+        std::unique_ptr<TcpClient> client(new TcpClient(&loop, addr, "HttpBenchClient"));
+        std::deque<Timestamp> *sent = &inflight[i];
+        client->setConnectionCallback([=, &loop](const TcpConnectionPtr &conn) {
+            if (conn->connected()) {
+                // 流水线里的请求一次写出去
+                std::string batch;
+                for (int j = 0; j < depth; ++j) {
+                    batch += kRequest;
+                    sent->push_back(Timestamp::now());
+                }
+                conn->send(batch);
+            }
+        });
+        client->setMessageCallback([=, &running, &measuring, &stats](const TcpConnectionPtr &conn,
+                                                                     Buffer *buf, Timestamp) {
+            Timestamp now = Timestamp::now();
+            std::string batch;
+            int status = 0;
+            while (takeResponse(buf, &status)) {
+                if (measuring) {
+                    ++stats.requests;
+                    if (status != 200) {
+                        ++stats.errors;
+                    }
+                    stats.latencies.push_back(now - sent->front());
+                }
+                sent->pop_front();
+                if (running) {
+                    batch += kRequest;
+                    sent->push_back(now);
+                }
+            }
+            if (!batch.empty()) {
+                conn->send(batch);
+            }
+        });
+        client->connect();
+        clients.push_back(std::move(client));
+    }
+
+    // 先预热，连接全部建立之后再开始计数
+    Timestamp start;
+    loop.runAfter(0.3, [&]() {
+        measuring = true;
+        start = Timestamp::now();
+    });
+    loop.runAfter(0.3 + seconds, [&]() {
+        running = false;
+        measuring = false;
+        double elapsed = timeDifference(Timestamp::now(), start);
+        std::vector<int64_t> &lat = stats.latencies;
+        std::sort(lat.begin(), lat.end());
+        auto percentile = [&lat](double p) -> double {
+            return lat.empty() ? 0 : lat[static_cast<size_t>(p * (lat.size() - 1))];
+        };
+        double sum = 0;
+        for (int64_t l : lat) {
+            sum += l;
+        }
+        printf("%12.0f requests/s  %ld errors\n", stats.requests / elapsed,
+               static_cast<long>(stats.errors));
+        printf("latency us: avg %.1f  p50 %.0f  p90 %.0f  p99 %.0f  max %.0f\n",
+               lat.empty() ? 0 : sum / lat.size(), percentile(0.5), percentile(0.9),
+               percentile(0.99), percentile(1.0));
+        for (auto &client : clients) {
+            client->disconnect();
+        }
+        loop.runAfter(0.1, [&]() { loop.quit(); });
+    });
+    loop.loop();
+    clients.clear();
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    double seconds = 5;
+    int connections = 32;
+    int depth = 1;
+    int threads = 1;
+    bool ok = true;
+    for (int i = 1; i < argc && ok; ++i) {
+        const char *arg = argv[i];
+        const char *value = strchr(arg, '=');
+        value = value ? value + 1 : "";
+        if (strncmp(arg, "--seconds=", 10) == 0) {
+            seconds = atof(value);
+        } else if (strncmp(arg, "--connections=", 14) == 0) {
+            connections = atoi(value);
+        } else if (strncmp(arg, "--depth=", 8) == 0) {
+            depth = atoi(value);
+        } else if (strncmp(arg, "--threads=", 10) == 0) {
+            threads = atoi(value);
+        } else {
+            ok = false;
+        }
+    }
+    if (!ok || seconds <= 0 || connections < 1 || depth < 1 || threads < 0) {
+        fprintf(stderr, "usage: %s [--seconds=5] [--connections=32] [--depth=1] [--threads=1]\n", argv[0]);
+        return 1;
+    }
+
+    Logger::setLogThreshold(ERROR);
+    printf("GET /plaintext, %d connections, pipeline depth %d, %d server threads, %.1fs\n",
+           connections, depth, threads, seconds);
+
+    InetAddress addr(17381);
+    BenchServer server(addr, threads);
+    run(addr, seconds, connections, depth);
+    return 0;
+}
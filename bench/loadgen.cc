@@ -0,0 +1,324 @@
+// 开环（open-loop）延迟压测：按固定速率发送请求，不等响应，延迟从"计划发送时间"算起
+//
+// 用法：loadgen [--rate=10000] [--connections=16] [--threads=1] [--duration=10] [--warmup=2]
+//               [--size=64] [--host=IP --port=PORT | --server-threads=1]
+// 不指定 --host 时在进程内起一个 echo 服务端（--server-threads 个 subloop），否则压外部的 echo 服务。
+//
+// 闭环压测（收到响应才发下一个）在服务端变慢时会跟着少发，排队时间不计入延迟（coordinated omission），
+// 测出的 p99.9 偏低。这里每个连接按 rate / connections 的速率排好发送计划，计划时间写在消息的前 8 字节，
+// loop 线程按计划时间用定时器唤醒，把到期的消息一起发出；即使发送被 loop 拖延，延迟也从计划时间开始算。
+// 结果是合并后的 HDR 直方图分位谱（微秒）和一行 JSON 汇总。
+
+#include "BenchUtil.h"
+#include "Buffer.h"
+#include "EventLoop.h"
+#include "EventLoopThread.h"
+#include "EventLoopThreadPool.h"
+#include "HdrHistogram.h"
+#include "Logger.h"
+#include "TcpClient.h"
+#include "TcpServer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+// 直方图范围：1us ~ 60s，3 位有效数字
+const int64_t kHighestLatencyUs = 60 * 1000 * 1000;
+const int kSignificantDigits = 3;
+// 发送定时器两次触发之间的最小间隔
+const int64_t kMinWakeupGapNs = 20 * 1000;
+
+struct Options {
+    Options()
+        : rate(10000)
+        , connections(16)
+        , threads(1)
+        , duration(10)
+        , warmup(2)
+        , size(64)
+        , port(17401)
+        , serverThreads(1)
+    {}
+
+    double rate;
+    int connections;
+    int threads;
+    double duration;
+    double warmup;
+    int size;
+    std::string host;
+    uint16_t port;
+    int serverThreads;
+};
+
+// 一个压测连接，只在所属 loop 线程中访问
+struct Connection {
+    std::unique_ptr<TcpClient> client;
+    TcpConnectionPtr conn;
+    int64_t firstSendNs; // 第一个消息的计划发送时间
+    int64_t sent;        // 已发送的消息数，第 i 个消息的计划时间是 firstSendNs + i * intervalNs
+};
+
+// 每个客户端 loop 一份，记录和计数都不跨线程
+class LoopWorker {
+public:
+    LoopWorker(EventLoop *loop, const Options &options, const InetAddress &addr, int firstIndex, int count,
+               std::atomic<int> *connected)
+        : loop_(loop)
+        , options_(options)
+        , histogram_(kHighestLatencyUs, kSignificantDigits)
+        , message_(options.size, 'x')
+        , intervalNs_(static_cast<int64_t>(1e9 * options.connections / options.rate))
+        , recordFromNs_(0)
+        , stopSendNs_(0)
+        , expected_(0)
+        , received_(0)
+    {
+        runInLoopAndWait(loop_, [&]() {
+            for (int i = 0; i < count; ++i) {
+                std::shared_ptr<Connection> c = std::make_shared<Connection>();
+                connections_.push_back(c);
+                c->sent = 0;
+                // 各连接的发送时间错开，整体速率均匀
+                c->firstSendNs = intervalNs_ * (firstIndex + i) / options_.connections;
+                c->client.reset(new TcpClient(loop_, addr, "Loadgen"));
+                // 连接可能比 Connection 活得久，回调里只持有弱引用
+                std::weak_ptr<Connection> weak(c);
+                c->client->setConnectionCallback([weak, connected](const TcpConnectionPtr &conn) {
+                    std::shared_ptr<Connection> c = weak.lock();
+                    if (!c) {
+                        return;
+                    }
+                    if (conn->connected()) {
+                        c->conn = conn;
+                        ++*connected;
+                    } else {
+                        c->conn.reset();
+                    }
+                });
+                c->client->setMessageCallback(std::bind(&LoopWorker::onMessage, this, std::placeholders::_1,
+                                                        std::placeholders::_2));
+                c->client->connect();
+            }
+        });
+    }
+
+    ~LoopWorker() {
+        runInLoopAndWait(loop_, [&]() {
+            for (auto &c : connections_) {
+                c->conn.reset();
+            }
+            connections_.clear();
+        });
+    }
+
+    // 从 startNs 开始按计划发送，计划时间落在 [recordFromNs, stopSendNs) 的消息计入结果
+    void start(int64_t startNs, int64_t recordFromNs, int64_t stopSendNs) {
+        runInLoopAndWait(loop_, [&]() {
+            recordFromNs_ = recordFromNs;
+            stopSendNs_ = stopSendNs;
+            for (auto &c : connections_) {
+                c->firstSendNs += startNs;
+            }
+            sendDue();
+        });
+    }
+
+    // 停止发送和记录，把结果合并进 total
+    void collect(HdrHistogram *total, int64_t *expected, int64_t *received) {
+        runInLoopAndWait(loop_, [&]() {
+            loop_->cancel(timer_);
+            stopSendNs_ = 0;
+            recordFromNs_ = INT64_MAX;
+            total->add(histogram_);
+            *expected += expected_;
+            *received += received_;
+            for (auto &c : connections_) {
+                c->client->disconnect();
+            }
+        });
+    }
+
+private:
+    // 把计划时间已到的消息全部发出，一个连接的多个消息合成一次 send，
+    // 然后按最早的下一个计划时间设定时器。两次唤醒至少间隔 kMinWakeupGapNs，速率很高时按批发送
+    void sendDue() {
+        const int64_t now = nowNs();
+        int64_t earliest = INT64_MAX;
+        std::string batch;
+        for (auto &c : connections_) {
+            int64_t scheduled = c->firstSendNs + c->sent * intervalNs_;
+            if (!c->conn) {
+                continue;
+            }
+            batch.clear();
+            while (scheduled <= now && scheduled < stopSendNs_) {
+                size_t offset = batch.size();
+                batch += message_;
+                memcpy(&batch[offset], &scheduled, sizeof scheduled);
+                if (scheduled >= recordFromNs_) {
+                    ++expected_;
+                }
+                ++c->sent;
+                scheduled += intervalNs_;
+            }
+            if (!batch.empty()) {
+                c->conn->send(batch);
+            }
+            if (scheduled < stopSendNs_ && scheduled < earliest) {
+                earliest = scheduled;
+            }
+        }
+        if (earliest != INT64_MAX) {
+            int64_t delay = earliest - nowNs();
+            if (delay < kMinWakeupGapNs) {
+                delay = kMinWakeupGapNs;
+            }
+            timer_ = loop_->runAfter(delay / 1e9, std::bind(&LoopWorker::sendDue, this));
+        }
+    }
+
+    void onMessage(const TcpConnectionPtr&, Buffer *buf) {
+        const int64_t now = nowNs();
+        const size_t size = message_.size();
+        while (buf->readableBytes() >= size) {
+            int64_t scheduled;
+            memcpy(&scheduled, buf->peek(), sizeof scheduled);
+            if (scheduled >= recordFromNs_ && scheduled < stopSendNs_) {
+                histogram_.record((now - scheduled) / 1000);
+                ++received_;
+            }
+            buf->retrieve(size);
+        }
+    }
+
+    EventLoop *loop_;
+    const Options &options_;
+    std::vector<std::shared_ptr<Connection>> connections_;
+    HdrHistogram histogram_;
+    std::string message_;
+    const int64_t intervalNs_;
+    int64_t recordFromNs_;
+    int64_t stopSendNs_;
+    TimerId timer_;
+    int64_t expected_;
+    int64_t received_;
+};
+
+bool parseOption(const char *arg, const char *name, const char **value) {
+    size_t len = strlen(name);
+    if (strncmp(arg, name, len) == 0 && arg[len] == '=') {
+        *value = arg + len + 1;
+        return true;
+    }
+    return false;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        const char *v = nullptr;
+        if (parseOption(argv[i], "--rate", &v)) {
+            options.rate = atof(v);
+        } else if (parseOption(argv[i], "--connections", &v)) {
+            options.connections = atoi(v);
+        } else if (parseOption(argv[i], "--threads", &v)) {
+            options.threads = atoi(v);
+        } else if (parseOption(argv[i], "--duration", &v)) {
+            options.duration = atof(v);
+        } else if (parseOption(argv[i], "--warmup", &v)) {
+            options.warmup = atof(v);
+        } else if (parseOption(argv[i], "--size", &v)) {
+            options.size = atoi(v);
+        } else if (parseOption(argv[i], "--host", &v)) {
+            options.host = v;
+        } else if (parseOption(argv[i], "--port", &v)) {
+            options.port = static_cast<uint16_t>(atoi(v));
+        } else if (parseOption(argv[i], "--server-threads", &v)) {
+            options.serverThreads = atoi(v);
+        } else {
+            fprintf(stderr, "usage: %s [--rate=10000] [--connections=16] [--threads=1] [--duration=10]\n"
+                            "       [--warmup=2] [--size=64] [--host=IP --port=PORT | --server-threads=1]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+    // 消息前 8 字节放计划发送时间
+    if (options.size < 8) {
+        options.size = 8;
+    }
+    if (options.connections < 1 || options.threads < 1 || options.rate <= 0) {
+        fprintf(stderr, "connections, threads and rate must be positive\n");
+        return 1;
+    }
+
+    Logger::setLogThreshold(ERROR);
+    std::unique_ptr<EchoServer> server;
+    InetAddress addr(options.port, options.host.empty() ? "127.0.0.1" : options.host);
+    if (options.host.empty()) {
+        server.reset(new EchoServer(addr, "LoadgenEcho", options.serverThreads, TcpServer::kReusePort));
+    }
+
+    EventLoop loop;
+    EventLoopThreadPool pool(&loop, "Loadgen");
+    pool.setThreadNum(options.threads);
+    pool.start();
+
+    std::atomic<int> connected(0);
+    std::vector<std::unique_ptr<LoopWorker>> workers;
+    for (int t = 0; t < options.threads; ++t) {
+        int first = options.connections * t / options.threads;
+        int last = options.connections * (t + 1) / options.threads;
+        workers.emplace_back(new LoopWorker(pool.getNextLoop(), options, addr, first, last - first, &connected));
+    }
+
+    // 所有连接建立后开始发送
+    HdrHistogram total(kHighestLatencyUs, kSignificantDigits);
+    int64_t expected = 0;
+    int64_t received = 0;
+    TimerId waiting = loop.runEvery(0.01, [&]() {
+        if (connected.load() < options.connections) {
+            return;
+        }
+        loop.cancel(waiting);
+        const int64_t start = nowNs() + 10 * 1000 * 1000;
+        const int64_t recordFrom = start + static_cast<int64_t>(options.warmup * 1e9);
+        const int64_t stopSend = recordFrom + static_cast<int64_t>(options.duration * 1e9);
+        for (auto &worker : workers) {
+            worker->start(start, recordFrom, stopSend);
+        }
+        // 停止发送后再等 1 秒收尾，还没回来的响应算作丢失
+        double wait = (stopSend - nowNs()) / 1e9 + 1.0;
+        loop.runAfter(wait, [&]() {
+            for (auto &worker : workers) {
+                worker->collect(&total, &expected, &received);
+            }
+            loop.runAfter(0.1, [&]() { loop.quit(); });
+        });
+    });
+    loop.loop();
+    workers.clear();
+
+    printf("open-loop %.0f msg/s, %d connections, %d client threads, %d bytes, %.1fs after %.1fs warm-up\n\n",
+           options.rate, options.connections, options.threads, options.size, options.duration, options.warmup);
+    total.printPercentiles(stdout, 1.0);
+    printf("\n{\"bench\":\"loadgen\",\"target_rate\":%.0f,\"achieved_rate\":%.0f,\"connections\":%d,"
+           "\"message_bytes\":%d,\"expected\":%ld,\"received\":%ld,\"mean_us\":%.1f,\"p50_us\":%ld,"
+           "\"p90_us\":%ld,\"p99_us\":%ld,\"p999_us\":%ld,\"p9999_us\":%ld,\"max_us\":%ld}\n",
+           options.rate, received / options.duration, options.connections, options.size,
+           static_cast<long>(expected), static_cast<long>(received), total.mean(),
+           static_cast<long>(total.valueAtPercentile(50)), static_cast<long>(total.valueAtPercentile(90)),
+           static_cast<long>(total.valueAtPercentile(99)), static_cast<long>(total.valueAtPercentile(99.9)),
+           static_cast<long>(total.valueAtPercentile(99.99)), static_cast<long>(total.max()));
+    return 0;
+}
@@ -0,0 +1,303 @@
+// 组件级微基准：Buffer、跨线程 queueInLoop、Channel 事件分发、Logger、Timestamp::now
+//
+// 用法：micro_bench [名字过滤=全部] [--producers=1,2,4]
+// 每项固定迭代次数，先跑一遍预热再计时；每个线程绑定到固定的 CPU（核数不够时循环使用），
+// 减少调度和迁移带来的抖动。每项输出一行 JSON，不同版本的输出可以按行 diff。
+
+#include "AsyncLogging.h"
+#include "BenchUtil.h"
+#include "Buffer.h"
+#include "Channel.h"
+#include "EventLoop.h"
+#include "EventLoopThread.h"
+#include "Logger.h"
+#include "Timestamp.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const char *g_filter = "";
+
+// 把调用线程绑定到第 index 个 CPU，超出核数时取模
+void pinThread(int index) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(static_cast<int>(index % (cpus > 0 ? cpus : 1)), &set);
+    pthread_setaffinity_np(pthread_self(), sizeof set, &set);
+}
+
+bool selected(const char *name) {
+    return strstr(name, g_filter) != nullptr;
+}
+
+void report(const char *name, int64_t iterations, int64_t elapsedNs) {
+    printf("{\"bench\":\"micro\",\"name\":\"%s\",\"iterations\":%ld,\"ns_per_op\":%.2f,\"ops_per_sec\":%.0f}\n",
+           name, static_cast<long>(iterations), static_cast<double>(elapsedNs) / iterations,
+           iterations * 1e9 / elapsedNs);
+    fflush(stdout);
+}
+
+void reportLatency(const char *name, int64_t iterations, int64_t elapsedNs, std::vector<int64_t> *latencies) {
+    std::sort(latencies->begin(), latencies->end());
+    auto percentile = [latencies](double p) {
+        return latencies->empty() ? 0 : (*latencies)[static_cast<size_t>(p * (latencies->size() - 1))];
+    };
+    printf("{\"bench\":\"micro\",\"name\":\"%s\",\"iterations\":%ld,\"ns_per_op\":%.2f,\"ops_per_sec\":%.0f,"
+           "\"latency_ns_p50\":%ld,\"latency_ns_p99\":%ld,\"latency_ns_max\":%ld}\n",
+           name, static_cast<long>(iterations), static_cast<double>(elapsedNs) / iterations,
+           iterations * 1e9 / elapsedNs, static_cast<long>(percentile(0.5)),
+           static_cast<long>(percentile(0.99)), static_cast<long>(percentile(1.0)));
+    fflush(stdout);
+}
+
+// op 先跑 iterations / 10 次预热，再计时跑 iterations 次
+void run(const char *name, int64_t iterations, const std::function<void()> &op) {
+    if (!selected(name)) {
+        return;
+    }
+    for (int64_t i = 0; i < iterations / 10; ++i) {
+        op();
+    }
+    int64_t start = nowNs();
+    for (int64_t i = 0; i < iterations; ++i) {
+        op();
+    }
+    report(name, iterations, nowNs() - start);
+}
+
+void benchBuffer() {
+    char data[4096];
+    memset(data, 'x', sizeof data);
+
+    // 追加后立即取走，读写下标归零，不会扩容
+    Buffer buf;
+    run("buffer.append_retrieve_64", 10000000, [&]() {
+        buf.append(data, 64);
+        buf.retrieve(64);
+    });
+    run("buffer.append_retrieve_4096", 2000000, [&]() {
+        buf.append(data, 4096);
+        buf.retrieve(4096);
+    });
+
+    // 每次从默认大小的新 Buffer 增长到 64KB，触发 makeSpace 中的 vector 扩容
+    run("buffer.grow_to_64k", 100000, [&]() {
+        Buffer grow;
+        for (int i = 0; i < 16; ++i) {
+            grow.append(data, 4096);
+        }
+    });
+
+    // 前面取走了大半，剩余可写空间不够但总空间够：makeSpace 把可读数据挪回前面
+    Buffer compact(8192);
+    run("buffer.make_space_compact", 2000000, [&]() {
+        compact.retrieveAll();
+        compact.append(data, 4096);
+        compact.append(data, 2048);
+        compact.retrieve(5120);
+        compact.append(data, 4096);
+    });
+
+    // socketpair 上每次写 1KB 再用 readFd 读出来，包含两次系统调用
+    int fds[2];
+    if (::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0) {
+        Buffer in;
+        int savedErrno = 0;
+        run("buffer.read_fd_1k_socketpair", 500000, [&]() {
+            ::write(fds[0], data, 1024);
+            in.readFd(fds[1], &savedErrno);
+            in.retrieveAll();
+        });
+        // 一次读 64KB，超出 Buffer 可写空间的部分先读进栈上的 extrabuf
+        run("buffer.read_fd_64k_socketpair", 20000, [&]() {
+            for (int i = 0; i < 16; ++i) {
+                ::write(fds[0], data, 4096);
+            }
+            Buffer big;
+            big.readFd(fds[1], &savedErrno);
+        });
+        ::close(fds[0]);
+        ::close(fds[1]);
+    }
+}
+
+// producers 个线程各投递 perProducer 个任务到同一个 loop，
+// 测全部任务执行完的吞吐，以及每个任务从投递到执行的延迟
+void benchQueueInLoop(int producers) {
+    char name[64];
+    snprintf(name, sizeof name, "event_loop.queue_in_loop_%dp", producers);
+    if (!selected(name)) {
+        return;
+    }
+    const int64_t perProducer = 1000000 / producers;
+    const int64_t total = perProducer * producers;
+
+    EventLoopThread thread([](EventLoop*) { pinThread(1); }, "MicroBenchLoop");
+    EventLoop *loop = thread.startLoop();
+
+    // 延迟只在 loop 线程中写，采样每 16 个任务记一次
+    std::vector<int64_t> latencies;
+    latencies.reserve(total / 16 + 1);
+    std::atomic<int64_t> executed(0);
+    std::promise<void> done;
+
+    std::atomic<bool> go(false);
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&, p]() {
+            pinThread(2 + p);
+            while (!go.load()) {
+            }
+            for (int64_t i = 0; i < perProducer; ++i) {
+                int64_t queued = (i & 15) == 0 ? nowNs() : 0;
+                loop->queueInLoop([&, queued]() {
+                    if (queued) {
+                        latencies.push_back(nowNs() - queued);
+                    }
+                    if (executed.fetch_add(1, std::memory_order_relaxed) + 1 == total) {
+                        done.set_value();
+                    }
+                });
+            }
+        });
+    }
+    int64_t start = nowNs();
+    go = true;
+    done.get_future().wait();
+    int64_t elapsed = nowNs() - start;
+    for (std::thread &t : threads) {
+        t.join();
+    }
+    reportLatency(name, total, elapsed, &latencies);
+}
+
+// 直接调用 handleEvevnt，不经过 epoll_wait，只测回调分发本身
+void benchChannel() {
+    EventLoop loop;
+    int fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    Timestamp now = Timestamp::now();
+
+    Channel channel(&loop, fd);
+    channel.setReadCallback([](Timestamp) {});
+    channel.setWriteCallback([]() {});
+    run("channel.handle_event_read", 20000000, [&]() {
+        channel.set_revents(EPOLLIN);
+        channel.handleEvevnt(now);
+    });
+    run("channel.handle_event_read_write", 20000000, [&]() {
+        channel.set_revents(EPOLLIN | EPOLLOUT);
+        channel.handleEvevnt(now);
+    });
+
+    // TcpConnection 的 Channel 都 tie 到连接上，每次分发多一次 weak_ptr::lock
+    std::shared_ptr<int> owner = std::make_shared<int>(0);
+    channel.tie(owner);
+    run("channel.handle_event_read_tied", 20000000, [&]() {
+        channel.set_revents(EPOLLIN);
+        channel.handleEvevnt(now);
+    });
+    ::close(fd);
+}
+
+void benchLogger() {
+    Logger &logger = Logger::instance();
+    LogLevel threshold = Logger::logThreshold();
+
+    // 低于阈值：只有一次分支判断
+    Logger::setLogThreshold(ERROR);
+    run("logger.disabled_level", 50000000, [&]() {
+        LOG_INFO("disabled %d %s\n", 42, "message");
+    });
+
+    // 格式化并交给一个什么都不做的输出函数，测前端的格式化开销
+    Logger::setLogThreshold(INFO);
+    logger.setOutput([](const char*, size_t) {});
+    run("logger.format_null_output", 2000000, [&]() {
+        LOG_INFO("request %d from %s took %.3f ms\n", 42, "127.0.0.1:8080", 1.25);
+    });
+
+    // 经过 AsyncLogging 写进临时目录中的文件，包括前台缓冲交换，落盘由后台线程完成
+    char dir[] = "/tmp/micro_bench.XXXXXX";
+    if (::mkdtemp(dir) != nullptr) {
+        {
+            AsyncLogging async(std::string(dir) + "/log", 1024 * 1024 * 1024);
+            async.start();
+            logger.setOutput([&async](const char *msg, size_t len) { async.append(msg, len); });
+            run("logger.async_logging_file", 2000000, [&]() {
+                LOG_INFO("request %d from %s took %.3f ms\n", 42, "127.0.0.1:8080", 1.25);
+            });
+            logger.setOutput(Logger::OutputFunc());
+            async.stop();
+        }
+        if (DIR *d = ::opendir(dir)) {
+            while (dirent *entry = ::readdir(d)) {
+                if (entry->d_name[0] != '.') {
+                    ::unlinkat(::dirfd(d), entry->d_name, 0);
+                }
+            }
+            ::closedir(d);
+        }
+        ::rmdir(dir);
+    }
+    Logger::setLogThreshold(threshold);
+}
+
+void benchTimestamp() {
+    run("timestamp.now", 20000000, []() { Timestamp::now(); });
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    std::vector<int> producers = { 1, 2, 4 };
+    for (int i = 1; i < argc; ++i) {
+        if (strncmp(argv[i], "--producers=", 12) == 0) {
+            producers.clear();
+            for (const char *s = argv[i] + 12; *s; ) {
+                producers.push_back(atoi(s));
+                const char *comma = strchr(s, ',');
+                if (comma == nullptr) {
+                    break;
+                }
+                s = comma + 1;
+            }
+        } else {
+            g_filter = argv[i];
+        }
+    }
+
+    pinThread(0);
+    Logger::setLogThreshold(ERROR);
+
+    benchBuffer();
+    for (int n : producers) {
+        if (n > 0) {
+            benchQueueInLoop(n);
+        }
+    }
+    benchChannel();
+    benchLogger();
+    benchTimestamp();
+    return 0;
+}
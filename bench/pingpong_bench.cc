@@ -0,0 +1,214 @@
+// ping-pong 吞吐：客户端每个连接先发一条消息，之后两端都把收到的数据原样发回去，
+// 扫描消息长度、连接数和服务端 EventLoopThreadPool 的线程数，每个组合输出一行结果
+//
+// 用法：pingpong_bench [--seconds=3] [--sizes=16,1024,16384,65536] [--connections=1,10,100]
+//                      [--threads=0,1,2,4] [--client-threads=1] [--format=json|csv]
+// threads 是服务端 subloop 数，0 表示所有连接都在 baseLoop 上。
+// 每行带上全部参数，不同版本的输出可以直接按行 diff，或者导入表格比较。
+
+#include "BenchUtil.h"
+#include "Buffer.h"
+#include "EventLoop.h"
+#include "EventLoopThread.h"
+#include "EventLoopThreadPool.h"
+#include "Logger.h"
+#include "TcpClient.h"
+#include "TcpServer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Options {
+    Options()
+        : seconds(3.0)
+        , sizes{ 16, 1024, 16384, 65536 }
+        , connections{ 1, 10, 100 }
+        , threads{ 0, 1, 2, 4 }
+        , clientThreads(1)
+        , csv(false)
+    {}
+
+    double seconds;
+    std::vector<int> sizes;
+    std::vector<int> connections;
+    std::vector<int> threads;
+    int clientThreads;
+    bool csv;
+};
+
+struct Result {
+    int64_t bytes;    // 客户端在计时期间收到的字节数
+    double seconds;
+    double cpuSeconds; // 整个进程（客户端 + 服务端）的 CPU 时间
+};
+
+std::vector<int> parseList(const char *s) {
+    std::vector<int> values;
+    while (*s) {
+        values.push_back(atoi(s));
+        const char *comma = strchr(s, ',');
+        if (comma == nullptr) {
+            break;
+        }
+        s = comma + 1;
+    }
+    return values;
+}
+
+// 一个客户端连接，字节计数在主线程中读取
+class Session {
+public:
+    Session(EventLoop *loop, const InetAddress &addr, const std::string &message,
+            std::atomic<int> *connected)
+        : loop_(loop)
+        , bytesRead_(0)
+    {
+        runInLoopAndWait(loop_, [&]() {
+            client_.reset(new TcpClient(loop_, addr, "PingPongClient"));
+            client_->setConnectionCallback([message, connected](const TcpConnectionPtr &conn) {
+                if (conn->connected()) {
+                    conn->send(message);
+                    ++*connected;
+                }
+            });
+            client_->setMessageCallback([this](const TcpConnectionPtr &conn, Buffer *buf, Timestamp) {
+                bytesRead_.fetch_add(buf->readableBytes(), std::memory_order_relaxed);
+                conn->send(buf);
+            });
+            client_->connect();
+        });
+    }
+
+    ~Session() {
+        runInLoopAndWait(loop_, [&]() { client_.reset(); });
+    }
+
+    void disconnect() { client_->disconnect(); }
+    int64_t bytesRead() const { return bytesRead_.load(std::memory_order_relaxed); }
+
+private:
+    EventLoop *loop_;
+    std::unique_ptr<TcpClient> client_;
+    std::atomic<int64_t> bytesRead_;
+};
+
+Result runOnce(const InetAddress &addr, const Options &options, int size, int connections) {
+    EventLoop loop;
+    EventLoopThreadPool pool(&loop, "PingPongClient");
+    pool.setThreadNum(options.clientThreads);
+    pool.start();
+
+    const std::string message(size, 'x');
+    std::atomic<int> connected(0);
+    std::vector<std::unique_ptr<Session>> sessions;
+    for (int i = 0; i < connections; ++i) {
+        sessions.emplace_back(new Session(pool.getNextLoop(), addr, message, &connected));
+    }
+
+    auto totalBytes = [&sessions]() {
+        int64_t bytes = 0;
+        for (const auto &session : sessions) {
+            bytes += session->bytesRead();
+        }
+        return bytes;
+    };
+
+    // 所有连接建立之后再预热 0.2 秒，然后开始计时
+    Result result;
+    int64_t startBytes = 0;
+    double startCpu = 0;
+    Timestamp start;
+    TimerId waiting = loop.runEvery(0.01, [&]() {
+        if (connected.load() < connections) {
+            return;
+        }
+        loop.cancel(waiting);
+        loop.runAfter(0.2, [&]() {
+            startBytes = totalBytes();
+            startCpu = cpuSeconds();
+            start = Timestamp::now();
+            loop.runAfter(options.seconds, [&]() {
+                result.bytes = totalBytes() - startBytes;
+                result.seconds = timeDifference(Timestamp::now(), start);
+                result.cpuSeconds = cpuSeconds() - startCpu;
+                for (auto &session : sessions) {
+                    session->disconnect();
+                }
+                loop.runAfter(0.1, [&]() { loop.quit(); });
+            });
+        });
+    });
+    loop.loop();
+    sessions.clear();
+    return result;
+}
+
+void report(const Options &options, const Result &result, int size, int connections, int threads) {
+    double mibps = result.bytes / result.seconds / (1024 * 1024);
+    double messages = result.bytes / static_cast<double>(size) / result.seconds;
+    double cpu = result.cpuSeconds / result.seconds;
+    if (options.csv) {
+        printf("pingpong,%d,%d,%d,%d,%.3f,%.2f,%.0f,%.2f\n", size, connections, threads,
+               options.clientThreads, result.seconds, mibps, messages, cpu);
+    } else {
+        printf("{\"bench\":\"pingpong\",\"message_bytes\":%d,\"connections\":%d,\"server_threads\":%d,"
+               "\"client_threads\":%d,\"seconds\":%.3f,\"mib_per_sec\":%.2f,\"messages_per_sec\":%.0f,"
+               "\"cpu_cores\":%.2f}\n",
+               size, connections, threads, options.clientThreads, result.seconds, mibps, messages, cpu);
+    }
+    fflush(stdout);
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        const char *arg = argv[i];
+        const char *value = strchr(arg, '=');
+        value = value ? value + 1 : "";
+        if (strncmp(arg, "--seconds=", 10) == 0) {
+            options.seconds = atof(value);
+        } else if (strncmp(arg, "--sizes=", 8) == 0) {
+            options.sizes = parseList(value);
+        } else if (strncmp(arg, "--connections=", 14) == 0) {
+            options.connections = parseList(value);
+        } else if (strncmp(arg, "--threads=", 10) == 0) {
+            options.threads = parseList(value);
+        } else if (strncmp(arg, "--client-threads=", 17) == 0) {
+            options.clientThreads = atoi(value);
+        } else if (strncmp(arg, "--format=", 9) == 0) {
+            options.csv = strcmp(value, "csv") == 0;
+        } else {
+            fprintf(stderr, "usage: %s [--seconds=3] [--sizes=16,1024,16384,65536] [--connections=1,10,100]\n"
+                            "       [--threads=0,1,2,4] [--client-threads=1] [--format=json|csv]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    Logger::setLogThreshold(ERROR);
+    if (options.csv) {
+        printf("bench,message_bytes,connections,server_threads,client_threads,seconds,"
+               "mib_per_sec,messages_per_sec,cpu_cores\n");
+    }
+
+    InetAddress addr(17391);
+    for (int threads : options.threads) {
+        EchoServer server(addr, "PingPongServer", threads, TcpServer::kReusePort);
+        for (int connections : options.connections) {
+            for (int size : options.sizes) {
+                Result result = runOnce(addr, options, size, connections);
+                report(options, result, size, connections, threads);
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,171 @@
+// 类似 redis-benchmark 的 RESP 压测客户端，可以压 example/kvserver，也可以压真正的 Redis
+//
+// 用法：resp_bench [--port=6380] [--connections=50] [--depth=16] [--requests=200000] [--size=3]
+// --requests 是每项测试的命令数，--size 是 SET 的 value 字节数。
+// 依次测试 PING、SET、GET，key 在 key:000000 ~ key:099999 中随机选取。
+// 每个连接同时有 --depth 个命令在途，收到一个回复就补发一个。
+
+#include "Buffer.h"
+#include "EventLoop.h"
+#include "Logger.h"
+#include "TcpClient.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+// 从 buf 中取出一个完整的回复（只处理简单类型和批量字符串），不完整时返回 false
+bool takeReply(Buffer *buf, bool *isError) {
+    const char *crlf = buf->findCRLF();
+    if (crlf == nullptr) {
+        return false;
+    }
+    const char *begin = buf->peek();
+    size_t total = crlf + 2 - begin;
+    *isError = *begin == '-';
+    if (*begin == '$') {
+        long length = atol(begin + 1);
+        if (length >= 0) {
+            total += length + 2;
+        }
+    }
+    if (buf->readableBytes() < total) {
+        return false;
+    }
+    buf->retrieve(total);
+    return true;
+}
+
+void appendCommand(std::string *out, const std::vector<std::string> &args) {
+    *out += "*" + std::to_string(args.size()) + "\r\n";
+    for (const std::string &arg : args) {
+        *out += "$" + std::to_string(arg.size()) + "\r\n";
+        *out += arg;
+        *out += "\r\n";
+    }
+}
+
+std::string randomKey() {
+    char key[16];
+    snprintf(key, sizeof key, "key:%06d", rand() % 100000);
+    return key;
+}
+
+void runTest(const char *name, const InetAddress &addr, int connections, int pipeline,
+             int64_t requests, const std::function<void(std::string*)> &makeCommand) {
+    EventLoop loop;
+    int64_t sent = 0;
+    int64_t done = 0;
+    int64_t errors = 0;
+    Timestamp start;
+
+    std::vector<std::unique_ptr<TcpClient>> clients;
+    // 还没发完就补发一个命令，多个命令拼成一次 send
+    auto fill = [&](const TcpConnectionPtr &conn, int count) {
+        std::string batch;
+        for (int i = 0; i < count && sent < requests; ++i) {
+            makeCommand(&batch);
+            ++sent;
+        }
+        if (!batch.empty()) {
+            conn->send(batch);
+        }
+    };
+    int connected = 0;
+    for (int i = 0; i < connections; ++i) {
+        std::unique_ptr<TcpClient> client(new TcpClient(&loop, addr, "RespBench"));
+        client->setConnectionCallback([&](const TcpConnectionPtr &conn) {
+            if (conn->connected()) {
+                if (++connected == 1) {
+                    start = Timestamp::now();
+                }
+                fill(conn, pipeline);
+            }
+        });
+        client->setMessageCallback([&](const TcpConnectionPtr &conn, Buffer *buf, Timestamp) {
+            int replies = 0;
+            bool isError = false;
+            while (takeReply(buf, &isError)) {
+                ++replies;
+                if (isError) {
+                    ++errors;
+                }
+            }
+            done += replies;
+            if (done >= requests) {
+                double elapsed = timeDifference(Timestamp::now(), start);
+                printf("%-6s %12.0f requests/s  (%ld requests, %ld errors, %.2fs)\n", name,
+                       done / elapsed, static_cast<long>(done), static_cast<long>(errors), elapsed);
+                loop.quit();
+                return;
+            }
+            fill(conn, replies);
+        });
+        client->connect();
+        clients.push_back(std::move(client));
+    }
+    loop.loop();
+    for (auto &client : clients) {
+        client->disconnect();
+    }
+    clients.clear();
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    int port = 6380;
+    int connections = 50;
+    int pipeline = 16;
+    int64_t requests = 200000;
+    int valueSize = 3;
+    bool ok = true;
+    for (int i = 1; i < argc && ok; ++i) {
+        const char *arg = argv[i];
+        const char *value = strchr(arg, '=');
+        value = value ? value + 1 : "";
+        if (strncmp(arg, "--port=", 7) == 0) {
+            port = atoi(value);
+        } else if (strncmp(arg, "--connections=", 14) == 0) {
+            connections = atoi(value);
+        } else if (strncmp(arg, "--depth=", 8) == 0) {
+            pipeline = atoi(value);
+        } else if (strncmp(arg, "--requests=", 11) == 0) {
+            requests = atol(value);
+        } else if (strncmp(arg, "--size=", 7) == 0) {
+            valueSize = atoi(value);
+        } else {
+            ok = false;
+        }
+    }
+    if (!ok || port < 1 || port > 65535 || connections < 1 || pipeline < 1 || requests < 1 ||
+        valueSize < 0) {
+        fprintf(stderr, "usage: %s [--port=6380] [--connections=50] [--depth=16] [--requests=200000]\n"
+                        "       [--size=3]\n", argv[0]);
+        return 1;
+    }
+
+    Logger::setLogThreshold(ERROR);
+    printf("127.0.0.1:%d, %d connections, pipeline %d, %ld requests, %lu byte values\n", port,
+           connections, pipeline, static_cast<long>(requests), static_cast<unsigned long>(valueSize));
+
+    InetAddress addr(static_cast<uint16_t>(port));
+    const std::string value(valueSize, 'x');
+    runTest("PING", addr, connections, pipeline, requests, [](std::string *out) {
+        appendCommand(out, {"PING"});
+    });
+    runTest("SET", addr, connections, pipeline, requests, [&value](std::string *out) {
+        appendCommand(out, {"SET", randomKey(), value});
+    });
+    runTest("GET", addr, connections, pipeline, requests, [](std::string *out) {
+        appendCommand(out, {"GET", randomKey()});
+    });
+    return 0;
+}
@@ -0,0 +1,159 @@
+// RPC 吞吐：每个连接同时保持若干个在途调用，收到响应就补发一个
+//
+// 用法：rpc_bench [--seconds=5] [--connections=8] [--depth=64] [--size=32] [--mode=inloop|pool]
+// --depth 是每个连接的在途调用数，--size 是请求字节数。
+// inloop：echo 方法在 loop 线程中执行；pool：交给 2 个计算线程执行。
+// 结果是每秒调用数，以及按进程 CPU 时间（客户端和服务端之和）折算的每核每秒调用数。
+
+#include "BenchUtil.h"
+#include "EventLoop.h"
+#include "EventLoopThread.h"
+#include "Logger.h"
+#include "RpcClient.h"
+#include "RpcServer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+// 服务端跑在单独的线程里，RpcServer 在它自己的 loop 线程中创建和销毁
+class BenchServer {
+public:
+    BenchServer(const InetAddress &addr, bool usePool)
+        : loop_(thread_.startLoop())
+    {
+        std::promise<void> started;
+        loop_->runInLoop([&]() {
+            server_.reset(new RpcServer(loop_, addr, "RpcBench"));
+            if (usePool) {
+                server_->setComputeThreadNum(2);
+            }
+            server_->registerMethod("echo",
+                [](const StringPiece &request, Timestamp, const RpcServer::Done &done) {
+                    done(kRpcOk, request);
+                },
+                usePool ? RpcServer::kInPool : RpcServer::kInLoop);
+            server_->start();
+            started.set_value();
+        });
+        started.get_future().wait();
+    }
+
+    ~BenchServer() {
+        std::promise<void> stopped;
+        loop_->runInLoop([&]() {
+            server_.reset();
+            stopped.set_value();
+        });
+        stopped.get_future().wait();
+    }
+
+private:
+    EventLoopThread thread_;
+    EventLoop *loop_;
+    std::unique_ptr<RpcServer> server_;
+};
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    double seconds = 5;
+    int connections = 8;
+    int depth = 64;
+    int size = 32;
+    bool usePool = false;
+    bool ok = true;
+    for (int i = 1; i < argc && ok; ++i) {
+        const char *arg = argv[i];
+        const char *value = strchr(arg, '=');
+        value = value ? value + 1 : "";
+        if (strncmp(arg, "--seconds=", 10) == 0) {
+            seconds = atof(value);
+        } else if (strncmp(arg, "--connections=", 14) == 0) {
+            connections = atoi(value);
+        } else if (strncmp(arg, "--depth=", 8) == 0) {
+            depth = atoi(value);
+        } else if (strncmp(arg, "--size=", 7) == 0) {
+            size = atoi(value);
+        } else if (strcmp(arg, "--mode=pool") == 0) {
+            usePool = true;
+        } else if (strcmp(arg, "--mode=inloop") == 0) {
+            usePool = false;
+        } else {
+            ok = false;
+        }
+    }
+    if (!ok || seconds <= 0 || connections < 1 || depth < 1 || size < 0) {
+        fprintf(stderr, "usage: %s [--seconds=5] [--connections=8] [--depth=64] [--size=32]\n"
+                        "       [--mode=inloop|pool]\n", argv[0]);
+        return 1;
+    }
+    size_t requestSize = static_cast<size_t>(size);
+
+    Logger::setLogThreshold(ERROR);
+    printf("echo %lu bytes, %d connections x %d in flight, handler %s, %.1fs\n",
+           static_cast<unsigned long>(requestSize), connections, depth,
+           usePool ? "in pool" : "in loop", seconds);
+
+    InetAddress addr(17391);
+    BenchServer server(addr, usePool);
+
+    EventLoop loop;
+    const std::string request(requestSize, 'x');
+    bool running = true;
+    int64_t calls = 0;
+    int64_t failures = 0;
+
+    std::vector<std::unique_ptr<RpcClient>> clients;
+    for (int i = 0; i < connections; ++i) {
+        clients.emplace_back(new RpcClient(&loop, addr, "RpcBenchClient"));
+        clients.back()->connect();
+    }
+    // 每个调用完成后在同一个连接上补发一个，保持在途调用数不变
+    std::function<void(RpcClient*)> issue = [&](RpcClient *client) {
+        client->call("echo", request, 1.0, [&, client](RpcStatus status, const StringPiece&) {
+            ++calls;
+            if (status != kRpcOk) {
+                ++failures;
+            }
+            if (running) {
+                issue(client);
+            }
+        });
+    };
+    for (auto &client : clients) {
+        for (int j = 0; j < depth; ++j) {
+            issue(client.get());
+        }
+    }
+
+    // 先预热，连接全部建立之后再开始计数
+    int64_t startCalls = 0;
+    Timestamp start;
+    double startCpu = 0;
+    loop.runAfter(0.3, [&]() {
+        startCalls = calls;
+        start = Timestamp::now();
+        startCpu = cpuSeconds();
+    });
+    loop.runAfter(0.3 + seconds, [&]() {
+        running = false;
+        double elapsed = timeDifference(Timestamp::now(), start);
+        double cpu = cpuSeconds() - startCpu;
+        int64_t n = calls - startCalls;
+        printf("%12.0f calls/s  %12.0f calls per cpu-second  %.2f cores busy  %ld failed\n",
+               n / elapsed, cpu > 0 ? n / cpu : 0, cpu / elapsed, static_cast<long>(failures));
+        loop.runAfter(0.2, [&]() { loop.quit(); });
+    });
+    loop.loop();
+    clients.clear();
+    return 0;
+}
@@ -0,0 +1,197 @@
+// 回环上的单向吞吐：明文 TCP、开启 kTLS 的 TLS、用户态 TLS 三种方式各跑一次
+//
+// 用法：tls_bench [秒数=3] [每次发送字节数=65536]
+// 证书是启动时生成的自签名证书（P-256），写在临时文件里，结束后删除。
+// 内核不支持 kTLS（没有 tls 模块）时，第二项会退回用户态 TLS，输出里的 ktls 列标明实际情况。
+
+#include "Buffer.h"
+#include "EventLoop.h"
+#include "EventLoopThread.h"
+#include "Logger.h"
+#include "TcpClient.h"
+#include "TcpServer.h"
+#include "TlsContext.h"
+#include "TlsTransport.h"
+
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/x509.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <future>
+#include <memory>
+#include <string>
+
+namespace {
+
+// 生成自签名证书和私钥，写入 certFile/keyFile
+bool generateSelfSignedCert(const std::string &certFile, const std::string &keyFile) {
+    EVP_PKEY *key = EVP_EC_gen("P-256");
+    X509 *cert = X509_new();
+    if (key == nullptr || cert == nullptr) {
+        return false;
+    }
+    X509_set_version(cert, 2);
+    ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+    X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+    X509_gmtime_adj(X509_getm_notAfter(cert), 24 * 3600);
+    X509_set_pubkey(cert, key);
+    X509_NAME *name = X509_get_subject_name(cert);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC,
+                               reinterpret_cast<const unsigned char*>("localhost"), -1, -1, 0);
+    X509_set_issuer_name(cert, name);
+    bool ok = X509_sign(cert, key, EVP_sha256()) > 0;
+
+    FILE *fp = fopen(certFile.c_str(), "w");
+    ok = ok && fp && PEM_write_X509(fp, cert) == 1;
+    if (fp) {
+        fclose(fp);
+    }
+    fp = fopen(keyFile.c_str(), "w");
+    ok = ok && fp && PEM_write_PrivateKey(fp, key, nullptr, nullptr, 0, nullptr, nullptr) == 1;
+    if (fp) {
+        fclose(fp);
+    }
+    X509_free(cert);
+    EVP_PKEY_free(key);
+    return ok;
+}
+
+// 服务端只数字节，跑在单独的线程里
+class SinkServer {
+public:
+    SinkServer(const InetAddress &addr, const std::shared_ptr<TlsContext> &tls)
+        : loop_(thread_.startLoop())
+        , bytes_(0)
+        , ktls_(false)
+    {
+        std::promise<void> started;
+        loop_->runInLoop([&]() {
+            server_.reset(new TcpServer(loop_, addr, "SinkServer"));
+            if (tls) {
+                server_->setTransportFactory(tls->serverTransportFactory());
+            }
+            server_->setConnectionCallback([this](const TcpConnectionPtr &conn) {
+                TlsTransport *t = dynamic_cast<TlsTransport*>(conn->transport());
+                if (conn->connected() && t) {
+                    ktls_ = t->ktlsRecv();
+                }
+            });
+            server_->setMessageCallback([this](const TcpConnectionPtr&, Buffer *buf, Timestamp) {
+                bytes_.fetch_add(buf->readableBytes(), std::memory_order_relaxed);
+                buf->retrieveAll();
+            });
+            server_->start();
+            started.set_value();
+        });
+        started.get_future().wait();
+    }
+
+    ~SinkServer() {
+        std::promise<void> stopped;
+        loop_->runInLoop([&]() {
+            server_.reset();
+            stopped.set_value();
+        });
+        stopped.get_future().wait();
+    }
+
+    int64_t bytes() const { return bytes_.load(std::memory_order_relaxed); }
+    bool ktlsRecv() const { return ktls_; }
+
+private:
+    EventLoopThread thread_;
+    EventLoop *loop_;
+    std::unique_ptr<TcpServer> server_;
+    std::atomic<int64_t> bytes_;
+    std::atomic_bool ktls_;
+};
+
+void run(const char *label, const InetAddress &addr, const std::shared_ptr<TlsContext> &serverTls,
+         const std::shared_ptr<TlsContext> &clientTls, double seconds, size_t chunkSize) {
+    SinkServer server(addr, serverTls);
+    EventLoop loop;
+    const std::string chunk(chunkSize, 'x');
+    bool running = true;
+    bool ktlsSend = false;
+
+    TcpClient client(&loop, addr, "SinkClient");
+    if (clientTls) {
+        client.setTransportFactory(clientTls->clientTransportFactory("localhost"));
+    }
+    client.setConnectionCallback([&](const TcpConnectionPtr &conn) {
+        if (conn->connected()) {
+            TlsTransport *t = dynamic_cast<TlsTransport*>(conn->transport());
+            ktlsSend = t && t->ktlsSend();
+            conn->send(chunk);
+        }
+    });
+    // 上一块写进内核之后再发下一块，管道始终是满的
+    client.setWriteCompleteCallback([&](const TcpConnectionPtr &conn) {
+        if (running) {
+            conn->send(chunk);
+        }
+    });
+    client.connect();
+
+    int64_t startBytes = 0;
+    Timestamp start;
+    loop.runAfter(0.3, [&]() {
+        startBytes = server.bytes();
+        start = Timestamp::now();
+    });
+    loop.runAfter(0.3 + seconds, [&]() {
+        running = false;
+        double elapsed = timeDifference(Timestamp::now(), start);
+        double mib = (server.bytes() - startBytes) / (1024.0 * 1024.0);
+        printf("%-16s %10.1f MiB/s   ktls send=%d recv=%d\n", label, mib / elapsed,
+               ktlsSend, static_cast<int>(server.ktlsRecv()));
+        client.disconnect();
+        loop.runAfter(0.1, [&]() { loop.quit(); });
+    });
+    loop.loop();
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    double seconds = argc > 1 ? atof(argv[1]) : 3.0;
+    size_t chunkSize = argc > 2 ? static_cast<size_t>(atoi(argv[2])) : 65536;
+    Logger::setLogThreshold(ERROR);
+
+    char dir[] = "/tmp/mymuduo-tls-bench-XXXXXX";
+    if (mkdtemp(dir) == nullptr) {
+        perror("mkdtemp");
+        return 1;
+    }
+    std::string certFile = std::string(dir) + "/cert.pem";
+    std::string keyFile = std::string(dir) + "/key.pem";
+    if (!generateSelfSignedCert(certFile, keyFile)) {
+        fprintf(stderr, "generate self-signed certificate failed\n");
+        return 1;
+    }
+
+    std::shared_ptr<TlsContext> serverTls = TlsContext::newServerContext(certFile, keyFile);
+    std::shared_ptr<TlsContext> clientTls = TlsContext::newClientContext(certFile);
+    std::shared_ptr<TlsContext> serverUserTls = TlsContext::newServerContext(certFile, keyFile);
+    std::shared_ptr<TlsContext> clientUserTls = TlsContext::newClientContext(certFile);
+    ::unlink(certFile.c_str());
+    ::unlink(keyFile.c_str());
+    ::rmdir(dir);
+    if (!serverTls || !clientTls || !serverUserTls || !clientUserTls) {
+        fprintf(stderr, "create TLS context failed\n");
+        return 1;
+    }
+    serverUserTls->setKtlsEnabled(false);
+    clientUserTls->setKtlsEnabled(false);
+
+    printf("%lu byte writes, %.1fs each\n", static_cast<unsigned long>(chunkSize), seconds);
+    run("tcp", InetAddress(17371), nullptr, nullptr, seconds, chunkSize);
+    run("tls (ktls)", InetAddress(17372), serverTls, clientTls, seconds, chunkSize);
+    run("tls (userspace)", InetAddress(17373), serverUserTls, clientUserTls, seconds, chunkSize);
+    return 0;
+}
@@ -0,0 +1,112 @@
+// 同一个 echo 负载分别跑在回环 TCP 和 Unix 域 socket 上，比较吞吐和往返延迟
+//
+// 用法：uds_echo_bench [秒数=5] [消息字节数=64] [连接数=16] [服务端 subloop 数=1]
+// 每个连接同一时刻只有一个消息在途（ping-pong），结果是每秒往返次数和平均往返时间。
+
+#include "BenchUtil.h"
+#include "Buffer.h"
+#include "EventLoop.h"
+#include "EventLoopThread.h"
+#include "Logger.h"
+#include "TcpClient.h"
+#include "TcpServer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Result {
+    int64_t roundTrips;
+    double seconds;
+};
+
+Result runClients(const InetAddress &addr, double seconds, size_t messageSize, int connections) {
+    EventLoop loop;
+    const std::string message(messageSize, 'x');
+    int64_t roundTrips = 0;
+    bool running = true;
+
+    std::vector<std::unique_ptr<TcpClient>> clients;
+    for (int i = 0; i < connections; ++i) {
+        std::unique_ptr<TcpClient> client(new TcpClient(&loop, addr, "EchoClient"));
+        client->setConnectionCallback([&](const TcpConnectionPtr &conn) {
+            if (conn->connected()) {
+                conn->send(message);
+            }
+        });
+        client->setMessageCallback([&](const TcpConnectionPtr &conn, Buffer *buf, Timestamp) {
+            while (buf->readableBytes() >= messageSize) {
+                buf->retrieve(messageSize);
+                ++roundTrips;
+                if (running) {
+                    conn->send(message);
+                }
+            }
+        });
+        client->connect();
+        clients.push_back(std::move(client));
+    }
+
+    // 先预热，连接全部建立之后再开始计数
+    int64_t startCount = 0;
+    Timestamp start;
+    loop.runAfter(0.2, [&]() {
+        startCount = roundTrips;
+        start = Timestamp::now();
+    });
+    Result result;
+    loop.runAfter(0.2 + seconds, [&]() {
+        running = false;
+        result.roundTrips = roundTrips - startCount;
+        result.seconds = timeDifference(Timestamp::now(), start);
+        for (auto &client : clients) {
+            client->disconnect();
+        }
+        loop.runAfter(0.1, [&]() { loop.quit(); });
+    });
+    loop.loop();
+    clients.clear();
+    return result;
+}
+
+void report(const char *transport, const Result &result, size_t messageSize, int connections) {
+    double rate = result.roundTrips / result.seconds;
+    double mbps = rate * messageSize * 2 / (1024 * 1024);
+    double rttUs = result.roundTrips > 0 ? connections * result.seconds * 1e6 / result.roundTrips : 0;
+    printf("%-10s %12.0f round trips/s %10.2f MiB/s %10.1f us avg rtt\n",
+           transport, rate, mbps, rttUs);
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    double seconds = argc > 1 ? atof(argv[1]) : 5.0;
+    size_t messageSize = argc > 2 ? static_cast<size_t>(atoi(argv[2])) : 64;
+    int connections = argc > 3 ? atoi(argv[3]) : 16;
+    int threads = argc > 4 ? atoi(argv[4]) : 1;
+
+    Logger::setLogThreshold(ERROR);
+    printf("echo %lu bytes, %d connections, %d server threads, %.1fs each\n",
+           static_cast<unsigned long>(messageSize), connections, threads, seconds);
+
+    InetAddress tcpAddr(17361);
+    {
+        EchoServer server(tcpAddr, "EchoServer", threads);
+        report("tcp", runClients(tcpAddr, seconds, messageSize, connections), messageSize, connections);
+    }
+
+    char name[64];
+    snprintf(name, sizeof name, "mymuduo-uds-bench-%d", static_cast<int>(::getpid()));
+    InetAddress udsAddr = InetAddress::unixAbstract(name);
+    {
+        EchoServer server(udsAddr, "EchoServer", threads);
+        report("unix", runClients(udsAddr, seconds, messageSize, connections), messageSize, connections);
+    }
+    return 0;
+}
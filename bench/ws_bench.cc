@@ -0,0 +1,50 @@
+// WebSocket 去掩码吞吐：逐字节异或 vs WebSocket::unmask（运行时选择 AVX2/SSE2/8 字节）
+//
+// 用法：ws_bench [每种长度处理的总字节数（MB）=2048]
+// 负载长度覆盖控制帧、典型聊天消息到大块二进制数据。
+
+#include "WebSocket.h"
+#include "Timestamp.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <string>
+#include <vector>
+
+namespace {
+
+void unmaskBytewise(char *data, size_t len, const char mask[4]) {
+    for (size_t i = 0; i < len; ++i) {
+        data[i] ^= mask[i & 3];
+    }
+}
+
+// 返回 MB/s
+double measure(void (*unmask)(char*, size_t, const char*), std::vector<char> *payload, int64_t totalBytes) {
+    const char mask[4] = { 0x12, 0x34, 0x56, 0x78 };
+    const size_t len = payload->size();
+    const int64_t rounds = totalBytes / static_cast<int64_t>(len) + 1;
+    Timestamp start = Timestamp::now();
+    for (int64_t i = 0; i < rounds; ++i) {
+        unmask(payload->data(), len, mask);
+    }
+    double seconds = timeDifference(Timestamp::now(), start);
+    return static_cast<double>(rounds * len) / seconds / (1024 * 1024);
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    int64_t totalBytes = (argc > 1 ? atoll(argv[1]) : 2048) * 1024 * 1024;
+    const size_t sizes[] = { 16, 125, 1024, 16 * 1024, 64 * 1024, 1024 * 1024 };
+
+    printf("%10s %16s %16s %8s\n", "bytes", "bytewise MB/s", "unmask MB/s", "speedup");
+    for (size_t size : sizes) {
+        std::vector<char> payload(size, 'x');
+        double bytewise = measure(unmaskBytewise, &payload, totalBytes / 8);
+        double fast = measure(WebSocket::unmask, &payload, totalBytes);
+        printf("%10zu %16.0f %16.0f %7.1fx\n", size, bytewise, fast, fast / bytewise);
+    }
+    return 0;
+}
@@ -0,0 +1,256 @@
+// 兼容 Redis 协议的内存 KV 示例，可以用 redis-cli / redis-benchmark 或 bench/resp_bench 压测
+//
+// 用法：kvserver [端口=6380] [subloop 数=0]
+// 支持 PING ECHO GET SET DEL EXISTS INCR MGET MSET DBSIZE FLUSHALL HELLO SELECT COMMAND CONFIG QUIT。
+// 一次可读事件里流水线发来的所有命令一遍解码，回复直接编码进连接的 outputBuffer，最后只写一次。
+#include <mymuduo/Logger.h>
+#include <mymuduo/RespCodec.h>
+#include <mymuduo/TcpServer.h>
+
+#include <errno.h>
+#include <limits.h>
+#include <stdlib.h>
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// 按 key 的哈希分成多个分片，每个分片一把锁，不同 subloop 上的连接很少争同一把锁
+class KvStore {
+public:
+  static const size_t kNumShards = 64;
+
+  // 找到时在持锁期间调用 f(value)，回复可以直接从 value 编码，不必先拷出来
+  template <typename F> bool get(const std::string &key, F f) {
+    Shard &shard = shardOf(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.map.find(key);
+    if (it == shard.map.end()) {
+      return false;
+    }
+    f(it->second);
+    return true;
+  }
+
+  void set(std::string key, const StringPiece &value) {
+    Shard &shard = shardOf(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.map[std::move(key)].assign(value.data(), value.size());
+  }
+
+  bool del(const std::string &key) {
+    Shard &shard = shardOf(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    return shard.map.erase(key) > 0;
+  }
+
+  // 值不是整数时返回 false
+  bool incr(const std::string &key, int64_t *result) {
+    Shard &shard = shardOf(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    std::string &value = shard.map[key];
+    int64_t n = 0;
+    if (!value.empty()) {
+      char *end = nullptr;
+      errno = 0;
+      n = strtoll(value.c_str(), &end, 10);
+      if (*end != '\0' || errno == ERANGE) {
+        return false;
+      }
+    }
+    // 和 Redis 一样，加一溢出时报错而不是回绕
+    if (n == LLONG_MAX) {
+      return false;
+    }
+    *result = ++n;
+    value = std::to_string(n);
+    return true;
+  }
+
+  size_t size() {
+    size_t n = 0;
+    for (Shard &shard : shards_) {
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      n += shard.map.size();
+    }
+    return n;
+  }
+
+  void clear() {
+    for (Shard &shard : shards_) {
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      shard.map.clear();
+    }
+  }
+
+private:
+  struct Shard {
+    std::mutex mutex;
+    std::unordered_map<std::string, std::string> map;
+  };
+
+  Shard &shardOf(const std::string &key) {
+    return shards_[std::hash<std::string>()(key) % kNumShards];
+  }
+
+  Shard shards_[kNumShards];
+};
+
+// 每个连接的协议版本，HELLO 3 之后用 RESP3 回复
+struct KvSession {
+  KvSession() : protocol(2) {}
+  int protocol;
+};
+
+class KvServer {
+public:
+  KvServer(EventLoop *loop, const InetAddress &addr, int threads)
+      : server_(loop, addr, "KvServer") {
+    server_.setConnectionCallback(
+        std::bind(&KvServer::onConnection, this, std::placeholders::_1));
+    server_.setMessageCallback(
+        std::bind(&KvServer::onMessage, this, std::placeholders::_1,
+                  std::placeholders::_2, std::placeholders::_3));
+    server_.setThreadNum(threads);
+  }
+
+  void start() { server_.start(); }
+
+private:
+  void onConnection(const TcpConnectionPtr &conn) {
+    if (conn->connected()) {
+      conn->setContext(std::make_shared<KvSession>());
+    }
+  }
+
+  void onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp) {
+    // 每个 loop 线程一个 batch，参数数组的容量反复使用
+    static thread_local RespBatch batch;
+    KvSession *session = static_cast<KvSession *>(conn->getContext().get());
+
+    batch.clear();
+    bool ok = RespCodec::decode(buf, &batch);
+    bool quit = false;
+    for (size_t i = 0; i < batch.size() && !quit; ++i) {
+      RespWriter writer(conn->outputBuffer(), session->protocol);
+      quit = execute(session, batch.argv(i), batch.argc(i), &writer);
+    }
+    buf->retrieve(batch.consumedBytes());
+    batch.clear();
+
+    if (!ok) {
+      RespWriter writer(conn->outputBuffer(), session->protocol);
+      writer.error("ERR Protocol error");
+      quit = true;
+    }
+    conn->sendOutputBuffer();
+    if (quit) {
+      buf->retrieveAll();
+      conn->shutdown();
+    }
+  }
+
+  // 返回 true 表示执行完后关闭连接
+  bool execute(KvSession *session, const StringPiece *argv, size_t argc,
+               RespWriter *w) {
+    const StringPiece &cmd = argv[0];
+    if (cmd.equalsIgnoreCase("GET") && argc == 2) {
+      if (!store_.get(argv[1].toString(),
+                      [w](const std::string &value) { w->bulk(value); })) {
+        w->null();
+      }
+    } else if (cmd.equalsIgnoreCase("SET") && argc == 3) {
+      store_.set(argv[1].toString(), argv[2]);
+      w->status("OK");
+    } else if (cmd.equalsIgnoreCase("PING") && argc <= 2) {
+      if (argc == 2) {
+        w->bulk(argv[1]);
+      } else {
+        w->status("PONG");
+      }
+    } else if (cmd.equalsIgnoreCase("ECHO") && argc == 2) {
+      w->bulk(argv[1]);
+    } else if ((cmd.equalsIgnoreCase("DEL") || cmd.equalsIgnoreCase("EXISTS")) && argc >= 2) {
+      bool del = cmd.equalsIgnoreCase("DEL");
+      int64_t n = 0;
+      for (size_t i = 1; i < argc; ++i) {
+        std::string key = argv[i].toString();
+        if (del ? store_.del(key) : store_.get(key, [](const std::string &) {})) {
+          ++n;
+        }
+      }
+      w->integer(n);
+    } else if (cmd.equalsIgnoreCase("INCR") && argc == 2) {
+      int64_t n = 0;
+      if (store_.incr(argv[1].toString(), &n)) {
+        w->integer(n);
+      } else {
+        w->error("ERR value is not an integer or out of range");
+      }
+    } else if (cmd.equalsIgnoreCase("MGET") && argc >= 2) {
+      w->arrayHeader(argc - 1);
+      for (size_t i = 1; i < argc; ++i) {
+        if (!store_.get(argv[i].toString(),
+                        [w](const std::string &value) { w->bulk(value); })) {
+          w->null();
+        }
+      }
+    } else if (cmd.equalsIgnoreCase("MSET") && argc >= 3 && argc % 2 == 1) {
+      for (size_t i = 1; i < argc; i += 2) {
+        store_.set(argv[i].toString(), argv[i + 1]);
+      }
+      w->status("OK");
+    } else if (cmd.equalsIgnoreCase("DBSIZE") && argc == 1) {
+      w->integer(static_cast<int64_t>(store_.size()));
+    } else if (cmd.equalsIgnoreCase("FLUSHALL") || cmd.equalsIgnoreCase("FLUSHDB")) {
+      store_.clear();
+      w->status("OK");
+    } else if (cmd.equalsIgnoreCase("HELLO")) {
+      int protocol = argc >= 2 ? atoi(argv[1].toString().c_str()) : session->protocol;
+      if (protocol != 2 && protocol != 3) {
+        w->error("NOPROTO unsupported protocol version");
+        return false;
+      }
+      // HELLO 的回复已经按新的协议版本编码
+      session->protocol = protocol;
+      w->setProtocol(protocol);
+      w->mapHeader(3);
+      w->bulk("server");
+      w->bulk("mymuduo-kv");
+      w->bulk("proto");
+      w->integer(protocol);
+      w->bulk("mode");
+      w->bulk("standalone");
+    } else if (cmd.equalsIgnoreCase("SELECT") && argc == 2) {
+      w->status("OK");
+    } else if (cmd.equalsIgnoreCase("COMMAND") || cmd.equalsIgnoreCase("CONFIG")) {
+      // redis-benchmark 启动时会发，回一个空数组即可
+      w->arrayHeader(0);
+    } else if (cmd.equalsIgnoreCase("QUIT")) {
+      w->status("OK");
+      return true;
+    } else {
+      std::string msg = "ERR unknown command or wrong number of arguments for '" +
+                        cmd.toString() + "'";
+      w->error(msg);
+    }
+    return false;
+  }
+
+  TcpServer server_;
+  KvStore store_;
+};
+
+int main(int argc, char *argv[]) {
+  int port = argc > 1 ? atoi(argv[1]) : 6380;
+  int threads = argc > 2 ? atoi(argv[2]) : 0;
+  Logger::setLogThreshold(ERROR);
+
+  EventLoop loop;
+  KvServer server(&loop, InetAddress(static_cast<uint16_t>(port)), threads);
+  server.start();
+  loop.loop();
+  return 0;
+}